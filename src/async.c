@@ -0,0 +1,143 @@
+#include "async.h"
+#include "task.h"
+#include "cpu.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Where an operation is parked
+#define OP_IDLE    0
+#define OP_QUEUED  1
+#define OP_TIMER   2
+#define OP_WAITING 3
+#define OP_RUNNING 4
+
+static async_op_t *run_head = NULL, *run_tail = NULL;
+static async_op_t *wheel[ASYNC_WHEEL]; // by wake_tick, unsorted within a slot
+static uint32_t now_tick = 0;          // latest tick seen by async_tick()
+static wait_queue_t executor_wait;
+static async_stats_t stats;
+
+// All list updates run with interrupts off: events and timers fire from
+// IRQ context.
+
+static void enqueue(async_op_t *op) {
+    op->next = NULL;
+    op->state = OP_QUEUED;
+    if (run_tail) run_tail->next = op;
+    else run_head = op;
+    run_tail = op;
+}
+
+void async_start(async_op_t *op, async_fn fn) {
+    op->fn = fn;
+    op->resume = 0;
+    uint32_t flags = irq_save();
+    stats.started++;
+    if (++stats.pending > stats.max_pending) stats.max_pending = stats.pending;
+    enqueue(op);
+    wait_queue_wake_all(&executor_wait);
+    irq_restore(flags);
+}
+
+void async_ready(async_op_t *op) {
+    uint32_t flags = irq_save();
+    enqueue(op);
+    irq_restore(flags);
+}
+
+void async_sleep(async_op_t *op, uint32_t ticks) {
+    if (!ticks) {
+        async_ready(op);
+        return;
+    }
+    uint32_t flags = irq_save();
+    op->wake_tick = now_tick + ticks;
+    op->state = OP_TIMER;
+    async_op_t **slot = &wheel[op->wake_tick & (ASYNC_WHEEL - 1)];
+    op->next = *slot;
+    *slot = op;
+    stats.timers++;
+    irq_restore(flags);
+}
+
+void async_wait(async_op_t *op, async_event_t *ev) {
+    op->state = OP_WAITING;
+    op->next = ev->head;
+    ev->head = op;
+}
+
+void async_event_signal(async_event_t *ev) {
+    uint32_t flags = irq_save();
+    async_op_t *op = ev->head;
+    ev->head = NULL;
+    if (op) wait_queue_wake_all(&executor_wait);
+    while (op) {
+        async_op_t *next = op->next;
+        enqueue(op);
+        op = next;
+    }
+    irq_restore(flags);
+}
+
+// One slot per tick; entries more than a wheel turn away stay for a later lap
+void async_tick(uint32_t tick) {
+    now_tick = tick;
+    int fired = 0;
+    for (async_op_t **p = &wheel[tick & (ASYNC_WHEEL - 1)]; *p;) {
+        async_op_t *op = *p;
+        if ((int32_t)(tick - op->wake_tick) >= 0) {
+            *p = op->next;
+            stats.timers--;
+            enqueue(op);
+            fired = 1;
+        } else {
+            p = &op->next;
+        }
+    }
+    if (fired) wait_queue_wake_all(&executor_wait);
+}
+
+// Operations queued while this pass runs wait for the next one, so a
+// yielding operation cannot keep the executor in here forever
+int async_run_pending(void) {
+    uint32_t flags = irq_save();
+    async_op_t *last = run_tail;
+    irq_restore(flags);
+    int ran = 0;
+    while (last) {
+        flags = irq_save();
+        async_op_t *op = run_head;
+        run_head = op->next;
+        if (!run_head) run_tail = NULL;
+        op->state = OP_RUNNING;
+        stats.resumes++;
+        irq_restore(flags);
+        int done = op->fn(op) == ASYNC_DONE; // may free op when done
+        if (done) {
+            flags = irq_save();
+            stats.completed++;
+            stats.pending--;
+            irq_restore(flags);
+        }
+        ran++;
+        if (op == last) break;
+    }
+    return ran;
+}
+
+// Runs every operation; they must not block the task (no task_sleep or
+// blocking IPC), only suspend through the ASYNC_* macros
+void async_executor_task(void) {
+    for (;;) {
+        uint32_t flags = irq_save();
+        while (!run_head) wait_queue_sleep(&executor_wait);
+        irq_restore(flags);
+        async_run_pending();
+    }
+}
+
+void async_stats(async_stats_t *st) {
+    uint32_t flags = irq_save();
+    *st = stats;
+    irq_restore(flags);
+}
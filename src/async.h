@@ -0,0 +1,90 @@
+#ifndef ASYNC_H
+#define ASYNC_H
+
+#include <stdint.h>
+#include "cpu.h" // irq_save/irq_restore in ASYNC_WAIT_UNTIL
+
+// Stackless continuations. An operation is a small frame (an async_op_t,
+// usually embedded at the start of a caller-defined struct) plus a
+// function that the executor task calls each time the operation can make
+// progress. The function resumes where it last suspended through the
+// ASYNC_* macros, which record a resume point in the frame; C locals do not
+// survive a suspension, so state lives in the frame. A pending operation
+// costs its frame, not a task and a stack.
+//
+// Operations wake up on timer expiry (ASYNC_SLEEP), on an async_event_t
+// signalled from IRQ or task context (ASYNC_WAIT_UNTIL), or when yielding.
+#define ASYNC_PENDING 0
+#define ASYNC_DONE    1
+#define ASYNC_WHEEL   64 // timer wheel slots, power of two
+
+typedef struct async_op async_op_t;
+typedef int (*async_fn)(async_op_t *op);
+
+struct async_op {
+    async_fn fn;
+    async_op_t *next;   // run queue, timer slot or event list
+    uint32_t wake_tick; // ASYNC_SLEEP deadline
+    uint16_t resume;    // resume point (source line), 0 = start
+    uint16_t state;     // where the op is parked
+};
+
+// Operations waiting for something to happen. Signalling moves all of
+// them to the run queue; they re-check their condition when resumed.
+typedef struct async_event {
+    async_op_t *head;
+} async_event_t;
+
+typedef struct async_stats {
+    uint32_t started, completed, resumes;
+    uint32_t pending, max_pending; // started but not completed
+    uint32_t timers;               // parked on the timer wheel
+} async_stats_t;
+
+// Queue `op` to run `fn` from the beginning. Once `fn` returns ASYNC_DONE
+// the executor never touches the frame again, so `fn` may free it first.
+void async_start(async_op_t *op, async_fn fn);
+
+// Used by the macros
+void async_ready(async_op_t *op);
+void async_sleep(async_op_t *op, uint32_t ticks);
+void async_wait(async_op_t *op, async_event_t *ev); // interrupts off
+
+// Resume every operation parked on `ev`; safe from IRQ context
+void async_event_signal(async_event_t *ev);
+
+// Timer interrupt hook: expire the wheel slot for `tick`
+void async_tick(uint32_t tick);
+
+// Run queued operations until the queue is empty; returns how many ran
+int async_run_pending(void);
+void async_executor_task(void);
+void async_stats(async_stats_t *st);
+
+#define ASYNC_BEGIN(op) switch ((op)->resume) { case 0:
+
+// The frame is not touched after the last statement, which may free it
+#define ASYNC_END(op) } return ASYNC_DONE
+
+// Let other queued operations run first
+#define ASYNC_YIELD(op) do { \
+        (op)->resume = __LINE__; async_ready(op); return ASYNC_PENDING; case __LINE__:; \
+    } while (0)
+
+// Resume after `ticks` timer ticks
+#define ASYNC_SLEEP(op, ticks) do { \
+        (op)->resume = __LINE__; async_sleep((op), (ticks)); return ASYNC_PENDING; case __LINE__:; \
+    } while (0)
+
+// Suspend until `cond` holds, re-evaluating it whenever `ev` is signalled.
+// The check and the parking happen with interrupts off, so a signal from
+// an IRQ handler cannot be missed in between.
+#define ASYNC_WAIT_UNTIL(op, ev, cond) do { \
+        (op)->resume = __LINE__; __attribute__((fallthrough)); case __LINE__: { \
+            uint32_t async_flags_ = irq_save(); \
+            if (!(cond)) { async_wait((op), (ev)); irq_restore(async_flags_); return ASYNC_PENDING; } \
+            irq_restore(async_flags_); \
+        } \
+    } while (0)
+
+#endif // ASYNC_H
@@ -0,0 +1,212 @@
+#include "ata.h"
+#include "pci.h"
+#include "kernel.h"
+#include "cpu.h"
+#include "klog.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Task file registers, relative to the channel's command block
+#define ATA_REG_DATA    0
+#define ATA_REG_ERROR   1
+#define ATA_REG_COUNT   2
+#define ATA_REG_LBA0    3
+#define ATA_REG_LBA1    4
+#define ATA_REG_LBA2    5
+#define ATA_REG_DRIVE   6
+#define ATA_REG_STATUS  7
+#define ATA_REG_COMMAND 7
+
+#define ATA_SR_ERR  0x01
+#define ATA_SR_DRQ  0x08
+#define ATA_SR_DF   0x20
+#define ATA_SR_BSY  0x80
+
+#define ATA_CMD_READ_DMA  0xC8
+#define ATA_CMD_WRITE_DMA 0xCA
+#define ATA_CMD_IDENTIFY  0xEC
+
+#define ATA_CTL_NIEN 0x02 // device control: mask the drive's interrupt
+
+// Bus-master IDE registers, relative to the channel's BM base
+#define BM_COMMAND 0
+#define BM_STATUS  2
+#define BM_PRDT    4
+#define BM_CMD_START 0x01
+#define BM_CMD_READ  0x08 // device to memory
+#define BM_SR_ERR    0x02
+#define BM_SR_IRQ    0x04
+
+#define PRD_EOT 0x80000000u
+
+typedef struct prd {
+    uint32_t addr;
+    uint32_t len; // byte count in 15:0 (0 = 64 KB), end-of-table in bit 31
+} prd_t;
+
+typedef struct ata_channel {
+    uint16_t base, ctrl, bm;
+    int irq;
+    volatile int busy;
+    int drive; // of the command in flight
+    ata_done_fn done;
+    void *ctx;
+    prd_t prdt[ATA_MAX_SEGS] __attribute__((aligned(256))); // must not cross 64 KB
+} ata_channel_t;
+
+static ata_channel_t channels[2] = {
+    { .base = 0x1F0, .ctrl = 0x3F6, .irq = 14 },
+    { .base = 0x170, .ctrl = 0x376, .irq = 15 },
+};
+static ata_drive_info_t drives[ATA_MAX_DRIVES];
+
+static void ata_delay(ata_channel_t *ch) {
+    for (int i = 0; i < 4; ++i) inb(ch->ctrl); // ~400 ns
+}
+
+// Polling is only used while probing, before interrupts are relied upon;
+// each wait gives up after ATA_POLL_SPINS status reads
+#define ATA_POLL_SPINS 1000000
+
+static int wait_not_busy(ata_channel_t *ch) {
+    for (int i = 0; i < ATA_POLL_SPINS; ++i) {
+        uint8_t st = inb(ch->base + ATA_REG_STATUS);
+        if (!(st & ATA_SR_BSY)) return st;
+    }
+    return -1;
+}
+
+// Status once the drive has data ready or reports an error
+static int wait_drq(ata_channel_t *ch) {
+    for (int i = 0; i < ATA_POLL_SPINS; ++i) {
+        uint8_t st = inb(ch->base + ATA_REG_STATUS);
+        if (st & (ATA_SR_DRQ | ATA_SR_ERR)) return st;
+    }
+    return -1;
+}
+
+static void identify(int d) {
+    ata_channel_t *ch = &channels[d / 2];
+    ata_drive_info_t *info = &drives[d];
+    outb(ch->base + ATA_REG_DRIVE, 0xA0 | ((d & 1) << 4));
+    ata_delay(ch);
+    outb(ch->base + ATA_REG_COUNT, 0);
+    outb(ch->base + ATA_REG_LBA0, 0);
+    outb(ch->base + ATA_REG_LBA1, 0);
+    outb(ch->base + ATA_REG_LBA2, 0);
+    outb(ch->base + ATA_REG_COMMAND, ATA_CMD_IDENTIFY);
+    if (!inb(ch->base + ATA_REG_STATUS)) return; // no drive
+    int st = wait_not_busy(ch);
+    if (st < 0) return;
+    // ATAPI and SATA signatures: not an ATA disk
+    if (inb(ch->base + ATA_REG_LBA1) || inb(ch->base + ATA_REG_LBA2)) return;
+    if (!(st & (ATA_SR_DRQ | ATA_SR_ERR))) st = wait_drq(ch);
+    if (st < 0 || (st & ATA_SR_ERR)) return; // never ready: skip the drive
+    uint16_t id[256];
+    for (int i = 0; i < 256; ++i) id[i] = inw(ch->base + ATA_REG_DATA);
+    if (!(id[49] & 0x0100)) return; // no DMA support
+    info->sectors = id[60] | ((uint32_t)id[61] << 16);
+    for (int i = 0; i < 20; ++i) { // byte-swapped ASCII
+        info->model[2 * i] = id[27 + i] >> 8;
+        info->model[2 * i + 1] = id[27 + i] & 0xFF;
+    }
+    int n = 40;
+    while (n > 0 && info->model[n - 1] == ' ') n--;
+    info->model[n] = 0;
+    info->present = info->sectors != 0;
+}
+
+int ata_init(void) {
+    pci_dev_t ide;
+    if (!pci_find_class(0x01, 0x01, 0, &ide)) {
+        klog_info("ata: no PCI IDE controller");
+        return 0;
+    }
+    uint32_t bar4 = pci_read32(&ide, PCI_BAR4);
+    if (!(bar4 & 1)) {
+        klog_warn("ata: controller has no bus-master I/O window");
+        return 0;
+    }
+    pci_write16(&ide, PCI_COMMAND, pci_read16(&ide, PCI_COMMAND) | PCI_CMD_IO | PCI_CMD_MASTER);
+    channels[0].bm = (bar4 & ~3u);
+    channels[1].bm = (bar4 & ~3u) + 8;
+
+    int found = 0;
+    for (int c = 0; c < 2; ++c) {
+        ata_channel_t *ch = &channels[c];
+        if (inb(ch->base + ATA_REG_STATUS) == 0xFF) continue; // floating bus
+        outb(ch->ctrl, ATA_CTL_NIEN);
+        for (int d = 0; d < 2; ++d) {
+            identify(c * 2 + d);
+            if (drives[c * 2 + d].present) {
+                klog_info("ata%d: %s, %u MB", c * 2 + d, drives[c * 2 + d].model,
+                          drives[c * 2 + d].sectors / 2048);
+                found++;
+            }
+        }
+        inb(ch->base + ATA_REG_STATUS); // drop any interrupt raised while probing
+        outb(ch->ctrl, 0);
+        if (drives[c * 2].present || drives[c * 2 + 1].present) pic_unmask(ch->irq);
+    }
+    return found;
+}
+
+const ata_drive_info_t *ata_drive(int drive) {
+    if (drive < 0 || drive >= ATA_MAX_DRIVES || !drives[drive].present) return NULL;
+    return &drives[drive];
+}
+
+int ata_idle(int drive) {
+    return !channels[drive / 2].busy;
+}
+
+int ata_start(int drive, uint32_t lba, uint32_t count, int write,
+              void *const *segs, const uint32_t *seg_len, int nseg,
+              ata_done_fn done, void *ctx) {
+    if (!ata_drive(drive) || !count || count > ATA_MAX_SECTORS || nseg < 1 || nseg > ATA_MAX_SEGS ||
+        lba + count > drives[drive].sectors)
+        return 0;
+    ata_channel_t *ch = &channels[drive / 2];
+    uint32_t flags = irq_save();
+    if (ch->busy) {
+        irq_restore(flags);
+        return 0;
+    }
+    for (int i = 0; i < nseg; ++i) {
+        ch->prdt[i].addr = (uint32_t)segs[i];
+        ch->prdt[i].len = seg_len[i] & 0xFFFF;
+    }
+    ch->prdt[nseg - 1].len |= PRD_EOT;
+    ch->busy = 1;
+    ch->drive = drive;
+    ch->done = done;
+    ch->ctx = ctx;
+
+    outb(ch->bm + BM_COMMAND, 0);
+    outl(ch->bm + BM_PRDT, (uint32_t)ch->prdt);
+    outb(ch->bm + BM_STATUS, inb(ch->bm + BM_STATUS) | BM_SR_ERR | BM_SR_IRQ); // write-1-to-clear
+    outb(ch->bm + BM_COMMAND, write ? 0 : BM_CMD_READ);
+    outb(ch->base + ATA_REG_DRIVE, 0xE0 | ((drive & 1) << 4) | ((lba >> 24) & 0x0F));
+    ata_delay(ch);
+    outb(ch->base + ATA_REG_COUNT, count & 0xFF); // 0 means 256
+    outb(ch->base + ATA_REG_LBA0, lba & 0xFF);
+    outb(ch->base + ATA_REG_LBA1, (lba >> 8) & 0xFF);
+    outb(ch->base + ATA_REG_LBA2, (lba >> 16) & 0xFF);
+    outb(ch->base + ATA_REG_COMMAND, write ? ATA_CMD_WRITE_DMA : ATA_CMD_READ_DMA);
+    outb(ch->bm + BM_COMMAND, (write ? 0 : BM_CMD_READ) | BM_CMD_START);
+    irq_restore(flags);
+    return 1;
+}
+
+void ata_irq_handler(int channel) {
+    ata_channel_t *ch = &channels[channel];
+    uint8_t bm_status = ch->bm ? inb(ch->bm + BM_STATUS) : 0;
+    uint8_t status = inb(ch->base + ATA_REG_STATUS); // acknowledges INTRQ
+    if (!ch->busy || !(bm_status & BM_SR_IRQ)) return; // not ours
+    outb(ch->bm + BM_COMMAND, 0);
+    outb(ch->bm + BM_STATUS, bm_status | BM_SR_ERR | BM_SR_IRQ);
+    int error = (bm_status & BM_SR_ERR) || (status & (ATA_SR_ERR | ATA_SR_DF));
+    ata_done_fn done = ch->done;
+    ch->busy = 0;
+    if (done) done(ch->drive, error, ch->ctx);
+}
@@ -0,0 +1,40 @@
+#ifndef ATA_H
+#define ATA_H
+
+#include <stdint.h>
+
+// ATA disks on the PCI IDE controller, transferring with bus-master DMA.
+// Drives 0-3: primary master/slave, secondary master/slave. One command is
+// in flight per channel; completion arrives on IRQ14/IRQ15.
+#define ATA_MAX_DRIVES  4
+#define ATA_SECTOR_SIZE 512
+#define ATA_MAX_SEGS    32  // PRD entries per command
+#define ATA_MAX_SECTORS 256 // LBA28 command limit
+
+typedef struct ata_drive_info {
+    int present;
+    uint32_t sectors; // LBA28 capacity
+    char model[41];
+} ata_drive_info_t;
+
+// Completion callback, run in IRQ context with interrupts off
+typedef void (*ata_done_fn)(int drive, int error, void *ctx);
+
+// Probe the controller and drives; returns the number of drives found
+int ata_init(void);
+const ata_drive_info_t *ata_drive(int drive);
+
+// Whether the channel of `drive` can take a command now
+int ata_idle(int drive);
+
+// Start a DMA transfer of `count` sectors at `lba` scattered over `nseg`
+// physically contiguous segments (identity-mapped, 4-byte aligned, no
+// segment crossing a 64 KB boundary). Returns 0 if the channel is busy or
+// the arguments are invalid; `done` is called once the transfer ends.
+int ata_start(int drive, uint32_t lba, uint32_t count, int write,
+              void *const *segs, const uint32_t *seg_len, int nseg,
+              ata_done_fn done, void *ctx);
+
+void ata_irq_handler(int channel); // from the IRQ14/IRQ15 stubs
+
+#endif // ATA_H
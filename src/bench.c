@@ -0,0 +1,491 @@
+#include "bench.h"
+#include "kernel.h"
+#include "task.h"
+#include "cpu.h"
+#include "klib.h"
+#include "klog.h"
+#include "serial.h"
+#include "syscall.h"
+#include "usyscall.h"
+#include "vfs.h"
+#include "ipc.h"
+#include "async.h"
+#include "workqueue.h"
+#include "boottime.h"
+#include <stdint.h>
+
+extern void asm_bench_iret(void);
+
+#define BENCH_IRQ_VECTOR 0x81
+#define BENCH_MAX_HELD   6144 // pages held to raise the PMM fill level
+#define BENCH_FRAG_BLOCKS 128
+
+static uint32_t samples[BENCH_SAMPLES];
+static uint32_t held_pages[BENCH_MAX_HELD];
+static int bench_machine = 0;
+static int bench_cases = 0;
+
+static inline uint32_t cycles_since(uint64_t t0) {
+    uint64_t d = rdtsc() - t0;
+    return d > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)d;
+}
+
+static void sort_samples(int n) {
+    for (int i = 1; i < n; ++i) {
+        uint32_t v = samples[i];
+        int j = i - 1;
+        while (j >= 0 && samples[j] > v) {
+            samples[j + 1] = samples[j];
+            j--;
+        }
+        samples[j + 1] = v;
+    }
+}
+
+static void report(const char *name, int n) {
+    char line[96];
+    if (n <= 0) {
+        ksnprintf(line, sizeof(line), "%-18s skipped", name);
+        shell_println(line);
+        return;
+    }
+    sort_samples(n);
+    uint32_t p99 = samples[(n * 99) / 100 < n ? (n * 99) / 100 : n - 1];
+    ksnprintf(line, sizeof(line), "%-18s min %6u  med %6u  p99 %7u cycles",
+              name, samples[0], samples[n / 2], p99);
+    shell_println(line);
+    if (bench_machine) {
+        int len = ksnprintf(line, sizeof(line), "B %s %d %u %u %u\n",
+                            name, n, samples[0], samples[n / 2], p99);
+        serial_write_wait(line, len);
+    }
+    bench_cases++;
+}
+
+// --- Cases ---
+
+static void bench_null(void) {
+    for (int i = 0; i < BENCH_SAMPLES; ++i) {
+        uint64_t t0 = rdtsc();
+        samples[i] = cycles_since(t0);
+    }
+    report("rdtsc_overhead", BENCH_SAMPLES);
+}
+
+static volatile int partner_run = 0;
+
+static void bench_partner(void) {
+    while (partner_run) task_yield();
+}
+
+static void bench_nop(void) {
+}
+
+// Wait until `t` has run to completion; the next switch reaps its slot
+static void wait_exit(task_t *t) {
+    while (t->state != TASK_TERMINATED) task_yield();
+}
+
+static void bench_ctxswitch(void) {
+    partner_run = 1;
+    task_t *partner = task_create(bench_partner);
+    if (!partner) {
+        report("ctxswitch_rt", 0);
+        return;
+    }
+    task_set_name(partner, "bench");
+    task_yield(); // let the partner reach its loop
+    for (int i = 0; i < BENCH_SAMPLES; ++i) {
+        uint64_t t0 = rdtsc();
+        task_yield(); // over to the partner and back
+        samples[i] = cycles_since(t0);
+    }
+    partner_run = 0;
+    wait_exit(partner);
+    task_yield();
+    report("ctxswitch_rt", BENCH_SAMPLES);
+}
+
+static void bench_task(void) {
+    int n = 0;
+    for (int i = 0; i < BENCH_SAMPLES; ++i) {
+        uint64_t t0 = rdtsc();
+        task_t *t = task_create(bench_nop);
+        if (!t) break;
+        wait_exit(t);
+        samples[n++] = cycles_since(t0);
+    }
+    task_yield();
+    report("task_create_exit", n);
+}
+
+static void bench_kmalloc_sizes(const char *tag) {
+    static const int sizes[] = { 16, 256, 4096 };
+    char name[32];
+    for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        int n = 0;
+        for (int i = 0; i < BENCH_SAMPLES; ++i) {
+            uint64_t t0 = rdtsc();
+            void *p = kmalloc(sizes[s]);
+            if (!p) break;
+            kfree(p);
+            samples[n++] = cycles_since(t0);
+        }
+        ksnprintf(name, sizeof(name), "kmalloc%d_%s", sizes[s], tag);
+        report(name, n);
+    }
+}
+
+static void bench_kmalloc(void) {
+    static void *blocks[BENCH_FRAG_BLOCKS];
+    bench_kmalloc_sizes("clean");
+    // Fragment the heap: every other small block freed leaves holes that
+    // first-fit has to walk past
+    int got = 0;
+    while (got < BENCH_FRAG_BLOCKS && (blocks[got] = kmalloc(48))) got++;
+    for (int i = 0; i < got; i += 2) kfree(blocks[i]);
+    bench_kmalloc_sizes("frag");
+    for (int i = 1; i < got; i += 2) kfree(blocks[i]);
+}
+
+static void bench_pages(void) {
+    static const int fill[] = { 0, 2048, 4096, BENCH_MAX_HELD };
+    char name[32];
+    int held = 0;
+    for (unsigned f = 0; f < sizeof(fill) / sizeof(fill[0]); ++f) {
+        while (held < fill[f]) {
+            void *p = alloc_page();
+            if (!p) break;
+            held_pages[held++] = (uint32_t)p;
+        }
+        int n = 0;
+        for (int i = 0; i < BENCH_SAMPLES; ++i) {
+            uint64_t t0 = rdtsc();
+            void *p = alloc_page();
+            if (!p) break;
+            free_page(p);
+            samples[n++] = cycles_since(t0);
+        }
+        ksnprintf(name, sizeof(name), "page_held%d", held);
+        report(name, n);
+        if (held < fill[f]) break; // out of memory, higher levels unreachable
+    }
+    while (held > 0) free_page((void *)held_pages[--held]);
+}
+
+static void bench_irq(void) {
+    idt_set_gate(BENCH_IRQ_VECTOR, (uint32_t)asm_bench_iret, 0x08, 0x8E);
+    for (int i = 0; i < BENCH_SAMPLES; ++i) {
+        uint64_t t0 = rdtsc();
+        asm volatile ("int $0x81" ::: "memory");
+        samples[i] = cycles_since(t0);
+    }
+    report("irq_int_iret", BENCH_SAMPLES);
+}
+
+// SYS_NULL round trips, timed from ring 3 by user_bench()
+static void bench_syscall(void) {
+    task_t *t = task_create_user(user_bench);
+    if (!t) {
+        report("syscall_int80", 0);
+        report("syscall_sysenter", 0);
+        return;
+    }
+    wait_exit(t);
+    task_yield();
+    for (int i = 0; i < BENCH_SAMPLES; ++i) samples[i] = ubench_samples[0][i];
+    report("syscall_int80", BENCH_SAMPLES);
+    for (int i = 0; i < BENCH_SAMPLES; ++i) samples[i] = ubench_samples[1][i];
+    report("syscall_sysenter", syscall_fast_available() ? BENCH_SAMPLES : 0);
+}
+
+// Rewrites the screen with its own contents, so nothing visibly changes
+static void bench_vga(void) {
+    static uint16_t shadow[80 * 25];
+    static uint16_t saved_row[80];
+    volatile uint16_t *vga = (volatile uint16_t *)0xB8000;
+    volatile uint16_t *shadow_v = shadow; // keep the RAM stores from being folded
+    for (int i = 0; i < 80 * 25; ++i) shadow[i] = vga[i];
+    for (int c = 0; c < 80; ++c) saved_row[c] = shadow[c];
+    for (int i = 0; i < BENCH_SAMPLES; ++i) {
+        uint64_t t0 = rdtsc();
+        for (int c = 0; c < 80; ++c) vga[c] = saved_row[c];
+        samples[i] = cycles_since(t0);
+    }
+    report("vga_row_direct", BENCH_SAMPLES);
+    for (int i = 0; i < BENCH_SAMPLES; ++i) {
+        uint64_t t0 = rdtsc();
+        for (int c = 0; c < 80; ++c) shadow_v[c] = saved_row[c];
+        samples[i] = cycles_since(t0);
+    }
+    report("shadow_row", BENCH_SAMPLES);
+    for (int i = 0; i < BENCH_SAMPLES; ++i) {
+        uint64_t t0 = rdtsc();
+        memcpy((void *)vga, shadow, sizeof(shadow));
+        samples[i] = cycles_since(t0);
+    }
+    report("shadow_flush_screen", BENCH_SAMPLES);
+}
+
+// 4 KB file I/O through the VFS: appends that allocate pages, sequential
+// reads and in-place rewrites, then path lookup and create/unlink
+static void bench_ramfs(void) {
+    static uint8_t block[4096];
+    static const char *const cases[] = { "ramfs_append_4k", "ramfs_read_4k", "ramfs_rewrite_4k" };
+    for (int i = 0; i < (int)sizeof(block); ++i) block[i] = (uint8_t)i;
+    vfs_mkdir("/bench");
+    int fd = vfs_open("/bench/data", VFS_READ | VFS_WRITE | VFS_CREATE | VFS_TRUNC);
+    for (int c = 0; c < 3; ++c) {
+        int n = 0;
+        vfs_seek(fd, 0, VFS_SEEK_SET);
+        for (int i = 0; fd >= 0 && i < BENCH_SAMPLES; ++i) {
+            uint64_t t0 = rdtsc();
+            int r = c == 1 ? vfs_read(fd, block, sizeof(block)) : vfs_write(fd, block, sizeof(block));
+            if (r != sizeof(block)) break;
+            samples[n++] = cycles_since(t0);
+        }
+        report(cases[c], n);
+    }
+    if (fd >= 0) vfs_close(fd);
+
+    int n = 0;
+    if (!vfs_mkdir("/bench/a") && !vfs_mkdir("/bench/a/b") && !vfs_mkdir("/bench/a/b/c")) {
+        for (int i = 0; i < BENCH_SAMPLES; ++i) {
+            uint64_t t0 = rdtsc();
+            fd = vfs_open("/bench/a/b/c", VFS_READ);
+            if (fd < 0) break;
+            vfs_close(fd);
+            samples[n++] = cycles_since(t0);
+        }
+    }
+    report("vfs_open_depth4", n);
+    n = 0;
+    for (int i = 0; i < BENCH_SAMPLES; ++i) {
+        uint64_t t0 = rdtsc();
+        fd = vfs_open("/bench/tmp", VFS_WRITE | VFS_CREATE);
+        if (fd < 0) break;
+        vfs_close(fd);
+        vfs_unlink("/bench/tmp");
+        samples[n++] = cycles_since(t0);
+    }
+    report("ramfs_create_unlink", n);
+    vfs_unlink("/bench/a/b/c");
+    vfs_unlink("/bench/a/b");
+    vfs_unlink("/bench/a");
+    vfs_unlink("/bench/data");
+    vfs_unlink("/bench");
+}
+
+// IPC: a partner task echoes messages or pages back (round trips), then
+// drains a stream in ring-sized batches (per-message cost, bandwidth)
+#define IPC_BENCH_STOP 0x7FFFFFFFu
+#define IPC_BENCH_PAGES 32
+static ipc_chan_t ipc_to, ipc_from;
+
+static void ipc_echo_partner(void) {
+    for (;;) {
+        ipc_msg_t m;
+        ipc_recv(&ipc_to, &m);
+        if (m.tag == IPC_BENCH_STOP) break;
+        void *page = ipc_take_page(&m);
+        if (page) {
+            ipc_send_page(&ipc_from, page, m.data[1], 0); // the same page goes back
+        } else {
+            ipc_send(&ipc_from, &m);
+        }
+    }
+}
+
+static void ipc_sink_partner(void) {
+    ipc_msg_t m;
+    do ipc_recv(&ipc_to, &m); while (m.tag != IPC_BENCH_STOP);
+}
+
+static task_t *ipc_partner(void (*fn)(void)) {
+    ipc_chan_init(&ipc_to);
+    ipc_chan_init(&ipc_from);
+    task_t *t = task_create(fn);
+    if (t) task_set_name(t, "bench");
+    return t;
+}
+
+static void ipc_stop(task_t *t) {
+    ipc_msg_t stop = { .tag = IPC_BENCH_STOP };
+    ipc_send(&ipc_to, &stop);
+    wait_exit(t);
+}
+
+static uint32_t mb_per_s(uint32_t bytes, uint32_t cycles) {
+    return cycles ? (uint32_t)(div_u64((uint64_t)bytes * tsc_mhz() * 1000000, cycles) >> 20) : 0;
+}
+
+static void bench_ipc(void) {
+    static void *pages[IPC_BENCH_PAGES];
+    static uint8_t copy_dst[4096];
+    ipc_msg_t m = { .tag = 1 };
+    int n = 0;
+    task_t *t = ipc_partner(ipc_echo_partner);
+    for (int i = 0; t && i < BENCH_SAMPLES; ++i) {
+        uint64_t t0 = rdtsc();
+        ipc_send(&ipc_to, &m);
+        ipc_recv(&ipc_from, &m);
+        samples[n++] = cycles_since(t0);
+    }
+    report("ipc_msg_rt", n);
+
+    n = 0;
+    void *page = ipc_page_alloc();
+    for (int i = 0; t && page && i < BENCH_SAMPLES; ++i) {
+        uint64_t t0 = rdtsc();
+        ipc_send_page(&ipc_to, page, PMM_PAGE_SIZE, 0);
+        page = ipc_recv_page(&ipc_from, 0, 0);
+        samples[n++] = cycles_since(t0);
+    }
+    report("ipc_page_rt", n);
+    if (page) ipc_page_free(page);
+    if (t) ipc_stop(t);
+
+    // Streams: the sink drains while the ring is full, so messages move in
+    // batches and the cost per message is mostly the ring itself
+    uint32_t msg_med = 0, page_med = 0, copy_med = 0;
+    n = 0;
+    t = ipc_partner(ipc_sink_partner);
+    for (int i = 0; t && i < BENCH_SAMPLES; ++i) {
+        uint64_t t0 = rdtsc();
+        for (int k = 0; k < IPC_RING_SLOTS; ++k) ipc_send(&ipc_to, &m);
+        samples[n++] = cycles_since(t0) / IPC_RING_SLOTS;
+    }
+    report("ipc_msg_stream", n);
+    if (n) msg_med = samples[n / 2];
+    if (t) ipc_stop(t);
+
+    // Page stream: the echo partner returns each page, so a batch is a
+    // full transfer both ways with no payload copy
+    n = 0;
+    int got = 0;
+    while (got < IPC_BENCH_PAGES && (pages[got] = ipc_page_alloc())) got++;
+    t = got == IPC_BENCH_PAGES ? ipc_partner(ipc_echo_partner) : NULL;
+    for (int i = 0; t && i < BENCH_SAMPLES; ++i) {
+        uint64_t t0 = rdtsc();
+        for (int k = 0; k < IPC_BENCH_PAGES; ++k) ipc_send_page(&ipc_to, pages[k], PMM_PAGE_SIZE, 0);
+        for (int k = 0; k < IPC_BENCH_PAGES; ++k) pages[k] = ipc_recv_page(&ipc_from, 0, 0);
+        samples[n++] = cycles_since(t0) / IPC_BENCH_PAGES;
+    }
+    report("ipc_page_stream", n);
+    if (n) page_med = samples[n / 2];
+    if (t) ipc_stop(t);
+
+    // What moving the payload by copy would cost instead
+    n = 0;
+    for (int i = 0; got && i < BENCH_SAMPLES; ++i) {
+        uint64_t t0 = rdtsc();
+        memcpy(copy_dst, pages[i % got], sizeof(copy_dst));
+        samples[n++] = cycles_since(t0);
+    }
+    report("memcpy_4k", n);
+    if (n) copy_med = samples[n / 2];
+    while (got > 0) ipc_page_free(pages[--got]);
+
+    char line[96];
+    ksnprintf(line, sizeof(line), "ipc bandwidth: messages %u MB/s, pages %u MB/s (memcpy %u MB/s)",
+              mb_per_s(sizeof(ipc_msg_t), msg_med), mb_per_s(PMM_PAGE_SIZE, page_med),
+              mb_per_s(PMM_PAGE_SIZE, copy_med));
+    shell_println(line);
+}
+
+// Continuation overhead, run inline rather than on the executor task:
+// start-to-completion of an empty operation, and one suspend/resume
+static volatile int async_bench_run = 0;
+
+static int async_empty(async_op_t *op) {
+    ASYNC_BEGIN(op);
+    ASYNC_END(op);
+}
+
+static int async_yielder(async_op_t *op) {
+    ASYNC_BEGIN(op);
+    while (async_bench_run) ASYNC_YIELD(op);
+    ASYNC_END(op);
+}
+
+static void bench_async(void) {
+    async_op_t op;
+    for (int i = 0; i < BENCH_SAMPLES; ++i) {
+        uint64_t t0 = rdtsc();
+        async_start(&op, async_empty);
+        async_run_pending();
+        samples[i] = cycles_since(t0);
+    }
+    report("async_start_done", BENCH_SAMPLES);
+    async_bench_run = 1;
+    async_start(&op, async_yielder);
+    async_run_pending();
+    for (int i = 0; i < BENCH_SAMPLES; ++i) {
+        uint64_t t0 = rdtsc();
+        async_run_pending();
+        samples[i] = cycles_since(t0);
+    }
+    report("async_resume", BENCH_SAMPLES);
+    async_bench_run = 0;
+    async_run_pending();
+}
+
+// Queue-to-completion of an empty work item, run inline rather than on a
+// worker; the queue's worker pool is woken each time as in real use
+static workqueue_t bench_wq;
+static work_t bench_work;
+
+static void work_empty(void *arg) {
+    (void)arg;
+}
+
+static void bench_wq_run(void) {
+    if (!bench_wq.name) workqueue_init(&bench_wq, "bench");
+    for (int i = 0; i < BENCH_SAMPLES; ++i) {
+        uint64_t t0 = rdtsc();
+        queue_work(&bench_wq, &bench_work, work_empty, NULL);
+        workqueue_run_pending();
+        samples[i] = cycles_since(t0);
+    }
+    report("wq_queue_run", BENCH_SAMPLES);
+}
+
+static const struct {
+    const char *group;
+    void (*run)(void);
+} bench_table[] = {
+    { "null",      bench_null },
+    { "ctxswitch", bench_ctxswitch },
+    { "task",      bench_task },
+    { "kmalloc",   bench_kmalloc },
+    { "page",      bench_pages },
+    { "irq",       bench_irq },
+    { "syscall",   bench_syscall },
+    { "vga",       bench_vga },
+    { "ramfs",     bench_ramfs },
+    { "ipc",       bench_ipc },
+    { "async",     bench_async },
+    { "wq",        bench_wq_run },
+};
+
+void bench_run(const char *filter, int machine) {
+    int ran = 0;
+    bench_machine = machine;
+    bench_cases = 0;
+    if (machine) {
+        char line[64];
+        int len = ksnprintf(line, sizeof(line), "BENCH BEGIN samples=%d\n", BENCH_SAMPLES);
+        serial_write_wait(line, len);
+    }
+    // Timer preemption would land in the middle of samples; voluntary
+    // switches (the task cases) still work.
+    preempt_disable_enter();
+    for (unsigned i = 0; i < sizeof(bench_table) / sizeof(bench_table[0]); ++i) {
+        if (filter && *filter && strcmp(filter, bench_table[i].group)) continue;
+        bench_table[i].run();
+        ran++;
+    }
+    preempt_disable_exit();
+    if (machine) serial_write_wait("BENCH END\n", 10);
+    if (!ran) shell_println("usage: bench [-m] [null|ctxswitch|task|kmalloc|page|irq|syscall|vga|ramfs|ipc|async|wq]");
+}
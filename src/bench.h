@@ -0,0 +1,14 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Timed microbenchmarks behind the shell's `bench` command. Every case is
+// sampled BENCH_SAMPLES times with rdtsc and reported as min/median/p99
+// cycles per operation.
+#define BENCH_SAMPLES 256
+
+// Run the cases whose group matches `filter` (all when null or empty). With
+// `machine` set, results also go to serial between "BENCH BEGIN" and
+// "BENCH END" lines, one "B <name> <n> <min> <median> <p99>" per case.
+void bench_run(const char *filter, int machine);
+
+#endif // BENCH_H
@@ -0,0 +1,292 @@
+#include "block.h"
+#include "ata.h"
+#include "kernel.h"
+#include "task.h"
+#include "cpu.h"
+#include <stddef.h>
+#include <stdint.h>
+
+static buf_t bufs[BLOCK_NBUF];
+static int nbufs = 0;
+static buf_t *hash_table[BLOCK_HASH];
+static buf_t *lru_head = NULL, *lru_tail = NULL;
+static buf_t *io_queue[ATA_MAX_DRIVES]; // pending, sorted by block
+static buf_t *inflight[2];              // per channel, linked by io_next
+static int next_drive[2];               // alternate drives sharing a channel
+static uint32_t last_read[ATA_MAX_DRIVES];
+static uint32_t ra_next[ATA_MAX_DRIVES]; // first block not yet read ahead
+static wait_queue_t io_wait;             // I/O completions and released buffers
+static block_stats_t stats;
+
+// Everything below runs with interrupts off: the completion path touches
+// the same lists from IRQ context.
+
+static unsigned bucket(int dev, uint32_t block) {
+    return (block + (uint32_t)dev * 17) & (BLOCK_HASH - 1);
+}
+
+static buf_t *lookup(int dev, uint32_t block) {
+    for (buf_t *b = hash_table[bucket(dev, block)]; b; b = b->hash_next)
+        if (b->block == block && b->dev == dev) return b;
+    return NULL;
+}
+
+static void hash_remove(buf_t *b) {
+    if (b->dev < 0) return;
+    for (buf_t **p = &hash_table[bucket(b->dev, b->block)]; *p; p = &(*p)->hash_next) {
+        if (*p == b) {
+            *p = b->hash_next;
+            break;
+        }
+    }
+    b->hash_next = NULL;
+}
+
+static void lru_unlink(buf_t *b) {
+    if (b->lru_prev) b->lru_prev->lru_next = b->lru_next;
+    else lru_head = b->lru_next;
+    if (b->lru_next) b->lru_next->lru_prev = b->lru_prev;
+    else lru_tail = b->lru_prev;
+    b->lru_prev = b->lru_next = NULL;
+}
+
+static void lru_push_front(buf_t *b) {
+    b->lru_prev = NULL;
+    b->lru_next = lru_head;
+    if (lru_head) lru_head->lru_prev = b;
+    else lru_tail = b;
+    lru_head = b;
+}
+
+static void lru_push_back(buf_t *b) {
+    b->lru_next = NULL;
+    b->lru_prev = lru_tail;
+    if (lru_tail) lru_tail->lru_next = b;
+    else lru_head = b;
+    lru_tail = b;
+}
+
+// Find the buffer for (dev, block), recycling the least recently used idle
+// one if it is not cached. With `may_sleep` waits for a buffer to free up,
+// otherwise returns NULL when all are in use.
+static buf_t *getblk(int dev, uint32_t block, int may_sleep) {
+    for (;;) {
+        buf_t *b = lookup(dev, block);
+        if (b) return b;
+        for (b = lru_tail; b; b = b->lru_prev)
+            if (!b->refcnt && !(b->flags & B_BUSY)) break;
+        if (b) {
+            hash_remove(b);
+            b->dev = dev;
+            b->block = block;
+            b->flags = 0;
+            unsigned h = bucket(dev, block);
+            b->hash_next = hash_table[h];
+            hash_table[h] = b;
+            lru_unlink(b);
+            lru_push_front(b);
+            return b;
+        }
+        if (!may_sleep) return NULL;
+        wait_queue_sleep(&io_wait);
+    }
+}
+
+static void enqueue(buf_t *b) {
+    buf_t **p = &io_queue[b->dev];
+    while (*p && (*p)->block < b->block) p = &(*p)->io_next;
+    b->io_next = *p;
+    *p = b;
+}
+
+static void io_done(int drive, int error, void *ctx);
+
+// Start the next command on `channel` if it is idle: the head of a drive's
+// queue plus the run of consecutive blocks behind it going the same way
+static void dispatch(int channel) {
+    if (inflight[channel]) return;
+    for (int i = 0; i < 2; ++i) {
+        int dev = channel * 2 + ((next_drive[channel] + i) & 1);
+        buf_t *head = io_queue[dev];
+        if (!head) continue;
+        uint32_t dir = head->flags & B_WRITE;
+        void *segs[BLOCK_MAX_MERGE];
+        uint32_t lens[BLOCK_MAX_MERGE];
+        buf_t *last = head;
+        int n = 0;
+        segs[n] = head->data;
+        lens[n++] = BLOCK_SIZE;
+        while (n < BLOCK_MAX_MERGE && last->io_next && last->io_next->block == last->block + 1 &&
+               (last->io_next->flags & B_WRITE) == dir) {
+            last = last->io_next;
+            segs[n] = last->data;
+            lens[n++] = BLOCK_SIZE;
+        }
+        io_queue[dev] = last->io_next;
+        last->io_next = NULL;
+        inflight[channel] = head;
+        next_drive[channel] = (dev & 1) ^ 1;
+        stats.commands++;
+        stats.merged += n - 1;
+        if (!ata_start(dev, head->block * BLOCK_SECTORS, n * BLOCK_SECTORS, dir != 0,
+                       segs, lens, n, io_done, NULL))
+            io_done(dev, 1, NULL);
+        return;
+    }
+}
+
+// ATA completion, in IRQ context
+static void io_done(int drive, int error, void *ctx) {
+    (void)ctx;
+    int channel = drive / 2;
+    buf_t *b = inflight[channel];
+    inflight[channel] = NULL;
+    while (b) {
+        buf_t *next = b->io_next;
+        b->io_next = NULL;
+        if (error) {
+            b->flags = (b->flags & ~B_VALID) | B_ERROR;
+            stats.errors++;
+        } else {
+            b->flags = (b->flags & ~B_ERROR) | B_VALID;
+            if (b->flags & B_WRITE) stats.blocks_written++;
+            else stats.blocks_read++;
+        }
+        b->flags &= ~(B_BUSY | B_WRITE);
+        b = next;
+    }
+    wait_queue_wake_all(&io_wait);
+    dispatch(channel);
+}
+
+// Keep BLOCK_READAHEAD blocks queued ahead of a reader moving forward one
+// block at a time. Read-ahead never waits for a buffer.
+static void readahead(int dev, uint32_t block) {
+    int sequential = block == last_read[dev] + 1;
+    last_read[dev] = block;
+    if (!sequential) {
+        ra_next[dev] = block + 1;
+        return;
+    }
+    uint32_t end = block + 1 + BLOCK_READAHEAD;
+    if (end > block_count(dev)) end = block_count(dev);
+    uint32_t n = ra_next[dev] > block ? ra_next[dev] : block + 1;
+    // Top up only once half the window is used, so refills merge
+    if (n > block + BLOCK_READAHEAD / 2) return;
+    for (; n < end; ++n) {
+        buf_t *b = getblk(dev, n, 0);
+        if (!b) break;
+        if (!(b->flags & (B_VALID | B_BUSY))) {
+            b->flags = (b->flags & ~B_ERROR) | B_BUSY | B_RA;
+            enqueue(b);
+            stats.readahead++;
+        }
+    }
+    ra_next[dev] = n;
+}
+
+int block_init(void) {
+    if (!block_devices()) return 0;
+    for (int i = 0; i < ATA_MAX_DRIVES; ++i) last_read[i] = ~0u; // block 0 starts a stream
+    for (nbufs = 0; nbufs < BLOCK_NBUF; ++nbufs) {
+        void *page = alloc_page();
+        if (page && (uintptr_t)page + PMM_PAGE_SIZE > IDENTITY_MAP_END) { // kernel can't reach it
+            free_page(page);
+            page = NULL;
+        }
+        if (!page) break;
+        buf_t *b = &bufs[nbufs];
+        b->dev = -1;
+        b->data = PHYS_TO_VIRT(page);
+        lru_push_back(b);
+    }
+    return nbufs;
+}
+
+int block_devices(void) {
+    int n = 0;
+    for (int i = 0; i < ATA_MAX_DRIVES; ++i)
+        if (ata_drive(i)) n++;
+    return n;
+}
+
+uint32_t block_count(int dev) {
+    const ata_drive_info_t *d = ata_drive(dev);
+    return d ? d->sectors / BLOCK_SECTORS : 0;
+}
+
+buf_t *bread(int dev, uint32_t block) {
+    if (!nbufs || block >= block_count(dev)) return NULL;
+    uint32_t flags = irq_save();
+    buf_t *b = getblk(dev, block, 1);
+    b->refcnt++;
+    lru_unlink(b);
+    lru_push_front(b);
+    if (b->flags & (B_VALID | B_BUSY)) {
+        stats.hits++;
+        if (b->flags & B_RA) stats.ra_hits++;
+    } else {
+        stats.misses++;
+        b->flags = (b->flags & ~B_ERROR) | B_BUSY;
+        enqueue(b);
+    }
+    b->flags &= ~B_RA;
+    readahead(dev, block);
+    dispatch(dev / 2);
+    while (b->flags & B_BUSY) wait_queue_sleep(&io_wait);
+    irq_restore(flags);
+    if (!(b->flags & B_VALID)) {
+        brelse(b);
+        return NULL;
+    }
+    return b;
+}
+
+int bwrite(buf_t *b) {
+    uint32_t flags = irq_save();
+    while (b->flags & B_BUSY) wait_queue_sleep(&io_wait);
+    b->flags = (b->flags & ~B_ERROR) | B_BUSY | B_WRITE;
+    enqueue(b);
+    dispatch(b->dev / 2);
+    while (b->flags & B_BUSY) wait_queue_sleep(&io_wait);
+    irq_restore(flags);
+    return (b->flags & B_ERROR) ? -1 : 0;
+}
+
+void brelse(buf_t *b) {
+    if (!b) return;
+    uint32_t flags = irq_save();
+    if (--b->refcnt == 0) wait_queue_wake_all(&io_wait);
+    irq_restore(flags);
+}
+
+void block_invalidate(int dev) {
+    uint32_t flags = irq_save();
+    for (int i = 0; i < nbufs; ++i) {
+        buf_t *b = &bufs[i];
+        if (b->dev < 0 || (dev >= 0 && b->dev != dev) || b->refcnt || (b->flags & B_BUSY)) continue;
+        hash_remove(b);
+        b->dev = -1;
+        b->flags = 0;
+        lru_unlink(b);
+        lru_push_back(b);
+    }
+    for (int i = 0; i < ATA_MAX_DRIVES; ++i)
+        if (dev < 0 || dev == i) {
+            last_read[i] = ~0u;
+            ra_next[i] = 0;
+        }
+    irq_restore(flags);
+}
+
+void block_stats(block_stats_t *st) {
+    uint32_t flags = irq_save();
+    *st = stats;
+    irq_restore(flags);
+}
+
+void block_stats_reset(void) {
+    uint32_t flags = irq_save();
+    stats = (block_stats_t){0};
+    irq_restore(flags);
+}
@@ -0,0 +1,59 @@
+#ifndef BLOCK_H
+#define BLOCK_H
+
+#include <stdint.h>
+
+// Block layer over the ATA driver: 4 KB blocks in a hashed LRU buffer
+// cache. Queued requests are kept sorted per device and adjacent blocks
+// going the same way are merged into one DMA command; sequential readers
+// get read-ahead. Writes go straight through to the disk.
+#define BLOCK_SIZE      4096
+#define BLOCK_SECTORS   (BLOCK_SIZE / 512)
+#define BLOCK_NBUF      128
+#define BLOCK_HASH      64
+#define BLOCK_READAHEAD 8  // blocks queued ahead of a sequential reader
+#define BLOCK_MAX_MERGE 32 // blocks per command (one PRD entry each)
+
+#define B_VALID 0x01 // data matches the disk
+#define B_BUSY  0x02 // queued or under DMA
+#define B_ERROR 0x04 // last transfer failed
+#define B_WRITE 0x08 // pending transfer is a write
+#define B_RA    0x10 // brought in by read-ahead, not read yet
+
+typedef struct buf {
+    int dev;
+    uint32_t block;
+    volatile uint32_t flags;
+    int refcnt;
+    uint8_t *data;
+    struct buf *hash_next;
+    struct buf *lru_prev, *lru_next; // most recently used at the head
+    struct buf *io_next;             // device queue / command in flight
+} buf_t;
+
+typedef struct block_stats {
+    uint32_t hits, misses;
+    uint32_t commands, blocks_read, blocks_written;
+    uint32_t merged;    // blocks that joined a neighbour's command
+    uint32_t readahead; // blocks queued by read-ahead
+    uint32_t ra_hits;   // read-ahead blocks later asked for
+    uint32_t errors;
+} block_stats_t;
+
+int block_init(void); // returns the number of buffers
+int block_devices(void);
+uint32_t block_count(int dev); // capacity in blocks, 0 if absent
+
+// Get block `block` of `dev` with valid data, sleeping until the read
+// completes. NULL on I/O error or out of range. Release with brelse().
+buf_t *bread(int dev, uint32_t block);
+// Write a held buffer through to disk and wait; returns 0 or -1
+int bwrite(buf_t *b);
+void brelse(buf_t *b);
+
+// Drop cached, unreferenced blocks of `dev` (all devices if dev < 0)
+void block_invalidate(int dev);
+void block_stats(block_stats_t *st);
+void block_stats_reset(void);
+
+#endif // BLOCK_H
@@ -24,6 +24,11 @@ section .text
 _start:
     cli
     mov esp, stack_top
+    push ebx             ; multiboot info pointer -> kmain(magic, mbi)
+    push eax             ; multiboot magic
+    rdtsc                ; first timestamp of the boot
+    mov [boot_tsc_start], eax
+    mov [boot_tsc_start + 4], edx
     lgdt [gdt_descriptor]
     mov ax, 0x10         ; Data segment selector (2nd entry, index 2*8=0x10)
     mov ds, ax
@@ -38,11 +43,18 @@ _start:
 next:
     extern kmain
     call kmain
+    add esp, 8
     cli
 .hang:
     hlt
     jmp .hang
 
+section .data
+align 8
+global boot_tsc_start
+boot_tsc_start:
+    dq 0
+
 section .bss
 align 16
 global stack_bottom
@@ -86,6 +98,66 @@ asm_keyboard_on_interrupt:
     popa
     iret
 
+; Serial interrupt handler (IRQ4, interrupt vector 0x24)
+extern serial_interrupt_handler
+
+align 4
+global asm_serial_on_interrupt
+asm_serial_on_interrupt:
+    pusha
+    push ds
+    push es
+    push fs
+    push gs
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    call serial_interrupt_handler
+    pop gs
+    pop fs
+    pop es
+    pop ds
+    mov al, 0x20
+    out 0x20, al
+    popa
+    iret
+
+; ATA channel interrupts (IRQ14/IRQ15, vectors 0x2E/0x2F)
+extern ata_irq_handler
+
+%macro ATA_IRQ 2
+align 4
+global %1
+%1:
+    pusha
+    push ds
+    push es
+    push fs
+    push gs
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    push %2
+    call ata_irq_handler
+    add esp, 4
+    pop gs
+    pop fs
+    pop es
+    pop ds
+    mov al, 0x20
+    out 0xA0, al            ; slave first, then the cascade on the master
+    out 0x20, al
+    popa
+    iret
+%endmacro
+
+ATA_IRQ asm_ata_primary_irq, 0
+ATA_IRQ asm_ata_secondary_irq, 1
+
 align 4
 global default_handler
 default_handler:
@@ -95,6 +167,12 @@ default_handler:
     popa
     iret
 
+; Bare iret for the IRQ entry/exit benchmark (int 0x81)
+align 4
+global asm_bench_iret
+asm_bench_iret:
+    iret
+
 align 4
 global pure_asm_keyboard_handler
 pure_asm_keyboard_handler:
@@ -122,9 +200,9 @@ asm_timer_on_interrupt:
     mov es, ax
     mov fs, ax
     mov gs, ax
-    call timer_interrupt_handler
-    mov al, 0x20
-    out 0x20, al
+    push esp                ; irq_frame_t * for the C handler
+    call timer_interrupt_handler ; sends EOI itself before preempting
+    add esp, 4
     pop gs
     pop fs
     pop es
@@ -140,17 +218,36 @@ section .text
 align 4
 global asm_page_fault_handler
 asm_page_fault_handler:
-    cli
-    mov byte [0xB8000], 'F'
-    mov byte [0xB8001], 0x4F
     pusha
-    mov eax, [esp + 32] ; error code after pusha
+    push ds
+    push es
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov eax, [esp + 40] ; error code after pusha and the segment pushes
     push eax
-    call page_fault_handler
+    call page_fault_handler ; returns once the fault is resolved
     add esp, 4
+    pop es
+    pop ds
     popa
+    add esp, 4          ; drop the CPU's error code before iret
     iret
 
+; General protection fault (interrupt 0xD): never returns, the C side
+; kills the offending user task or panics
+global asm_gp_fault_handler
+extern gp_fault_handler
+asm_gp_fault_handler:
+    pusha
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    push esp                ; pusha block, then error code, eip, cs
+    call gp_fault_handler
+    cli
+    hlt
+
 global asm_double_fault_handler
 asm_double_fault_handler:
     mov byte [0xB8002], 'D'
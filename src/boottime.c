@@ -0,0 +1,66 @@
+#include "boottime.h"
+#include "kernel.h"
+#include "task.h"
+#include "cpu.h"
+#include "klog.h"
+#include <stdint.h>
+
+#define TSC_CALIBRATE_TICKS 5 // 50 ms at 100 Hz
+
+typedef struct boot_mark {
+    const char *name;
+    uint64_t tsc;
+} boot_mark_t;
+
+static boot_mark_t marks[BOOT_MAX_PHASES];
+static int nmarks = 0;
+static uint32_t tsc_per_us = 0;
+
+void boot_phase(const char *name) {
+    if (nmarks < BOOT_MAX_PHASES) {
+        marks[nmarks].name = name;
+        marks[nmarks].tsc = rdtsc();
+        nmarks++;
+    }
+}
+
+uint32_t tsc_mhz(void) {
+    if (tsc_per_us) return tsc_per_us;
+    uint32_t t = timer_ticks;
+    while (timer_ticks == t) asm volatile ("pause"); // start on a tick edge
+    uint64_t t0 = rdtsc();
+    t = timer_ticks;
+    while (timer_ticks - t < TSC_CALIBRATE_TICKS) asm volatile ("pause");
+    uint32_t mhz = (uint32_t)div_u64(rdtsc() - t0, TSC_CALIBRATE_TICKS * (1000000 / TIMER_HZ));
+    tsc_per_us = mhz ? mhz : 1;
+    return tsc_per_us;
+}
+
+void boottime_print(void (*emit)(const char *line)) {
+    char line[80];
+    uint32_t mhz = tsc_mhz();
+    ksnprintf(line, sizeof(line), "boot timeline (TSC %u MHz):", mhz);
+    emit(line);
+    uint64_t prev = boot_tsc_start;
+    for (int i = 0; i < nmarks; ++i) {
+        uint32_t at = (uint32_t)div_u64(marks[i].tsc - boot_tsc_start, mhz);
+        uint32_t took = (uint32_t)div_u64(marks[i].tsc - prev, mhz);
+        ksnprintf(line, sizeof(line), "  %8u us  +%7u us  %s", at, took, marks[i].name);
+        emit(line);
+        prev = marks[i].tsc;
+    }
+    if (shell_ready_tsc) {
+        ksnprintf(line, sizeof(line), "boot to shell: %u us",
+                  (uint32_t)div_u64(shell_ready_tsc - boot_tsc_start, mhz));
+        emit(line);
+    }
+}
+
+static void log_line(const char *line) {
+    kprintf("%s", line);
+}
+
+void boottime_task(void) {
+    while (!shell_ready_tsc) task_yield();
+    boottime_print(log_line);
+}
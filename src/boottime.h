@@ -0,0 +1,25 @@
+#ifndef BOOTTIME_H
+#define BOOTTIME_H
+
+#include <stdint.h>
+
+// Boot timeline: kmain stamps the TSC after each init phase; the origin is
+// the first instruction of _start. Printed by the `boottime` shell command
+// and logged once the shell is ready.
+#define BOOT_MAX_PHASES 24
+
+extern uint64_t boot_tsc_start; // boot.asm
+
+void boot_phase(const char *name);
+
+// TSC ticks per microsecond, measured against the PIT on first use. Needs
+// the timer interrupt running; call from task context only.
+uint32_t tsc_mhz(void);
+
+// One line per phase: time since _start and time spent in the phase
+void boottime_print(void (*emit)(const char *line));
+
+// Waits for the shell, then writes the timeline to the kernel log and exits
+void boottime_task(void);
+
+#endif // BOOTTIME_H
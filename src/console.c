@@ -0,0 +1,58 @@
+#include "console.h"
+#include "keyboard.h"
+#include "serial.h"
+#include "task.h"
+#include "cpu.h"
+
+static int console_sinks = CONSOLE_VGA | CONSOLE_SERIAL;
+static task_t *volatile input_waiter = 0;
+static volatile int input_kicked = 0;
+
+void console_set_sinks(int mask) {
+    console_sinks = mask & (CONSOLE_VGA | CONSOLE_SERIAL);
+}
+
+int console_get_sinks(void) {
+    return console_sinks;
+}
+
+void console_write(const char *str) {
+    if (!(console_sinks & CONSOLE_SERIAL)) return;
+    const char *start = str;
+    while (*str) {
+        if (*str == '\n') {
+            serial_write(start, str - start);
+            serial_write("\r\n", 2);
+            start = str + 1;
+        }
+        str++;
+    }
+    if (str != start) serial_write(start, str - start);
+}
+
+char console_getchar(void) {
+    char c = keyboard_getchar();
+    if (c) return c;
+    return serial_getchar();
+}
+
+void console_wait_input(void) {
+    uint32_t flags = irq_save();
+    if (!input_kicked && !keyboard_has_input() && !serial_has_input()) {
+        task_t *self = get_current_task();
+        input_waiter = self;
+        self->state = TASK_BLOCKED;
+        task_switch();
+    }
+    input_kicked = 0;
+    irq_restore(flags);
+}
+
+void console_kick(void) {
+    input_kicked = 1;
+    task_t *t = input_waiter;
+    if (t) {
+        input_waiter = 0;
+        task_wake(t);
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+// Console sinks (bitmask)
+#define CONSOLE_VGA    0x1
+#define CONSOLE_SERIAL 0x2
+
+void console_set_sinks(int mask);
+int console_get_sinks(void);
+
+// Stream text to the serial sink (if selected), translating \n to \r\n
+void console_write(const char *str);
+
+// Poll all input sources (keyboard first, then serial); 0 when none pending
+char console_getchar(void);
+
+// Block the calling task until input is pending or console_kick() is called.
+// console_kick() is safe from IRQ context.
+void console_wait_input(void);
+void console_kick(void);
+
+#endif // CONSOLE_H
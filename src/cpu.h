@@ -0,0 +1,104 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdint.h>
+
+// Port I/O
+static inline void outb(uint16_t port, uint8_t val) {
+    asm volatile ( "outb %0, %1" : : "a"(val), "Nd"(port) );
+}
+
+static inline uint8_t inb(uint16_t port) {
+    uint8_t val;
+    asm volatile ( "inb %1, %0" : "=a"(val) : "Nd"(port) );
+    return val;
+}
+
+static inline void outw(uint16_t port, uint16_t val) {
+    asm volatile ( "outw %0, %1" : : "a"(val), "Nd"(port) );
+}
+
+static inline uint16_t inw(uint16_t port) {
+    uint16_t val;
+    asm volatile ( "inw %1, %0" : "=a"(val) : "Nd"(port) );
+    return val;
+}
+
+static inline void outl(uint16_t port, uint32_t val) {
+    asm volatile ( "outl %0, %1" : : "a"(val), "Nd"(port) );
+}
+
+static inline uint32_t inl(uint16_t port) {
+    uint32_t val;
+    asm volatile ( "inl %1, %0" : "=a"(val) : "Nd"(port) );
+    return val;
+}
+
+// Interrupt flag save/restore for short critical sections. irq_save()
+// returns EFLAGS; EFLAGS_IF set means interrupts were on, i.e. the caller is
+// not an interrupt handler.
+#define EFLAGS_IF 0x200
+#ifdef KERNEL_HOST_TEST
+// Host-side tests run kernel modules in userspace: nothing to mask
+static inline uint32_t irq_save(void) {
+    return 0;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    (void)flags;
+}
+#else
+static inline uint32_t irq_save(void) {
+    uint32_t flags;
+    asm volatile ("pushf; pop %0; cli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    asm volatile ("push %0; popf" : : "r"(flags) : "memory", "cc");
+}
+#endif
+
+static inline void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t *a, uint32_t *b,
+                         uint32_t *c, uint32_t *d) {
+    asm volatile ("cpuid" : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d) : "0"(leaf), "2"(subleaf));
+}
+
+// Time stamp counter
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// 64-by-32 division without libgcc's __udivdi3
+static inline uint64_t div_u64(uint64_t n, uint32_t d) {
+    uint32_t hi = (uint32_t)(n >> 32), lo = (uint32_t)n, rem;
+    uint32_t q_hi = hi / d;
+    hi %= d;
+    asm ("divl %4" : "=a"(lo), "=d"(rem) : "0"(lo), "1"(hi), "rm"(d));
+    return ((uint64_t)q_hi << 32) | lo;
+}
+
+// Model-specific registers
+#define MSR_SYSENTER_CS  0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+
+static inline uint64_t rdmsr(uint32_t msr) {
+    uint32_t lo, hi;
+    asm volatile ("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t val) {
+    asm volatile ("wrmsr" : : "c"(msr), "a"((uint32_t)val), "d"((uint32_t)(val >> 32)));
+}
+
+// Uniprocessor for now; per-CPU data is indexed by this
+#define NR_CPUS 1
+static inline int cpu_id(void) {
+    return 0;
+}
+
+#endif // CPU_H
@@ -1,13 +1,13 @@
 #ifndef DEBUG_H
 #define DEBUG_H
 
-// Uncomment to enable debug prints
-#define DEBUG
+#include "kconfig.h"
 
-#ifdef DEBUG
+// Debug-only VGA output; compiles to nothing unless CONFIG_DEBUG is set
+#if CONFIG_DEBUG
 #define DEBUG_PRINT(msg, row) print_line((msg), (row))
 #else
 #define DEBUG_PRINT(msg, row) ((void)0)
 #endif
 
-#endif // DEBUG_H 
\ No newline at end of file
+#endif // DEBUG_H
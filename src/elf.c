@@ -0,0 +1,98 @@
+#include "elf.h"
+#include "vm.h"
+#include "paging.h"
+#include "task.h"
+#include "klib.h"
+#include "syscall.h"
+#include "cpu.h"
+#include <stddef.h>
+#include <stdint.h>
+
+static const elf32_phdr_t *phdr(const uint8_t *img, const elf32_ehdr_t *eh, int i) {
+    return (const elf32_phdr_t *)(img + eh->e_phoff + i * eh->e_phentsize);
+}
+
+int elf_check(const void *image, uint32_t size) {
+    const uint8_t *img = image;
+    const elf32_ehdr_t *eh = image;
+    if (size < sizeof(elf32_ehdr_t) || memcmp(img, "\x7f" "ELF", 4)) return ELF_EBADMAGIC;
+    if (img[4] != 1 || img[5] != 1 || img[6] != 1) return ELF_EBADMAGIC; // ELFCLASS32, LSB, EV_CURRENT
+    if (eh->e_type != ET_EXEC || eh->e_machine != EM_386) return ELF_ETYPE;
+    if (eh->e_phentsize < sizeof(elf32_phdr_t) || !eh->e_phnum) return ELF_ETRUNC;
+    if (eh->e_phoff > size || (uint32_t)eh->e_phnum * eh->e_phentsize > size - eh->e_phoff)
+        return ELF_ETRUNC;
+    int entry_ok = 0;
+    for (int i = 0; i < eh->e_phnum; ++i) {
+        const elf32_phdr_t *ph = phdr(img, eh, i);
+        if (ph->p_type != PT_LOAD || !ph->p_memsz) continue;
+        if (ph->p_offset > size || ph->p_filesz > size - ph->p_offset) return ELF_ETRUNC;
+        uint32_t end = ph->p_vaddr + ph->p_memsz;
+        if (ph->p_filesz > ph->p_memsz || end < ph->p_vaddr ||
+            ph->p_vaddr < USER_BASE || end > USER_STACK_TOP - USER_STACK_SIZE)
+            return ELF_ESEGMENT;
+        for (int j = 0; j < i; ++j) {
+            const elf32_phdr_t *o = phdr(img, eh, j);
+            if (o->p_type == PT_LOAD && o->p_memsz &&
+                ph->p_vaddr < o->p_vaddr + o->p_memsz && o->p_vaddr < end)
+                return ELF_ESEGMENT;
+        }
+        if ((ph->p_flags & PF_X) && eh->e_entry >= ph->p_vaddr && eh->e_entry < end) entry_ok = 1;
+    }
+    return entry_ok ? ELF_OK : ELF_EENTRY;
+}
+
+const char *elf_strerror(int err) {
+    switch (err) {
+        case ELF_OK:        return "ok";
+        case ELF_EBADMAGIC: return "not an ELF32 LSB image";
+        case ELF_ETYPE:     return "not an i386 executable";
+        case ELF_ETRUNC:    return "truncated image";
+        case ELF_ESEGMENT:  return "bad segment layout";
+        case ELF_EENTRY:    return "entry point outside code";
+        case ELF_ENOMEM:    return "out of memory";
+        default:            return "unknown error";
+    }
+}
+
+// Nothing is copied here: each PT_LOAD becomes a VMA and the page fault
+// handler fills pages on first touch, so start-up cost does not grow with
+// the size of the binary. Only the top stack page is populated, to hold
+// the entry arguments.
+int elf_exec(const void *image, uint32_t size, const char *name, elf_exec_info_t *info) {
+    const uint8_t *img = image;
+    const elf32_ehdr_t *eh = image;
+    int err = elf_check(image, size);
+    if (err) return err;
+    addr_space_t *as = vm_create();
+    if (!as) return ELF_ENOMEM;
+    for (int i = 0; i < eh->e_phnum; ++i) {
+        const elf32_phdr_t *ph = phdr(img, eh, i);
+        if (ph->p_type != PT_LOAD || !ph->p_memsz) continue;
+        int flags = ((ph->p_flags & PF_W) ? VMA_WRITE : 0) | ((ph->p_flags & PF_X) ? VMA_EXEC : 0);
+        if (!vm_map(as, ph->p_vaddr, ph->p_memsz, flags, img + ph->p_offset, ph->p_filesz))
+            goto fail;
+    }
+    if (!vm_map(as, USER_STACK_TOP - USER_STACK_SIZE, USER_STACK_SIZE, VMA_WRITE, NULL, 0))
+        goto fail;
+    uint64_t stack_frame = vm_populate(as, USER_STACK_TOP - 4);
+    if (!stack_frame) goto fail;
+    // _start(int fast_syscalls): [esp] = fake return address, [esp+4] = arg
+    uint32_t *top = kmap(stack_frame);
+    top[1023] = syscall_fast_available();
+    top[1022] = 0;
+    kunmap(top);
+    info->resident = as->resident;
+    // Name it and read its id before it can be scheduled
+    uint32_t flags = irq_save();
+    task_t *t = task_create_process(as, eh->e_entry, USER_STACK_TOP - 8);
+    if (t) {
+        task_set_name(t, name);
+        info->id = t->id;
+    }
+    irq_restore(flags);
+    if (!t) goto fail;
+    return ELF_OK;
+fail:
+    vm_destroy(as);
+    return ELF_ENOMEM;
+}
@@ -0,0 +1,50 @@
+#ifndef ELF_H
+#define ELF_H
+
+#include <stdint.h>
+#include "task.h"
+
+// Static ELF32 i386 executables, loaded from an in-memory image
+typedef struct elf32_ehdr {
+    uint8_t  e_ident[16];
+    uint16_t e_type, e_machine;
+    uint32_t e_version, e_entry, e_phoff, e_shoff, e_flags;
+    uint16_t e_ehsize, e_phentsize, e_phnum, e_shentsize, e_shnum, e_shstrndx;
+} elf32_ehdr_t;
+
+typedef struct elf32_phdr {
+    uint32_t p_type, p_offset, p_vaddr, p_paddr, p_filesz, p_memsz, p_flags, p_align;
+} elf32_phdr_t;
+
+#define ET_EXEC 2
+#define EM_386  3
+#define PT_LOAD 1
+#define PF_X 0x1
+#define PF_W 0x2
+#define PF_R 0x4
+
+#define ELF_OK         0
+#define ELF_EBADMAGIC  (-1) // not ELF, or not 32-bit little-endian v1
+#define ELF_ETYPE      (-2) // not an i386 ET_EXEC
+#define ELF_ETRUNC     (-3) // headers or segment data past the image end
+#define ELF_ESEGMENT   (-4) // segment outside the user range, overlapping, or filesz > memsz
+#define ELF_EENTRY     (-5) // entry point not in an executable segment
+#define ELF_ENOMEM     (-6)
+
+// Validate headers and every PT_LOAD segment without touching memory
+int elf_check(const void *image, uint32_t size);
+const char *elf_strerror(int err);
+
+// What elf_exec() started. The task may run, exit and be reaped before
+// elf_exec() returns, so callers get copies instead of the task itself.
+typedef struct elf_exec_info {
+    int id;
+    uint32_t resident; // pages mapped up front
+} elf_exec_info_t;
+
+// Create a task called `name` running the program. Segments are mapped
+// lazily straight from `image`, which must stay valid for the task's
+// lifetime; returns ELF_OK and fills *info, or an ELF_E* error.
+int elf_exec(const void *image, uint32_t size, const char *name, elf_exec_info_t *info);
+
+#endif // ELF_H
@@ -0,0 +1,69 @@
+#include "gdt.h"
+#include <stdint.h>
+
+#define GDT_ENTRIES 6
+
+typedef struct gdt_entry {
+    uint16_t limit_lo;
+    uint16_t base_lo;
+    uint8_t base_mid;
+    uint8_t access;
+    uint8_t gran; // flags in the high nibble, limit 19:16 in the low one
+    uint8_t base_hi;
+} __attribute__((packed)) gdt_entry_t;
+
+struct gdt_ptr {
+    uint16_t limit;
+    uint32_t base;
+} __attribute__((packed));
+
+static gdt_entry_t gdt[GDT_ENTRIES] __attribute__((aligned(8)));
+static struct gdt_ptr gdtp;
+static tss_t tss __attribute__((aligned(128))); // must not straddle a page
+
+extern char stack_top; // boot.asm
+
+static void gdt_set(int i, uint32_t base, uint32_t limit, uint8_t access, uint8_t flags) {
+    gdt[i].limit_lo = limit & 0xFFFF;
+    gdt[i].base_lo = base & 0xFFFF;
+    gdt[i].base_mid = (base >> 16) & 0xFF;
+    gdt[i].access = access;
+    gdt[i].gran = (flags & 0xF0) | ((limit >> 16) & 0x0F);
+    gdt[i].base_hi = (base >> 24) & 0xFF;
+}
+
+void gdt_init(void) {
+    gdt_set(0, 0, 0, 0, 0);
+    gdt_set(1, 0, 0xFFFFF, 0x9A, 0xC0); // kernel code, 4 GB, 32-bit
+    gdt_set(2, 0, 0xFFFFF, 0x92, 0xC0); // kernel data
+    gdt_set(3, 0, 0xFFFFF, 0xFA, 0xC0); // user code (DPL 3)
+    gdt_set(4, 0, 0xFFFFF, 0xF2, 0xC0); // user data (DPL 3)
+    tss.ss0 = GDT_KERNEL_DATA;
+    tss.esp0 = (uint32_t)&stack_top;
+    tss.iomap_base = sizeof(tss); // no I/O bitmap: ring 3 gets no port access
+    gdt_set(5, (uint32_t)&tss, sizeof(tss) - 1, 0x89, 0x00); // available 32-bit TSS
+
+    gdtp.limit = sizeof(gdt) - 1;
+    gdtp.base = (uint32_t)&gdt;
+    asm volatile (
+        "lgdt (%0)\n"
+        "mov %1, %%ds\n"
+        "mov %1, %%es\n"
+        "mov %1, %%fs\n"
+        "mov %1, %%gs\n"
+        "mov %1, %%ss\n"
+        "ljmp %2, $1f\n"
+        "1:\n"
+        "ltr %w3\n"
+        :
+        : "r"(&gdtp), "r"(GDT_KERNEL_DATA), "i"(GDT_KERNEL_CODE), "r"(GDT_TSS)
+        : "memory");
+}
+
+void tss_set_kernel_stack(uint32_t esp0) {
+    tss.esp0 = esp0;
+}
+
+uint32_t *tss_esp0_ptr(void) {
+    return &tss.esp0;
+}
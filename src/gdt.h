@@ -0,0 +1,37 @@
+#ifndef GDT_H
+#define GDT_H
+
+#include <stdint.h>
+
+// Segment selectors. The order is fixed by SYSENTER/SYSEXIT, which derive
+// the kernel SS and the user CS/SS from the kernel CS (+8, +16, +24).
+#define GDT_KERNEL_CODE 0x08
+#define GDT_KERNEL_DATA 0x10
+#define GDT_USER_CODE   0x1B // 0x18 | RPL 3
+#define GDT_USER_DATA   0x23 // 0x20 | RPL 3
+#define GDT_TSS         0x28
+
+// 32-bit task state segment; only ss0/esp0 (the stack the CPU switches to
+// on an interrupt from ring 3) are used, no hardware task switching
+typedef struct tss {
+    uint32_t prev_tss;
+    uint32_t esp0, ss0;
+    uint32_t esp1, ss1;
+    uint32_t esp2, ss2;
+    uint32_t cr3, eip, eflags;
+    uint32_t eax, ecx, edx, ebx, esp, ebp, esi, edi;
+    uint32_t es, cs, ss, ds, fs, gs;
+    uint32_t ldt;
+    uint16_t trap, iomap_base;
+} tss_t;
+
+// Replace the boot GDT with the full one (kernel, user, TSS) and load TR
+void gdt_init(void);
+
+// Kernel stack used on entry from ring 3; updated on every task switch
+void tss_set_kernel_stack(uint32_t esp0);
+
+// Address of tss.esp0, which the SYSENTER entry reads its stack from
+uint32_t *tss_esp0_ptr(void);
+
+#endif // GDT_H
@@ -0,0 +1,294 @@
+#include "heap.h"
+#include "klib.h"
+#include "kconfig.h"
+#include "cpu.h"
+#include <stdint.h>
+
+#define ALIGN8(x) (((x) + 7) & ~7)
+
+typedef struct block_header {
+    int size;
+    int free;
+    struct block_header *next;
+} block_header_t;
+
+static uint8_t *heap_base = 0;
+static block_header_t *free_list = 0;
+
+// Tasks allocate with preemption on, and the timer IRQ frees the stacks of
+// exited tasks when it switches away from them, so every walk of the list
+// (and of the tracking table) runs with interrupts off.
+
+#if CONFIG_HEAP_TRACK
+static void track_reset(void);
+#endif
+
+void heap_init_region(void *base, int size) {
+    // No up-front zeroing: only the block headers are ever read before
+    // being written, and kmalloc never promised zeroed memory
+    heap_base = (uint8_t*)base;
+    free_list = (block_header_t*)heap_base;
+    free_list->size = size - sizeof(block_header_t);
+    free_list->free = 1;
+    free_list->next = 0;
+#if CONFIG_HEAP_TRACK
+    track_reset();
+#endif
+}
+
+void heap_init(void) {
+    heap_init_region((void*)(uintptr_t)KERNEL_HEAP_START, KERNEL_HEAP_SIZE);
+}
+
+#if CONFIG_HEAP_BEST_FIT
+// Smallest free block that fits, stopping early on an exact fit
+static block_header_t *find_block(int size) {
+    block_header_t *best = 0;
+    for (block_header_t *cur = free_list; cur; cur = cur->next) {
+        if (cur->free && cur->size >= size && (!best || cur->size < best->size)) {
+            best = cur;
+            if (cur->size == size) break;
+        }
+    }
+    return best;
+}
+#else
+static block_header_t *find_block(int size) {
+    for (block_header_t *cur = free_list; cur; cur = cur->next)
+        if (cur->free && cur->size >= size) return cur;
+    return 0;
+}
+#endif
+
+static void *heap_alloc(int size) {
+    size = ALIGN8(size);
+    block_header_t *cur = find_block(size);
+    if (!cur) return 0; // Out of memory
+    if (cur->size >= size + (int)sizeof(block_header_t) + 8) { // Only split if enough space for a new block
+        block_header_t *newblk = (block_header_t*)((uint8_t*)cur + sizeof(block_header_t) + size);
+        newblk->size = cur->size - size - sizeof(block_header_t);
+        newblk->free = 1;
+        newblk->next = cur->next;
+        cur->size = size;
+        cur->next = newblk;
+    }
+    cur->free = 0;
+    return (void*)((uint8_t*)cur + sizeof(block_header_t));
+}
+
+static void heap_free(void *ptr) {
+    block_header_t *blk = (block_header_t*)((uint8_t*)ptr - sizeof(block_header_t));
+    blk->free = 1;
+    // Coalesce adjacent free blocks
+    block_header_t *cur = free_list;
+    while (cur && cur->next) {
+        if (cur->free && cur->next->free &&
+            (uint8_t*)cur + sizeof(block_header_t) + cur->size == (uint8_t*)cur->next) {
+            cur->size += sizeof(block_header_t) + cur->next->size;
+            cur->next = cur->next->next;
+        } else {
+            cur = cur->next;
+        }
+    }
+}
+
+#if CONFIG_HEAP_TRACK
+// Live allocations in an open-addressing table keyed by pointer. Kept at
+// most 3/4 full so probe chains stay short; allocations beyond that are
+// only counted.
+#define TRACK_BITS  11
+#define TRACK_SLOTS (1 << TRACK_BITS)
+#define TRACK_MASK  (TRACK_SLOTS - 1)
+#define TRACK_MAX_SITES 128
+
+typedef struct track_entry {
+    void *ptr; // NULL: empty slot
+    uintptr_t caller;
+    uint32_t size;
+    uint32_t gen;
+} track_entry_t;
+
+static track_entry_t track[TRACK_SLOTS];
+static int track_used = 0;
+static uint32_t track_gen = 0;
+static uint32_t heap_in_use = 0; // block bytes, headers included
+static heap_track_stats_t tstats;
+
+static void track_reset(void) {
+    memset(track, 0, sizeof(track));
+    memset(&tstats, 0, sizeof(tstats));
+    track_used = 0;
+    track_gen = 0;
+    heap_in_use = 0;
+}
+
+static uint32_t track_hash(const void *p) {
+    return ((uint32_t)((uintptr_t)p >> 3) * 2654435761u) >> (32 - TRACK_BITS);
+}
+
+static void track_insert(void *p, uintptr_t caller, uint32_t size) {
+    if (track_used >= TRACK_SLOTS / 4 * 3) {
+        tstats.untracked++;
+        return;
+    }
+    uint32_t i = track_hash(p);
+    while (track[i].ptr) i = (i + 1) & TRACK_MASK;
+    track[i].ptr = p;
+    track[i].caller = caller;
+    track[i].size = size;
+    track[i].gen = track_gen;
+    track_used++;
+    tstats.live_bytes += size;
+}
+
+// Returns 0 if `p` is not in the table
+static int track_remove(void *p) {
+    uint32_t i = track_hash(p);
+    while (track[i].ptr && track[i].ptr != p) i = (i + 1) & TRACK_MASK;
+    if (!track[i].ptr) return 0;
+    tstats.live_bytes -= track[i].size;
+    // Backward-shift deletion: pull later entries of the probe chain into
+    // the hole, so lookups never need tombstones
+    for (uint32_t j = (i + 1) & TRACK_MASK; track[j].ptr; j = (j + 1) & TRACK_MASK) {
+        uint32_t home = track_hash(track[j].ptr);
+        if (((j - home) & TRACK_MASK) >= ((j - i) & TRACK_MASK)) {
+            track[i] = track[j];
+            i = j;
+        }
+    }
+    track[i].ptr = 0;
+    track_used--;
+    return 1;
+}
+
+void *kmalloc(int size) {
+    uintptr_t caller = (uintptr_t)__builtin_return_address(0);
+    uint32_t flags = irq_save();
+    void *p = heap_alloc(size);
+    if (!p) {
+        tstats.failed++;
+        tstats.failed_size = size;
+        tstats.failed_caller = caller;
+        irq_restore(flags);
+        return 0;
+    }
+    heap_in_use += ((block_header_t *)p - 1)->size + sizeof(block_header_t);
+    if (heap_in_use > tstats.peak_used) tstats.peak_used = heap_in_use;
+    tstats.allocs++;
+    tstats.live_allocs++;
+    track_insert(p, caller, size);
+    irq_restore(flags);
+    return p;
+}
+
+void kfree(void *ptr) {
+    if (!ptr) return;
+    uint32_t flags = irq_save();
+    if (!track_remove(ptr)) {
+        if (!tstats.untracked) {
+            tstats.bad_frees++; // not ours: leave the heap alone
+            irq_restore(flags);
+            return;
+        }
+        tstats.untracked--;
+    }
+    heap_in_use -= ((block_header_t *)ptr - 1)->size + sizeof(block_header_t);
+    tstats.frees++;
+    tstats.live_allocs--;
+    heap_free(ptr);
+    irq_restore(flags);
+}
+
+void heap_track_stats(heap_track_stats_t *st) {
+    uint32_t flags = irq_save();
+    *st = tstats;
+    irq_restore(flags);
+}
+
+void heap_track_mark(void) {
+    track_gen++;
+}
+
+int heap_track_sites(heap_site_t *sites, int max) {
+    static heap_site_t agg[TRACK_MAX_SITES];
+    int n = 0;
+    uint32_t flags = irq_save();
+    for (int i = 0; i < TRACK_SLOTS; ++i) {
+        const track_entry_t *e = &track[i];
+        if (!e->ptr || e->gen != track_gen) continue;
+        int k = 0;
+        while (k < n && agg[k].caller != e->caller) k++;
+        if (k == n) {
+            if (n == TRACK_MAX_SITES) k = n - 1; // table full: the last site collects the rest
+            else {
+                agg[n].caller = e->caller;
+                agg[n].count = agg[n].bytes = 0;
+                n++;
+            }
+        }
+        agg[k].count++;
+        agg[k].bytes += e->size;
+    }
+    irq_restore(flags);
+    for (int i = 1; i < n; ++i) { // insertion sort, most bytes first
+        heap_site_t s = agg[i];
+        int j = i;
+        for (; j > 0 && agg[j - 1].bytes < s.bytes; --j) agg[j] = agg[j - 1];
+        agg[j] = s;
+    }
+    for (int i = 0; i < n && i < max; ++i) sites[i] = agg[i];
+    return n;
+}
+#else
+void *kmalloc(int size) {
+    uint32_t flags = irq_save();
+    void *p = heap_alloc(size);
+    irq_restore(flags);
+    return p;
+}
+
+void kfree(void *ptr) {
+    if (!ptr) return;
+    uint32_t flags = irq_save();
+    heap_free(ptr);
+    irq_restore(flags);
+}
+
+void heap_track_stats(heap_track_stats_t *st) {
+    memset(st, 0, sizeof(*st));
+}
+
+void heap_track_mark(void) {
+}
+
+int heap_track_sites(heap_site_t *sites, int max) {
+    (void)sites;
+    (void)max;
+    return 0;
+}
+#endif
+
+static int hist_bucket(int size) {
+    if (size < 16) return 0;
+    int b = 31 - __builtin_clz((uint32_t)size) - 3;
+    return b < HEAP_HIST_BUCKETS ? b : HEAP_HIST_BUCKETS - 1;
+}
+
+void heap_get_stats(heap_stats_t *st) {
+    st->blocks = st->free_blocks = 0;
+    st->used_bytes = st->free_bytes = st->largest_free = 0;
+    for (int i = 0; i < HEAP_HIST_BUCKETS; ++i) st->free_hist[i] = 0;
+    uint32_t flags = irq_save();
+    for (block_header_t *cur = free_list; cur; cur = cur->next) {
+        st->blocks++;
+        if (cur->free) {
+            st->free_blocks++;
+            st->free_bytes += cur->size;
+            st->free_hist[hist_bucket(cur->size)]++;
+            if (cur->size > st->largest_free) st->largest_free = cur->size;
+        } else {
+            st->used_bytes += cur->size;
+        }
+    }
+    irq_restore(flags);
+}
@@ -0,0 +1,55 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+// First-fit free-list allocator for the kernel heap (8-byte aligned blocks,
+// coalesced on free). Plain C, so host tests can run it on a mock region.
+// kmalloc and kfree mask interrupts, so tasks and IRQ handlers may share it.
+// CONFIG_HEAP_TRACK=1 builds an instrumented variant that records the
+// caller and size of every live allocation (see heap_track_*).
+#define KERNEL_HEAP_START 0x200000 // 2MB (moved up to avoid kernel overlap)
+#define KERNEL_HEAP_SIZE  (128 * 1024) // 128KB heap for now
+
+#include <stdint.h>
+
+void heap_init(void);
+void heap_init_region(void *base, int size);
+void *kmalloc(int size);
+void kfree(void *ptr);
+
+// Free blocks by payload size: bucket 0 is under 16 bytes, bucket i holds
+// [2^(i+3), 2^(i+4)), the last one everything larger
+#define HEAP_HIST_BUCKETS 12
+
+typedef struct heap_stats {
+    int blocks, free_blocks;
+    int used_bytes, free_bytes, largest_free;
+    int free_hist[HEAP_HIST_BUCKETS];
+} heap_stats_t;
+void heap_get_stats(heap_stats_t *st);
+
+// Instrumented mode. Without CONFIG_HEAP_TRACK the stats read as zero and
+// no sites are reported.
+typedef struct heap_track_stats {
+    uint32_t live_allocs, live_bytes; // requested sizes
+    uint32_t peak_used;        // high-water mark of heap bytes in use, headers included
+    uint32_t allocs, frees;
+    uint32_t failed;           // kmalloc calls that returned 0
+    uint32_t failed_size;      // the most recent of them
+    uintptr_t failed_caller;
+    uint32_t untracked;        // live allocations the site table had no room for
+    uint32_t bad_frees;        // kfree of a pointer kmalloc never returned
+} heap_track_stats_t;
+
+typedef struct heap_site {
+    uintptr_t caller; // return address of the kmalloc call
+    uint32_t count, bytes;
+} heap_site_t;
+
+void heap_track_stats(heap_track_stats_t *st);
+// Start a new generation: site reports only cover allocations made after it
+void heap_track_mark(void);
+// Live allocations of the current generation grouped by call site, most
+// bytes first; fills up to `max` entries and returns how many sites exist
+int heap_track_sites(heap_site_t *sites, int max);
+
+#endif // HEAP_H
@@ -0,0 +1,209 @@
+#include "initrd.h"
+#include "heap.h"
+#include "klib.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define CPIO_HEADER_LEN 110
+#define TAR_BLOCK 512
+
+static initrd_file_t *files = NULL;
+static int nfiles = 0;
+static initrd_file_t **buckets = NULL;
+static uint32_t nbuckets = 0; // power of two
+static const char *format = NULL;
+
+static uint32_t path_hash(const char *s, uint32_t len) {
+    uint32_t h = 2166136261u; // FNV-1a
+    for (uint32_t i = 0; i < len; ++i) h = (h ^ (uint8_t)s[i]) * 16777619u;
+    return h;
+}
+
+// Drop "./" and "/" prefixes and trailing slashes
+static void normalize(const char **s, uint32_t *len) {
+    for (;;) {
+        if (*len >= 2 && (*s)[0] == '.' && (*s)[1] == '/') { *s += 2; *len -= 2; }
+        else if (*len >= 1 && (*s)[0] == '/') { (*s)++; (*len)--; }
+        else break;
+    }
+    if (*len == 1 && (*s)[0] == '.') *len = 0;
+    while (*len && (*s)[*len - 1] == '/') (*len)--;
+}
+
+static uint32_t parse_num(const char *p, int digits, int base) {
+    uint32_t v = 0;
+    for (int i = 0; i < digits; ++i) {
+        char c = p[i];
+        uint32_t d;
+        if (c >= '0' && c <= '9') d = c - '0';
+        else if (c >= 'a' && c <= 'f') d = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') d = c - 'A' + 10;
+        else break; // tar pads with NUL or space
+        if (d >= (uint32_t)base) break;
+        v = v * base + d;
+    }
+    return v;
+}
+
+static uint32_t align4(uint32_t v) {
+    return (v + 3) & ~3u;
+}
+
+// Both walkers run twice: once to count entries (out == NULL), then to fill
+// the table. Return the entry count, or -1 on a malformed archive.
+static int walk_cpio(const uint8_t *img, uint32_t size, initrd_file_t *out) {
+    uint32_t off = 0;
+    int n = 0;
+    // Bounds are checked as `len > size - off`: header fields are up to
+    // 0xFFFFFFFF and `off + len` would wrap
+    while (off <= size && size - off >= CPIO_HEADER_LEN) {
+        const char *h = (const char *)img + off;
+        if (memcmp(h, "070701", 6) && memcmp(h, "070702", 6)) return -1;
+        uint32_t mode = parse_num(h + 14, 8, 16);
+        uint32_t filesize = parse_num(h + 54, 8, 16);
+        uint32_t namesize = parse_num(h + 94, 8, 16); // includes the NUL
+        if (!namesize || namesize > size - off - CPIO_HEADER_LEN) return -1;
+        const char *name = h + CPIO_HEADER_LEN;
+        uint32_t data_off = align4(off + CPIO_HEADER_LEN + namesize);
+        if (data_off > size || filesize > size - data_off) return -1;
+        if (namesize - 1 == 10 && !memcmp(name, "TRAILER!!!", 10)) return n;
+        const char *path = name;
+        uint32_t len = namesize - 1;
+        normalize(&path, &len);
+        if (len) {
+            if (out) {
+                out[n].name = path;
+                out[n].name_len = len;
+                out[n].data = img + data_off;
+                out[n].size = filesize;
+                out[n].is_dir = (mode & 0170000) == 0040000;
+            }
+            n++;
+        }
+        off = align4(data_off + filesize);
+    }
+    return -1; // no trailer
+}
+
+static int walk_tar(const uint8_t *img, uint32_t size, initrd_file_t *out) {
+    uint32_t off = 0;
+    int n = 0;
+    while (off <= size && size - off >= TAR_BLOCK) {
+        const char *h = (const char *)img + off;
+        if (!h[0]) return n; // end-of-archive blocks
+        if (memcmp(h + 257, "ustar", 5)) return -1;
+        uint32_t filesize = parse_num(h + 124, 12, 8);
+        char type = h[156];
+        if (filesize > size - off - TAR_BLOCK) return -1;
+        const char *path = h;
+        uint32_t len = 0;
+        while (len < 100 && h[len]) len++;
+        if (h[345]) {
+            // Long path split into prefix/name: the only case that is not
+            // zero-copy, since the two halves are not adjacent
+            uint32_t plen = 0;
+            while (plen < 155 && h[345 + plen]) plen++;
+            if (out) {
+                char *joined = kmalloc(plen + 1 + len);
+                if (!joined) return -1;
+                memcpy(joined, h + 345, plen);
+                joined[plen] = '/';
+                memcpy(joined + plen + 1, h, len);
+                path = joined;
+            }
+            len += plen + 1;
+        }
+        normalize(&path, &len);
+        if (len && (type == '0' || type == 0 || type == '5')) {
+            if (out) {
+                out[n].name = path;
+                out[n].name_len = len;
+                out[n].data = img + off + TAR_BLOCK;
+                out[n].size = type == '5' ? 0 : filesize;
+                out[n].is_dir = type == '5';
+            }
+            n++;
+        }
+        off += TAR_BLOCK + ((filesize + TAR_BLOCK - 1) & ~(uint32_t)(TAR_BLOCK - 1));
+    }
+    return n;
+}
+
+int initrd_init(const void *image, uint32_t size) {
+    const uint8_t *img = image;
+    int (*walk)(const uint8_t *, uint32_t, initrd_file_t *);
+    format = NULL;
+    nfiles = 0;
+    if (size >= CPIO_HEADER_LEN && !memcmp(img, "0707", 4)) {
+        walk = walk_cpio;
+        format = "cpio";
+    } else if (size >= TAR_BLOCK && !memcmp(img + 257, "ustar", 5)) {
+        walk = walk_tar;
+        format = "tar";
+    } else {
+        return -1;
+    }
+    int n = walk(img, size, NULL);
+    if (n < 0) {
+        format = NULL;
+        return -1;
+    }
+    nbuckets = 16;
+    while (nbuckets < (uint32_t)n) nbuckets <<= 1; // load factor <= 1
+    files = kmalloc((n ? n : 1) * sizeof(initrd_file_t));
+    buckets = kmalloc(nbuckets * sizeof(initrd_file_t *));
+    if (!files || !buckets || walk(img, size, files) != n) {
+        format = NULL;
+        return -1;
+    }
+    for (uint32_t b = 0; b < nbuckets; ++b) buckets[b] = NULL;
+    for (int i = 0; i < n; ++i) {
+        initrd_file_t *f = &files[i];
+        f->hash = path_hash(f->name, f->name_len);
+        f->next = buckets[f->hash & (nbuckets - 1)];
+        buckets[f->hash & (nbuckets - 1)] = f;
+    }
+    nfiles = n;
+    return n;
+}
+
+const char *initrd_format(void) {
+    return format;
+}
+
+int initrd_count(void) {
+    return nfiles;
+}
+
+const initrd_file_t *initrd_lookup(const char *path) {
+    if (!format) return NULL;
+    uint32_t len = strlen(path);
+    normalize(&path, &len);
+    uint32_t h = path_hash(path, len);
+    for (initrd_file_t *f = buckets[h & (nbuckets - 1)]; f; f = f->next)
+        if (f->hash == h && f->name_len == len && !memcmp(f->name, path, len)) return f;
+    return NULL;
+}
+
+int initrd_list(const char *dir, void (*emit)(const initrd_file_t *f, void *ctx), void *ctx) {
+    if (!format) return -1;
+    uint32_t len = strlen(dir);
+    normalize(&dir, &len);
+    // Archives need not carry entries for every directory, so a missing
+    // one is fine as long as something lives under it
+    const initrd_file_t *d = len ? initrd_lookup(dir) : NULL;
+    if (d && !d->is_dir) return -1;
+    int count = 0;
+    for (int i = 0; i < nfiles; ++i) {
+        const initrd_file_t *f = &files[i];
+        uint32_t start = len ? len + 1 : 0;
+        if (f->name_len <= start) continue;
+        if (len && (memcmp(f->name, dir, len) || f->name[len] != '/')) continue;
+        uint32_t j = start;
+        while (j < f->name_len && f->name[j] != '/') j++;
+        if (j != f->name_len) continue; // deeper down
+        emit(f, ctx);
+        count++;
+    }
+    return (len && !d && !count) ? -1 : count;
+}
@@ -0,0 +1,33 @@
+#ifndef INITRD_H
+#define INITRD_H
+
+#include <stdint.h>
+
+// Read-only initial ramdisk from a boot module (cpio "newc" or ustar tar).
+// Files are served straight out of the module's memory: the index only
+// records where each name and body already lies, so nothing is copied.
+typedef struct initrd_file {
+    const char *name;        // path without leading "./" or "/", not NUL-terminated
+    uint32_t name_len;
+    const uint8_t *data;     // points into the module
+    uint32_t size;
+    int is_dir;
+    uint32_t hash;
+    struct initrd_file *next; // hash chain
+} initrd_file_t;
+
+// Index the archive at `image`; returns the number of entries, or -1 if the
+// format is not recognised or the archive is truncated
+int initrd_init(const void *image, uint32_t size);
+
+const char *initrd_format(void); // "cpio", "tar", or 0 when not loaded
+int initrd_count(void);
+
+// Exact path lookup ("/etc/motd", "etc/motd" and "./etc/motd" are the same)
+const initrd_file_t *initrd_lookup(const char *path);
+
+// Call `emit` for each direct child of directory `dir` ("" or "/" is the
+// root). Returns the number of children, or -1 if `dir` does not exist.
+int initrd_list(const char *dir, void (*emit)(const initrd_file_t *f, void *ctx), void *ctx);
+
+#endif // INITRD_H
@@ -0,0 +1,139 @@
+#include "ipc.h"
+#include "kernel.h"
+#include "cpu.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define RING_MASK (IPC_RING_SLOTS - 1)
+
+// Owner of each IPC page by task id (truncated; 0 = not an IPC page). In
+// flight between tasks a page belongs to nobody.
+#define OWNER_NONE     0
+#define OWNER_INFLIGHT 0xFFFF
+static uint16_t page_owner[PMM_NUM_PAGES];
+
+static uint16_t owner_id(void) {
+    uint16_t id = (uint16_t)get_current_task()->id;
+    return id == OWNER_NONE || id == OWNER_INFLIGHT ? 1 : id;
+}
+
+void ipc_chan_init(ipc_chan_t *c) {
+    c->head = c->tail = 0;
+    c->producer_waiting = c->consumer_waiting = NULL;
+    c->producer = c->consumer = NULL;
+    c->send_blocks = c->recv_blocks = 0;
+    c->readable.head = c->writable.head = NULL;
+}
+
+// Wake whoever is parked in `slot`, if anyone
+static void wake_peer(task_t *volatile *slot) {
+    task_t *t = *slot;
+    if (t) {
+        *slot = NULL;
+        task_wake(t);
+    }
+}
+
+int ipc_try_send(ipc_chan_t *c, const ipc_msg_t *m) {
+    uint32_t head = c->head;
+    if (head - c->tail == IPC_RING_SLOTS) return 0;
+    c->ring[head & RING_MASK] = *m;
+    asm volatile ("" ::: "memory"); // slot contents before the index (x86 keeps store order)
+    c->head = head + 1;
+    wake_peer(&c->consumer_waiting);
+    if (c->readable.head) async_event_signal(&c->readable);
+    return 1;
+}
+
+int ipc_try_recv(ipc_chan_t *c, ipc_msg_t *m) {
+    uint32_t tail = c->tail;
+    if (tail == c->head) return 0;
+    asm volatile ("" ::: "memory"); // index before the slot contents
+    *m = c->ring[tail & RING_MASK];
+    asm volatile ("" ::: "memory");
+    c->tail = tail + 1;
+    wake_peer(&c->producer_waiting);
+    if (c->writable.head) async_event_signal(&c->writable);
+    return 1;
+}
+
+// Park the caller in `slot` unless `ready` turned true meanwhile. The
+// re-check runs with interrupts off, so the peer's wakeup cannot fall
+// between it and blocking; the CPU goes straight to `peer`.
+static void park(task_t *volatile *slot, ipc_chan_t *c, int sending, task_t *peer) {
+    uint32_t flags = irq_save();
+    task_t *self = get_current_task();
+    *slot = self;
+    int ready = sending ? c->head - c->tail < IPC_RING_SLOTS : c->head != c->tail;
+    if (ready) {
+        *slot = NULL;
+    } else {
+        self->state = TASK_BLOCKED;
+        task_switch_to(peer);
+    }
+    irq_restore(flags);
+}
+
+void ipc_send(ipc_chan_t *c, const ipc_msg_t *m) {
+    c->producer = get_current_task();
+    while (!ipc_try_send(c, m)) {
+        c->send_blocks++;
+        park(&c->producer_waiting, c, 1, c->consumer);
+    }
+}
+
+void ipc_recv(ipc_chan_t *c, ipc_msg_t *m) {
+    c->consumer = get_current_task();
+    while (!ipc_try_recv(c, m)) {
+        c->recv_blocks++;
+        park(&c->consumer_waiting, c, 0, c->producer);
+    }
+}
+
+void *ipc_page_alloc(void) {
+    void *p = alloc_page();
+    if (p && (uintptr_t)p + PMM_PAGE_SIZE > IDENTITY_MAP_END) { // must be reachable by every task
+        free_page(p);
+        return NULL;
+    }
+    if (p) page_owner[(uintptr_t)p / PMM_PAGE_SIZE] = owner_id();
+    return p;
+}
+
+static int owns(void *page) {
+    uintptr_t pa = (uintptr_t)page;
+    return !(pa & (PMM_PAGE_SIZE - 1)) && pa < PMM_TOTAL_MEM &&
+           page_owner[pa / PMM_PAGE_SIZE] == owner_id();
+}
+
+int ipc_page_free(void *page) {
+    if (!owns(page)) return -1;
+    page_owner[(uintptr_t)page / PMM_PAGE_SIZE] = OWNER_NONE;
+    free_page(page);
+    return 0;
+}
+
+int ipc_send_page(ipc_chan_t *c, void *page, uint32_t len, uint32_t tag) {
+    if (!owns(page) || len > PMM_PAGE_SIZE) return -1;
+    page_owner[(uintptr_t)page / PMM_PAGE_SIZE] = OWNER_INFLIGHT;
+    ipc_msg_t m = { .tag = tag | IPC_MSG_PAGE, .data = { (uint32_t)(uintptr_t)page, len, 0 } };
+    ipc_send(c, &m);
+    return 0;
+}
+
+void *ipc_take_page(const ipc_msg_t *m) {
+    uint32_t pa = m->data[0];
+    if (!(m->tag & IPC_MSG_PAGE) || pa >= PMM_TOTAL_MEM || page_owner[pa / PMM_PAGE_SIZE] != OWNER_INFLIGHT)
+        return NULL;
+    page_owner[pa / PMM_PAGE_SIZE] = owner_id();
+    return (void *)(uintptr_t)pa;
+}
+
+void *ipc_recv_page(ipc_chan_t *c, uint32_t *len, uint32_t *tag) {
+    ipc_msg_t m;
+    ipc_recv(c, &m);
+    void *page = ipc_take_page(&m);
+    if (page && len) *len = m.data[1];
+    if (page && tag) *tag = m.tag & ~IPC_MSG_PAGE;
+    return page;
+}
@@ -0,0 +1,64 @@
+#ifndef IPC_H
+#define IPC_H
+
+#include <stdint.h>
+#include "task.h"
+#include "async.h"
+
+// Inter-task message passing. A channel is a single-producer/single-
+// consumer ring of small fixed-size messages: each side only writes its own
+// index, so the fast path takes no lock. Blocking send/receive park the
+// caller and hand the CPU straight to the peer; the other side wakes its
+// parked peer directly when it makes progress.
+//
+// Bulk data moves as whole pages: the sender gives up a page it owns and
+// the receiver takes ownership, so the payload is never copied. The kernel
+// tracks who owns each IPC page and refuses transfers by anyone else.
+//
+// Async operations wait on a channel through its `readable`/`writable`
+// events, e.g. ASYNC_WAIT_UNTIL(op, &c->readable, ipc_try_recv(c, &m)).
+#define IPC_RING_SLOTS 64 // power of two
+
+#define IPC_MSG_PAGE 0x80000000u // tag bit: data[0] is a page, data[1] its length
+
+typedef struct ipc_msg {
+    uint32_t tag;
+    uint32_t data[3];
+} ipc_msg_t;
+
+typedef struct ipc_chan {
+    volatile uint32_t head; // next slot to fill, written by the producer only
+    volatile uint32_t tail; // next slot to drain, written by the consumer only
+    task_t *volatile producer_waiting; // parked on a full ring
+    task_t *volatile consumer_waiting; // parked on an empty ring
+    task_t *producer, *consumer;       // last tasks on each side, for handoff
+    uint32_t send_blocks, recv_blocks;
+    async_event_t readable, writable; // async waiters on either side
+    ipc_msg_t ring[IPC_RING_SLOTS];
+} ipc_chan_t;
+
+void ipc_chan_init(ipc_chan_t *c);
+
+// Non-blocking; safe from IRQ context. Return 1 on success, 0 if the ring
+// is full (send) or empty (receive).
+int ipc_try_send(ipc_chan_t *c, const ipc_msg_t *m);
+int ipc_try_recv(ipc_chan_t *c, ipc_msg_t *m);
+
+// Blocking; task context only
+void ipc_send(ipc_chan_t *c, const ipc_msg_t *m);
+void ipc_recv(ipc_chan_t *c, ipc_msg_t *m);
+
+// Pages for transfer, owned by the calling task
+void *ipc_page_alloc(void);
+int ipc_page_free(void *page); // 0, or -1 if the caller does not own it
+// Send `len` bytes in `page` with `tag`; the caller loses the page.
+// Returns -1 (nothing sent) if the caller does not own it.
+int ipc_send_page(ipc_chan_t *c, void *page, uint32_t len, uint32_t tag);
+// Take ownership of the page carried by a received message; NULL if it
+// carries none (or it was already taken)
+void *ipc_take_page(const ipc_msg_t *m);
+// Receive a message and take its page. Returns NULL, consuming the
+// message, if it was not a page.
+void *ipc_recv_page(ipc_chan_t *c, uint32_t *len, uint32_t *tag);
+
+#endif // IPC_H
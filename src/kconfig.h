@@ -0,0 +1,49 @@
+#ifndef KCONFIG_H
+#define KCONFIG_H
+
+// Compile-time feature configuration. Kernel builds force-include the
+// generated build/config.h (see the Makefile's CONFIG_* variables); these
+// defaults cover builds without it, such as the host-side tests.
+
+#ifndef CONFIG_DEBUG
+#define CONFIG_DEBUG 0 // debug output and extra checks
+#endif
+
+// Kernel log verbosity: records above this level are compiled out
+#ifndef CONFIG_LOG_LEVEL
+#define CONFIG_LOG_LEVEL 3
+#endif
+
+#ifndef CONFIG_TRACE
+#define CONFIG_TRACE 1 // static tracepoints
+#endif
+
+#ifndef CONFIG_HEAP_BEST_FIT
+#define CONFIG_HEAP_BEST_FIT 0 // kmalloc: 0 first fit, 1 best fit
+#endif
+
+#ifndef CONFIG_HEAP_TRACK
+#define CONFIG_HEAP_TRACK 0 // kmalloc records caller and size of live allocations
+#endif
+
+#ifndef CONFIG_SCHED_TIMESLICE
+#define CONFIG_SCHED_TIMESLICE 1 // timer ticks between preemptions
+#endif
+
+#ifndef CONFIG_SCHED_DL_LIMIT
+#define CONFIG_SCHED_DL_LIMIT 90 // percent of the CPU deadline tasks may reserve
+#endif
+
+#ifndef CONFIG_PROFILE
+#define CONFIG_PROFILE "custom"
+#endif
+
+#ifndef CONFIG_MAX_TASKS
+#define CONFIG_MAX_TASKS 12
+#endif
+
+#ifndef CONFIG_WQ_MAX_WORKERS
+#define CONFIG_WQ_MAX_WORKERS 4 // kernel worker tasks the workqueue pool may grow to
+#endif
+
+#endif // KCONFIG_H
@@ -3,8 +3,28 @@
 #include "keyboard.h"
 #include "task.h"
 #include "debug.h"
-
-#define DEBUG
+#include "cpu.h"
+#include "serial.h"
+#include "console.h"
+#include "klog.h"
+#include "trace.h"
+#include "prof.h"
+#include "klib.h"
+#include "bench.h"
+#include "multiboot.h"
+#include "perf.h"
+#include "boottime.h"
+#include "gdt.h"
+#include "syscall.h"
+#include "usyscall.h"
+#include "initrd.h"
+#include "vm.h"
+#include "elf.h"
+#include "ata.h"
+#include "block.h"
+#include "vfs.h"
+#include "async.h"
+#include "workqueue.h"
 
 extern void task_trampoline(void);
 
@@ -32,11 +52,6 @@ extern void default_handler(void);
 extern void exception_handler(void);
 extern void asm_timer_on_interrupt(void);
 extern void asm_page_fault_handler(void);
-extern char stack_bottom, stack_top;
-
-static inline void outb(uint16_t port, uint8_t val) {
-    asm volatile ( "outb %0, %1" : : "a"(val), "Nd"(port) );
-}
 
 void idt_set_gate(int num, uint32_t base, uint16_t sel, uint8_t flags) {
     idt[num].base_lo = base & 0xFFFF;
@@ -67,52 +82,32 @@ void pic_remap() {
     outb(0x21, 0x01);
     outb(0xA1, 0x01);
 
-    // Mask all except IRQ0 (timer) and IRQ1 (keyboard)
-    outb(0x21, 0xFC); // 11111100: IRQ0 and IRQ1 enabled
+    // Mask all except IRQ0 (timer), IRQ1 (keyboard) and IRQ4 (COM1)
+    outb(0x21, 0xEC); // 11101100: IRQ0, IRQ1 and IRQ4 enabled
     outb(0xA1, 0xFF); // all slave IRQs masked
 }
 
-// Add a local strcmp implementation for kernel use
-int strcmp(const char *a, const char *b) {
-    while (*a && (*a == *b)) {
-        a++;
-        b++;
+void pic_unmask(int irq) {
+    if (irq >= 8) {
+        outb(0xA1, inb(0xA1) & ~(1 << (irq - 8)));
+        irq = 2; // cascade
     }
-    return *(const unsigned char*)a - *(const unsigned char*)b;
-}
-
-// Add a local strlen implementation for kernel use
-int strlen(const char *s) {
-    int len = 0;
-    while (s[len]) len++;
-    return len;
-}
-
-// Add a local strncpy implementation for kernel use
-char *strncpy(char *dest, const char *src, int n) {
-    int i = 0;
-    for (; i < n && src[i]; ++i)
-        dest[i] = src[i];
-    for (; i < n; ++i)
-        dest[i] = 0;
-    return dest;
+    outb(0x21, inb(0x21) & ~(1 << irq));
 }
 
 // Make video memory pointer global for all functions
 volatile char *video = (volatile char*)0xB8000;
 
+// Rows above the kernel log status line (row 24) scroll; the log line stays put
+#define SCROLL_ROWS 24
+
 void scroll_screen() {
     // Move all lines up by one
-    for (int row = 1; row < 25; ++row) {
-        for (int col = 0; col < 80; ++col) {
-            video[((row - 1) * 80 + col) * 2] = video[(row * 80 + col) * 2];
-            video[((row - 1) * 80 + col) * 2 + 1] = video[(row * 80 + col) * 2 + 1];
-        }
-    }
+    memmove((void *)video, (const void *)(video + 80 * 2), (SCROLL_ROWS - 1) * 80 * 2);
     // Clear the last line
     for (int col = 0; col < 80; ++col) {
-        video[((24) * 80 + col) * 2] = ' ';
-        video[((24) * 80 + col) * 2 + 1] = 0x0F;
+        video[((SCROLL_ROWS - 1) * 80 + col) * 2] = ' ';
+        video[((SCROLL_ROWS - 1) * 80 + col) * 2 + 1] = 0x0F;
     }
 }
 
@@ -124,78 +119,34 @@ volatile int preempt_disable = 0;
 void preempt_disable_enter() { preempt_disable++; }
 void preempt_disable_exit() { if (preempt_disable > 0) preempt_disable--; }
 
-void timer_interrupt_handler(void) {
-    static int tick = 0;
-    tick++;
-    task_tick(); // Update sleeping tasks
-    if (tick % 25 == 0) { // Slower blink: about 2 blinks per second at 100Hz
-        cursor_visible = !cursor_visible;
-        cursor_blink_request = 1;
-    }
-    if (!preempt_disable) {
-        task_yield(); // Only yield if preemption is enabled
-    }
-}
-
-// Free-list allocator for kernel heap (with alignment and safety checks)
-#define KERNEL_HEAP_START 0x200000 // 2MB (moved up to avoid kernel overlap)
-#define KERNEL_HEAP_SIZE  (128 * 1024) // 128KB heap for now
-#define ALIGN8(x) (((x) + 7) & ~7)
-
-typedef struct block_header {
-    int size;
-    int free;
-    struct block_header *next;
-} block_header_t;
-
-static uint8_t *heap_base = (uint8_t*)KERNEL_HEAP_START;
-static block_header_t *free_list = 0;
-
-void heap_init() {
-    // Zero the heap region
-    for (int i = 0; i < KERNEL_HEAP_SIZE; ++i)
-        heap_base[i] = 0;
-    free_list = (block_header_t*)heap_base;
-    free_list->size = KERNEL_HEAP_SIZE - sizeof(block_header_t);
-    free_list->free = 1;
-    free_list->next = 0;
-}
-
-void *kmalloc(int size) {
-    size = ALIGN8(size);
-    block_header_t *cur = free_list;
-    while (cur) {
-        if (cur->free && cur->size >= size) {
-            if (cur->size >= size + (int)sizeof(block_header_t) + 8) { // Only split if enough space for a new block
-                block_header_t *newblk = (block_header_t*)((uint8_t*)cur + sizeof(block_header_t) + size);
-                newblk->size = cur->size - size - sizeof(block_header_t);
-                newblk->free = 1;
-                newblk->next = cur->next;
-                cur->size = size;
-                cur->next = newblk;
-            }
-            cur->free = 0;
-            return (void*)((uint8_t*)cur + sizeof(block_header_t));
-        }
-        cur = cur->next;
-    }
-    return 0; // Out of memory
-}
-
-void kfree(void *ptr) {
-    if (!ptr) return;
-    block_header_t *blk = (block_header_t*)((uint8_t*)ptr - sizeof(block_header_t));
-    blk->free = 1;
-    // Coalesce adjacent free blocks
-    block_header_t *cur = free_list;
-    while (cur && cur->next) {
-        if (cur->free && cur->next->free &&
-            (uint8_t*)cur + sizeof(block_header_t) + cur->size == (uint8_t*)cur->next) {
-            cur->size += sizeof(block_header_t) + cur->next->size;
-            cur->next = cur->next->next;
-        } else {
-            cur = cur->next;
-        }
+volatile uint32_t timer_ticks = 0;
+volatile uint64_t shell_ready_tsc = 0;
+
+// Cursor blink, about twice a second at 100 Hz; a delayed work item that
+// requeues itself
+static work_t blink_work;
+
+static void cursor_blink(void *arg) {
+    cursor_visible = !cursor_visible;
+    cursor_blink_request = 1;
+    uint32_t flags = irq_save(); // console_kick also runs from IRQ handlers
+    console_kick();
+    irq_restore(flags);
+    queue_delayed_work(&system_wq, &blink_work, cursor_blink, arg, 25);
+}
+
+void timer_interrupt_handler(irq_frame_t *frame) {
+    uint32_t tick = timer_ticks;
+    TRACE(TRACE_IRQ_ENTRY, 0x20, tick);
+    prof_sample(frame);
+    timer_ticks = ++tick;
+    int resched = task_tick(); // Update sleeping and deadline tasks
+    async_tick(tick); // and expire async timers
+    workqueue_tick(tick); // and delayed work
+    TRACE(TRACE_IRQ_EXIT, 0x20, 0);
+    outb(0x20, 0x20); // EOI before a possible switch so other IRQs keep flowing
+    if (!preempt_disable && (resched || tick % CONFIG_SCHED_TIMESLICE == 0)) {
+        task_preempt(); // Only preempt if preemption is enabled
     }
 }
 
@@ -213,95 +164,614 @@ void print_line(const char *str, int row);
 void clear_screen();
 void print_at(const char *str, int row, int col);
 
-// --- Physical Memory Manager (PMM) ---
-#define PMM_TOTAL_MEM (32 * 1024 * 1024) // 32MB for demo
-#define PMM_PAGE_SIZE 4096
-#define PMM_NUM_PAGES (PMM_TOTAL_MEM / PMM_PAGE_SIZE)
-#define PMM_BITMAP_SIZE (PMM_NUM_PAGES / 8)
-static uint8_t pmm_bitmap[PMM_BITMAP_SIZE];
+// A fault raised by ring 3 kills the task instead of the kernel
+static void user_fault_kill(const char *what, uint32_t addr) {
+    task_t *t = get_current_task();
+    klog_warn("%s in user task %d at %08X, killed", what, t->id, addr);
+    task_exit();
+}
+
+void page_fault_handler(uint32_t err_code) {
+    uint32_t fault_addr;
+    asm volatile ("mov %%cr2, %0" : "=r"(fault_addr));
+    TRACE(TRACE_PAGE_FAULT, fault_addr, err_code);
+    // Demand paging, also for the kernel touching user memory in a syscall
+    task_t *cur = get_current_task();
+    if (cur && cur->as && fault_addr >= USER_BASE && vm_fault(cur->as, fault_addr, err_code)) return;
+    if (err_code & 0x4) user_fault_kill("page fault", fault_addr);
+    char buf[80];
+    ksnprintf(buf, sizeof(buf), "Page fault at %08X err: %08X", fault_addr, err_code);
+    kprintf("%s", buf);
+    kernel_panic(buf);
+}
+
+// regs: pusha block, then the CPU's error code, eip and cs
+void gp_fault_handler(uint32_t *regs) {
+    uint32_t err = regs[8], eip = regs[9], cs = regs[10];
+    if (cs & 3) user_fault_kill("protection fault", eip);
+    char buf[80];
+    ksnprintf(buf, sizeof(buf), "General protection fault at %08X err: %08X", eip, err);
+    kprintf("%s", buf);
+    kernel_panic(buf);
+}
 
-void pmm_init() {
-    for (int i = 0; i < PMM_BITMAP_SIZE; ++i) pmm_bitmap[i] = 0;
-    // Mark pages used by kernel and heap as allocated
-    int kernel_pages = KERNEL_HEAP_START / PMM_PAGE_SIZE;
-    int heap_pages = (KERNEL_HEAP_START + KERNEL_HEAP_SIZE) / PMM_PAGE_SIZE;
-    for (int i = 0; i < heap_pages; ++i) {
-        pmm_bitmap[i / 8] |= (1 << (i % 8));
+// Current shell output row on the VGA text screen
+static int screen_row = 0;
+
+// Shell output reaches the screen only while VGA is a console sink
+static int shell_vga(void) {
+    return console_get_sinks() & CONSOLE_VGA;
+}
+
+// Advance to the next shell row, scrolling the screen once the bottom is reached
+static void shell_newline(void) {
+    if (screen_row >= SCROLL_ROWS - 1) {
+        if (shell_vga()) scroll_screen();
+        screen_row = SCROLL_ROWS - 2;
     }
+    ++screen_row;
 }
 
-void *alloc_page() {
-    for (int i = 0; i < PMM_NUM_PAGES; ++i) {
-        if (!(pmm_bitmap[i / 8] & (1 << (i % 8)))) {
-            pmm_bitmap[i / 8] |= (1 << (i % 8));
-            return (void *)(i * PMM_PAGE_SIZE);
+// Print a line of shell output on the next row and mirror it to serial
+void shell_println(const char *str) {
+    shell_newline();
+    if (shell_vga()) print_line(str, screen_row);
+    if (console_get_sinks() & CONSOLE_SERIAL) {
+        console_write(str);
+        console_write("\n");
+    }
+}
+
+// Per-mille share of part in whole without 64-bit division
+static uint32_t permille(uint64_t part, uint64_t whole) {
+    while (whole > 0x3FFFFF) { whole >>= 1; part >>= 1; }
+    if (!whole) return 0;
+    if (part > whole) part = whole;
+    return (uint32_t)part * 1000 / (uint32_t)whole;
+}
+
+#define TOP_MAX_TASKS 16
+
+typedef struct {
+    task_t *task;
+    int id;
+    uint64_t run;
+    uint64_t wait;
+} top_snap_t;
+
+static int top_snapshot(top_snap_t *snap, uint64_t now) {
+    int n = 0;
+    uint32_t flags = irq_save();
+    for (task_t *t = task_list(); t && n < TOP_MAX_TASKS; t = t->next, ++n) {
+        snap[n].task = t;
+        snap[n].id = t->id;
+        snap[n].run = t->run_cycles;
+        snap[n].wait = t->wait_cycles;
+        if (t == get_current_task()) snap[n].run += now - t->last_switch_in;
+    }
+    irq_restore(flags);
+    return n;
+}
+
+static void top_row(const char *str, int row) {
+    char line[81];
+    int i = 0;
+    for (; i < 80 && str[i]; ++i) line[i] = str[i];
+    for (; i < 80; ++i) line[i] = ' ';
+    line[80] = 0;
+    if (shell_vga()) print_line(line, row);
+    if (console_get_sinks() & CONSOLE_SERIAL) {
+        console_write(str);
+        console_write("\x1b[K\n");
+    }
+}
+
+// Live per-task CPU view, refreshed every second until a key is pressed
+static void shell_top(void) {
+    static top_snap_t prev[TOP_MAX_TASKS], cur[TOP_MAX_TASKS];
+    char line[96];
+    uint64_t t0 = rdtsc();
+    int nprev = top_snapshot(prev, t0);
+    if (shell_vga()) clear_screen();
+    while (1) {
+        for (int i = 0; i < 10; ++i) {
+            task_sleep(10);
+            if (console_getchar()) {
+                if (shell_vga()) clear_screen();
+                screen_row = 0;
+                return;
+            }
+        }
+        uint64_t now = rdtsc();
+        int ncur = top_snapshot(cur, now);
+        uint64_t total = now - t0;
+        uint32_t idle = 0;
+        task_t *idle_task_ptr = task_get_idle();
+        for (int i = 0; i < ncur; ++i) {
+            uint64_t run0 = 0;
+            for (int j = 0; j < nprev; ++j)
+                if (prev[j].task == cur[i].task && prev[j].id == cur[i].id) run0 = prev[j].run;
+            if (cur[i].task == idle_task_ptr) idle = permille(cur[i].run - run0, total);
         }
+        if (console_get_sinks() & CONSOLE_SERIAL) console_write("\x1b[H");
+        ksnprintf(line, sizeof(line), "top - %d tasks, idle %u.%u%%, %u Mcycles/s  (any key quits)",
+                  ncur, idle / 10, idle % 10, (uint32_t)div_u64(total, 1000000));
+        top_row(line, 0);
+        top_row("  ID NAME         ST   CPU%    VOL  INVOL  WAIT%  MAXLAT(kcyc)", 2);
+        int row = 3;
+        for (int i = 0; i < ncur && row < 24; ++i, ++row) {
+            task_t *t = cur[i].task;
+            uint64_t run0 = 0, wait0 = 0;
+            for (int j = 0; j < nprev; ++j) {
+                if (prev[j].task == t && prev[j].id == cur[i].id) {
+                    run0 = prev[j].run;
+                    wait0 = prev[j].wait;
+                }
+            }
+            uint32_t cpu = permille(cur[i].run - run0, total);
+            uint32_t wait = permille(cur[i].wait - wait0, total);
+            char st = '?';
+            if (t == get_current_task()) st = 'R';
+            else if (t->state == TASK_READY) st = 'D';
+            else if (t->state == TASK_SLEEPING) st = 'S';
+            else if (t->state == TASK_BLOCKED) st = 'B';
+            else if (t->state == TASK_TERMINATED) st = 'T';
+            ksnprintf(line, sizeof(line), "%4d %-12s  %c  %3u.%u %6u %6u  %3u.%u  %12u",
+                      t->id, t->name ? t->name : "-", st, cpu / 10, cpu % 10,
+                      t->vol_switches, t->invol_switches, wait / 10, wait % 10,
+                      (uint32_t)div_u64(t->max_latency, 1000));
+            top_row(line, row);
+        }
+        for (; row < 24 && shell_vga(); ++row) print_line("                                                                                ", row);
+        if (console_get_sinks() & CONSOLE_SERIAL) console_write("\x1b[J");
+        for (int i = 0; i < ncur; ++i) prev[i] = cur[i];
+        nprev = ncur;
+        t0 = now;
     }
-    return 0; // Out of memory
 }
 
-void free_page(void *addr) {
-    int i = ((uint32_t)addr) / PMM_PAGE_SIZE;
-    pmm_bitmap[i / 8] &= ~(1 << (i % 8));
+// `dl` lists deadline tasks with their miss counts; `dl <id> <runtime>
+// <period> [deadline]` (ticks, deadline defaults to the period) changes a
+// task's class, and `dl <id> 0` returns it to best effort
+static void shell_dl(const char *args) {
+    char line[96];
+    if (args && *args) {
+        char *end;
+        int id = (int)strtoul(args, &end, 0);
+        uint32_t runtime = strtoul(end, &end, 0);
+        uint32_t period = strtoul(end, &end, 0);
+        uint32_t deadline = strtoul(end, &end, 0);
+        if (!deadline) deadline = period;
+        task_t *t = task_list();
+        while (t && (t->id != id || t->state == TASK_TERMINATED)) t = t->next;
+        int rc = t ? task_set_deadline(t, runtime, deadline, period) : -1;
+        if (!t) shell_println("dl: no such task");
+        else if (rc == -1) shell_println("dl: need runtime <= deadline <= period");
+        else if (rc == -2) shell_println("dl: rejected, would exceed the deadline bandwidth limit");
+    }
+    uint32_t util = task_dl_utilization();
+    uint32_t mhz = tsc_mhz();
+    ksnprintf(line, sizeof(line), "deadline tasks: %u.%u%% of %u%% reserved, tick %u ms",
+              util / 10, util % 10, CONFIG_SCHED_DL_LIMIT, 1000 / TIMER_HZ);
+    shell_println(line);
+    shell_println("  ID NAME         RUN  DL   PERIOD  JOBS   MISSES THROTTLED MAXRESP(us)");
+    for (task_t *t = task_list(); t; t = t->next) {
+        if (!t->dl_period || t->state == TASK_TERMINATED) continue;
+        uint32_t resp = mhz ? (uint32_t)div_u64(t->dl_max_response, mhz) : 0;
+        ksnprintf(line, sizeof(line), "%4d %-12s %3u %4u %6u %6u %8u %9u %11u",
+                  t->id, t->name ? t->name : "-", t->dl_runtime, t->dl_deadline, t->dl_period,
+                  t->dl_jobs, t->dl_misses, t->dl_throttles, resp);
+        shell_println(line);
+    }
 }
 
-// --- Paging Structures ---
-#define PAGE_PRESENT 0x1
-#define PAGE_RW      0x2
-#define PAGE_SIZE    4096
-#define PAGE_ENTRIES 1024
+// meminfo [mark|leaks]: heap usage and fragmentation, plus call-site
+// tracking when built with CONFIG_HEAP_TRACK=1. `mark` starts a new
+// generation; `leaks` lists what was allocated since and is still live.
+// Callers are return addresses, for addr2line against kernel.elf.
+static void shell_meminfo(const char *args) {
+    char line[160];
+    heap_stats_t st;
+    heap_get_stats(&st);
+    int frag = st.free_bytes ? 100 - (int)((uint32_t)st.largest_free * 100 / st.free_bytes) : 0;
+    ksnprintf(line, sizeof(line), "heap: %d used, %d free in %d/%d blocks, largest %d, %d%% fragmented",
+              st.used_bytes, st.free_bytes, st.free_blocks, st.blocks, st.largest_free, frag);
+    shell_println(line);
+    int pos = ksnprintf(line, sizeof(line), "free sizes:");
+    for (int i = 0; i < HEAP_HIST_BUCKETS; ++i) {
+        if (!st.free_hist[i]) continue;
+        if (i == HEAP_HIST_BUCKETS - 1)
+            pos += ksnprintf(line + pos, sizeof(line) - pos, " >=%u:%d", 16u << (i - 1), st.free_hist[i]);
+        else
+            pos += ksnprintf(line + pos, sizeof(line) - pos, " <%u:%d", 16u << i, st.free_hist[i]);
+        if (pos >= (int)sizeof(line) - 1) break;
+    }
+    shell_println(line);
+    if (!CONFIG_HEAP_TRACK) {
+        shell_println("meminfo: built without CONFIG_HEAP_TRACK=1, no call-site data");
+        return;
+    }
+    heap_track_stats_t ts;
+    heap_track_stats(&ts);
+    ksnprintf(line, sizeof(line), "tracked: %u live (%u bytes), peak %u, %u allocs, %u frees",
+              ts.live_allocs, ts.live_bytes, ts.peak_used, ts.allocs, ts.frees);
+    shell_println(line);
+    ksnprintf(line, sizeof(line), "  %u failed (last %u bytes from %08X), %u untracked, %u bad frees",
+              ts.failed, ts.failed_size, (uint32_t)ts.failed_caller, ts.untracked, ts.bad_frees);
+    shell_println(line);
+    if (args && !strcmp(args, "mark")) {
+        heap_track_mark();
+        shell_println("meminfo: new generation started");
+    } else if (args && !strcmp(args, "leaks")) {
+        heap_site_t sites[16];
+        int n = heap_track_sites(sites, 16);
+        shell_println("  CALLER     COUNT    BYTES");
+        for (int i = 0; i < n && i < 16; ++i) {
+            ksnprintf(line, sizeof(line), "  %08X %6u %8u", (uint32_t)sites[i].caller, sites[i].count, sites[i].bytes);
+            shell_println(line);
+        }
+        if (n > 16) {
+            ksnprintf(line, sizeof(line), "  ... %d more sites", n - 16);
+            shell_println(line);
+        }
+    }
+}
 
-// Page directory and one page table (identity map first 4MB)
-__attribute__((aligned(4096))) static uint32_t page_directory[PAGE_ENTRIES];
-__attribute__((aligned(4096))) static uint32_t first_page_table[PAGE_ENTRIES];
+// Report the paging mode, then write a pattern to a frame from the PMM
+// (above the identity map when there is memory there) through one kmap
+// and check it through another
+static void shell_paging_test(void) {
+    char line[96];
+    uint32_t total, avail;
+    pmm_high_stats(&total, &avail);
+    ksnprintf(line, sizeof(line), "Paging is enabled: %s tables, NX %s, %u-bit physical, %u/%u high frames free",
+              paging_pae() ? "PAE" : "32-bit", paging_nx() ? "on" : "off",
+              (uint32_t)__builtin_ctzll(paging_max_phys()), avail, total);
+    shell_println(line);
+    uint64_t pa = pmm_alloc_frame();
+    if (!pa) {
+        shell_println("pagingtest: out of memory");
+        return;
+    }
+    uint32_t *p = kmap(pa);
+    for (uint32_t i = 0; i < PMM_PAGE_SIZE / 4; ++i) p[i] = i * 2654435761u ^ (uint32_t)pa;
+    kunmap(p);
+    uint32_t *q = kmap(pa);
+    int bad = 0;
+    for (uint32_t i = 0; i < PMM_PAGE_SIZE / 4; ++i) bad += q[i] != (i * 2654435761u ^ (uint32_t)pa);
+    kunmap(q);
+    pmm_free_frame(pa);
+    ksnprintf(line, sizeof(line), "kmap: frame at %u KB mapped at %p: %s", (uint32_t)(pa >> 10), q,
+              bad ? "MISMATCH" : "ok");
+    shell_println(line);
+}
 
-#define NUM_IDENTITY_TABLES 4
-__attribute__((aligned(4096))) static uint32_t extra_page_tables[NUM_IDENTITY_TABLES-1][PAGE_ENTRIES];
+static void ls_entry(const initrd_file_t *f, void *ctx) {
+    (void)ctx;
+    char name[64], line[80];
+    uint32_t base = f->name_len;
+    while (base && f->name[base - 1] != '/') base--;
+    uint32_t len = f->name_len - base; // names are not NUL-terminated
+    if (len > sizeof(name) - 1) len = sizeof(name) - 1;
+    memcpy(name, f->name + base, len);
+    name[len] = 0;
+    ksnprintf(line, sizeof(line), "%8u  %s%s", f->size, name, f->is_dir ? "/" : "");
+    shell_println(line);
+}
 
-void paging_init() {
-    // Identity map first 16MB (4 page tables)
-    for (int t = 0; t < NUM_IDENTITY_TABLES; ++t) {
-        uint32_t *pt = (t == 0) ? first_page_table : extra_page_tables[t-1];
-        for (int i = 0; i < PAGE_ENTRIES; ++i)
-            pt[i] = ((t * PAGE_ENTRIES + i) * PAGE_SIZE) | PAGE_PRESENT | PAGE_RW;
-        page_directory[t] = ((uint32_t)pt) | PAGE_PRESENT | PAGE_RW;
+// The RAM filesystem is listed first, then the initrd directory of the
+// same name, if any
+static void shell_ls(const char *dir) {
+    int found = 0;
+    int fd = vfs_open(dir ? dir : "/", VFS_READ);
+    if (fd >= 0) {
+        vfs_dirent_t e;
+        char line[80];
+        int r;
+        while ((r = vfs_readdir(fd, &e)) > 0) {
+            ksnprintf(line, sizeof(line), "%8u  %s%s", e.size, e.name, e.is_dir ? "/" : "");
+            shell_println(line);
+        }
+        vfs_close(fd);
+        if (r == VFS_ENOTDIR) {
+            shell_println("ls: not a directory");
+            return;
+        }
+        found = 1;
     }
-    // Map the stack pages (in case stack is not within first 16MB, ensure mapped)
-    uint32_t stack_start = (uint32_t)&stack_bottom;
-    uint32_t stack_end = (uint32_t)&stack_top;
-    for (uint32_t addr = stack_start & ~(PAGE_SIZE-1); addr < stack_end; addr += PAGE_SIZE) {
-        int pd_idx = addr / (PAGE_ENTRIES * PAGE_SIZE);
-        int pt_idx = (addr / PAGE_SIZE) % PAGE_ENTRIES;
-        uint32_t *pt = (pd_idx == 0) ? first_page_table : extra_page_tables[pd_idx-1];
-        pt[pt_idx] = (addr & 0xFFFFF000) | PAGE_PRESENT | PAGE_RW;
+    if (initrd_format() && initrd_list(dir ? dir : "", ls_entry, 0) >= 0) found = 1;
+    if (!found) shell_println("ls: no such directory");
+}
+
+// Line splitter for `cat`: wraps at 80 columns, masks control characters
+typedef struct cat_state {
+    char line[81];
+    int n;
+} cat_state_t;
+
+static void cat_feed(cat_state_t *st, const uint8_t *data, uint32_t len) {
+    for (uint32_t i = 0; i < len; ++i) {
+        char c = (char)data[i];
+        if (c == '\n' || st->n == 80) {
+            st->line[st->n] = 0;
+            shell_println(st->line);
+            st->n = 0;
+            if (c == '\n') continue;
+        }
+        st->line[st->n++] = (c == '\t' || (c >= ' ' && c < 127)) ? c : '.';
     }
-    for (int i = NUM_IDENTITY_TABLES; i < PAGE_ENTRIES; ++i)
-        page_directory[i] = 0;
-    // Load page directory
-    asm volatile ("mov %0, %%cr3" : : "r"(page_directory));
-    // Enable paging
-    uint32_t cr0;
-    asm volatile ("mov %%cr0, %0" : "=r"(cr0));
-    cr0 |= 0x80000000;
-    asm volatile ("mov %0, %%cr0" : : "r"(cr0));
 }
 
-void page_fault_handler(uint32_t err_code) {
-    uint32_t fault_addr;
-    asm volatile ("mov %%cr2, %0" : "=r"(fault_addr));
-    char buf[80], haddr[9];
-    hex_to_str(fault_addr, haddr);
-    int pos = 0;
-    for (const char *s = "Page fault at "; *s; ++s) buf[pos++] = *s;
-    for (int i = 0; i < 8; ++i) buf[pos++] = haddr[i];
-    buf[pos++] = ' ';
-    for (const char *s = "err: "; *s; ++s) buf[pos++] = *s;
-    // Print error code as hex
-    for (int i = 7; i >= 0; --i) buf[pos++] = "0123456789ABCDEF"[(err_code >> (i*4)) & 0xF];
-    buf[pos] = 0;
-    print_line(buf, 22);
-    // Halt the system
-    while (1) { asm volatile ("cli; hlt"); }
+// RAM filesystem files are read through the VFS; initrd files are printed
+// straight from the module's pages
+static void shell_cat(const char *path) {
+    cat_state_t st = { .n = 0 };
+    if (!path) {
+        shell_println("usage: cat <file>");
+        return;
+    }
+    int fd = vfs_open(path, VFS_READ);
+    if (fd >= 0) {
+        uint8_t chunk[256];
+        int r;
+        while ((r = vfs_read(fd, chunk, sizeof(chunk))) > 0) cat_feed(&st, chunk, r);
+        vfs_close(fd);
+        if (r < 0) {
+            char buf[80];
+            ksnprintf(buf, sizeof(buf), "cat: %s", vfs_strerror(r));
+            shell_println(buf);
+            return;
+        }
+    } else {
+        const initrd_file_t *f = initrd_lookup(path);
+        if (!f || f->is_dir) {
+            shell_println("cat: no such file");
+            return;
+        }
+        cat_feed(&st, f->data, f->size);
+    }
+    if (st.n) {
+        st.line[st.n] = 0;
+        shell_println(st.line);
+    }
+}
+
+static void shell_vfs_error(const char *cmd, int err) {
+    char buf[80];
+    ksnprintf(buf, sizeof(buf), "%s: %s", cmd, vfs_strerror(err));
+    shell_println(buf);
+}
+
+// `write <file> [text]`: replace the file's contents with one line of text
+static void shell_write(char *args) {
+    if (!args || !*args) {
+        shell_println("usage: write <file> [text]");
+        return;
+    }
+    char *text = args;
+    while (*text && *text != ' ') ++text;
+    if (*text) *text++ = 0;
+    int fd = vfs_open(args, VFS_WRITE | VFS_CREATE | VFS_TRUNC);
+    if (fd < 0) {
+        shell_vfs_error("write", fd);
+        return;
+    }
+    int r = 0;
+    uint32_t len = strlen(text);
+    if (len) r = vfs_write(fd, text, len);
+    if (r >= 0 && len) r = vfs_write(fd, "\n", 1);
+    vfs_close(fd);
+    if (r < 0) shell_vfs_error("write", r);
+}
+
+// Start an ELF program from the initrd; its pages are read in place
+static void shell_exec(const char *path) {
+    char buf[80];
+    const initrd_file_t *f = path ? initrd_lookup(path) : 0;
+    if (!f || f->is_dir) {
+        shell_println(path ? "exec: no such file" : "usage: exec <file>");
+        return;
+    }
+    elf_exec_info_t info;
+    uint64_t t0 = rdtsc();
+    int err = elf_exec(f->data, f->size, "elf", &info);
+    uint32_t cycles = (uint32_t)(rdtsc() - t0);
+    if (err) {
+        ksnprintf(buf, sizeof(buf), "exec: %s", elf_strerror(err));
+        shell_println(buf);
+        return;
+    }
+    ksnprintf(buf, sizeof(buf), "exec: task %d, %u KB image, %u page(s) mapped up front, %u cycles",
+              info.id, f->size / 1024, info.resident, cycles);
+    shell_println(buf);
+}
+
+static void disk_stats_line(const char *what, uint32_t blocks, uint64_t cycles) {
+    char buf[80];
+    uint32_t us = (uint32_t)div_u64(cycles, tsc_mhz());
+    uint32_t kbps = us ? (uint32_t)div_u64((uint64_t)blocks * (BLOCK_SIZE / 1024) * 1000000, us) : 0;
+    block_stats_t st;
+    block_stats(&st);
+    ksnprintf(buf, sizeof(buf), "%s: %u blocks in %u us, %u KB/s", what, blocks, us, kbps);
+    shell_println(buf);
+    ksnprintf(buf, sizeof(buf), "  %u hits, %u misses, %u cmds (%u merged), %u read-ahead, %u ra hits",
+              st.hits, st.misses, st.commands, st.merged, st.readahead, st.ra_hits);
+    shell_println(buf);
+}
+
+// `disk` lists drives and cache counters; `disk bench [MB]` streams the
+// first drive through the buffer cache, cold and then cached
+static void shell_disk(char *args) {
+    char buf[80];
+    if (!block_devices()) {
+        shell_println("disk: no ATA drives");
+        return;
+    }
+    if (!args) {
+        for (int i = 0; i < ATA_MAX_DRIVES; ++i) {
+            const ata_drive_info_t *d = ata_drive(i);
+            if (!d) continue;
+            ksnprintf(buf, sizeof(buf), "ata%d: %u MB, %u blocks  %s", i, d->sectors / 2048, block_count(i), d->model);
+            shell_println(buf);
+        }
+        block_stats_t st;
+        block_stats(&st);
+        ksnprintf(buf, sizeof(buf), "cache: %u hits, %u misses, %u cmds, %u read, %u written, %u errors",
+                  st.hits, st.misses, st.commands, st.blocks_read, st.blocks_written, st.errors);
+        shell_println(buf);
+        return;
+    }
+    char *arg = args;
+    while (*arg && *arg != ' ') ++arg;
+    if (*arg) *arg++ = 0;
+    if (strcmp(args, "bench")) {
+        shell_println("usage: disk [bench [MB]]");
+        return;
+    }
+    int dev = 0;
+    while (!ata_drive(dev)) dev++;
+    uint32_t mb = *arg ? strtoul(arg, 0, 0) : 16;
+    uint32_t blocks = mb * (1024 * 1024 / BLOCK_SIZE);
+    if (!blocks || blocks > block_count(dev)) blocks = block_count(dev);
+
+    block_invalidate(dev);
+    block_stats_reset();
+    uint64_t t0 = rdtsc();
+    for (uint32_t i = 0; i < blocks; ++i) {
+        buf_t *b = bread(dev, i);
+        if (!b) {
+            ksnprintf(buf, sizeof(buf), "disk: read error at block %u", i);
+            shell_println(buf);
+            return;
+        }
+        brelse(b);
+    }
+    disk_stats_line("cold", blocks, rdtsc() - t0);
+
+    // The tail of the stream is still cached
+    uint32_t hot = blocks < BLOCK_NBUF / 2 ? blocks : BLOCK_NBUF / 2;
+    block_stats_reset();
+    t0 = rdtsc();
+    for (int pass = 0; pass < 16; ++pass)
+        for (uint32_t i = blocks - hot; i < blocks; ++i) brelse(bread(dev, i));
+    disk_stats_line("cached", hot * 16, rdtsc() - t0);
+}
+
+// `async [n]`: n concurrent operations that each sleep three times for a
+// pseudo-random number of ticks, all on the one executor task
+typedef struct demo_op {
+    async_op_t op;
+    uint16_t round, delay;
+} demo_op_t;
+
+static volatile uint32_t demo_left = 0;
+
+static int demo_fn(async_op_t *op) {
+    demo_op_t *d = (demo_op_t *)op;
+    ASYNC_BEGIN(op);
+    for (d->round = 0; d->round < 3; d->round++) {
+        d->delay = (d->delay * 75 + 74) % 65537 % 50 + 1;
+        ASYNC_SLEEP(op, d->delay);
+    }
+    kfree(d);
+    demo_left--;
+    ASYNC_END(op);
+}
+
+static void shell_async(const char *args) {
+    char buf[80];
+    uint32_t n = args ? strtoul(args, 0, 0) : 1000;
+    heap_stats_t before, during;
+    heap_get_stats(&before);
+    uint32_t started = 0;
+    demo_left = 0;
+    preempt_disable_enter(); // no op finishes before `during` has counted them all
+    for (; started < n; ++started) {
+        demo_op_t *d = kmalloc(sizeof(demo_op_t));
+        if (!d) break;
+        d->delay = (uint16_t)started;
+        demo_left++;
+        async_start(&d->op, demo_fn);
+    }
+    heap_get_stats(&during);
+    preempt_disable_exit();
+    uint32_t t0 = timer_ticks;
+    while (demo_left) task_sleep(1);
+    async_stats_t st;
+    async_stats(&st);
+    ksnprintf(buf, sizeof(buf), "async: %u ops done in %u ticks, %u resumes, peak %u pending",
+              started, timer_ticks - t0, st.resumes, st.max_pending);
+    shell_println(buf);
+    ksnprintf(buf, sizeof(buf), "async: %u-byte frames, %u heap bytes per op, no extra tasks",
+              (uint32_t)sizeof(demo_op_t),
+              started ? (uint32_t)(before.free_bytes - during.free_bytes) / started : 0);
+    shell_println(buf);
+    if (started < n) shell_println("async: heap exhausted, started fewer");
+}
+
+// `wq [n [ticks]]`: queue n items that each sleep for `ticks` timer ticks
+// on a shell workqueue and wait for them, so the worker pool has to grow;
+// then (or with no arguments, only) print queue and pool statistics
+#define WQ_DEMO_MAX 16
+static workqueue_t demo_wq;
+static work_t demo_work[WQ_DEMO_MAX];
+
+static void demo_work_fn(void *arg) {
+    task_sleep((int)(uintptr_t)arg);
+}
+
+static void shell_wq(const char *args) {
+    char buf[96];
+    if (!demo_wq.name) workqueue_init(&demo_wq, "shell");
+    if (args) {
+        char *end;
+        uint32_t n = strtoul(args, &end, 0);
+        uint32_t ticks = *end ? strtoul(end, 0, 0) : 10;
+        if (n > WQ_DEMO_MAX) n = WQ_DEMO_MAX;
+        uint32_t t0 = timer_ticks;
+        for (uint32_t i = 0; i < n; ++i) queue_work(&demo_wq, &demo_work[i], demo_work_fn, (void *)(uintptr_t)ticks);
+        flush_workqueue(&demo_wq);
+        ksnprintf(buf, sizeof(buf), "wq: %u items of %u ticks done in %u ticks", n, ticks, timer_ticks - t0);
+        shell_println(buf);
+    }
+    workqueue_pool_stats_t ps;
+    workqueue_pool_stats(&ps);
+    ksnprintf(buf, sizeof(buf), "pool: %u workers (%u idle, peak %u, max %u), %u spawned, %u exited, %u failed",
+              ps.workers, ps.idle, ps.peak, CONFIG_WQ_MAX_WORKERS, ps.spawned, ps.exited, ps.spawn_failed);
+    shell_println(buf);
+    shell_println("QUEUE     DEPTH  MAX DELAYED   QUEUED     DONE CANCEL LAT(us) MAXLAT MAXRUN");
+    uint32_t mhz = tsc_mhz();
+    for (workqueue_t *wq = workqueue_list(); wq; wq = wq->next_wq) {
+        uint32_t started = wq->done + wq->running;
+        uint32_t avg = mhz && started ? (uint32_t)div_u64(div_u64(wq->lat_total, started), mhz) : 0;
+        uint32_t max = mhz ? (uint32_t)div_u64(wq->lat_max, mhz) : 0;
+        uint32_t run = mhz ? (uint32_t)div_u64(wq->run_max, mhz) : 0;
+        ksnprintf(buf, sizeof(buf), "%-8s %6u %4u %7u %8u %8u %6u %7u %6u %6u", wq->name, wq->depth, wq->max_depth,
+                  wq->delayed, wq->queued, wq->done, wq->cancelled, avg, max, run);
+        shell_println(buf);
+    }
+}
+
+// Mirror the input line to a serial terminal: redraw it in place, then move
+// the terminal cursor back to the edit position
+static void shell_serial_redraw(const char *prompt, const char *line, int len, int cursor) {
+    if (!(console_get_sinks() & CONSOLE_SERIAL)) return;
+    console_write("\r");
+    console_write(prompt);
+    serial_write(line, len);
+    console_write("\x1b[K");
+    int back = len - cursor;
+    if (back > 0) {
+        char seq[8];
+        int pos = 0;
+        seq[pos++] = 0x1B;
+        seq[pos++] = '[';
+        if (back >= 10) seq[pos++] = '0' + back / 10;
+        seq[pos++] = '0' + back % 10;
+        seq[pos++] = 'D';
+        seq[pos] = 0;
+        console_write(seq);
+    }
 }
 
 void shell_task(void) {
@@ -320,68 +790,31 @@ void shell_task(void) {
     // Draw initial block cursor (white background, black text)
     video[input_pos * 2 + 1] = 0x7F;
     
+#if CONFIG_DEBUG
     unsigned int esp_val;
     asm volatile ("movl %%esp, %0" : "=r"(esp_val));
-    video[160] = "0123456789ABCDEF"[(esp_val >> 28) & 0xF];
-    video[161] = 0x2E;
-    video[162] = "0123456789ABCDEF"[(esp_val >> 24) & 0xF];
-    video[163] = 0x2E;
-    video[164] = "0123456789ABCDEF"[(esp_val >> 20) & 0xF];
-    video[165] = 0x2E;
-    video[166] = "0123456789ABCDEF"[(esp_val >> 16) & 0xF];
-    video[167] = 0x2E;
-    video[168] = "0123456789ABCDEF"[(esp_val >> 12) & 0xF];
-    video[169] = 0x2E;
-    video[170] = "0123456789ABCDEF"[(esp_val >> 8) & 0xF];
-    video[171] = 0x2E;
-    video[172] = "0123456789ABCDEF"[(esp_val >> 4) & 0xF];
-    video[173] = 0x2E;
-    video[174] = "0123456789ABCDEF"[esp_val & 0xF];
-    video[175] = 0x2E;
-    
     unsigned short ds_val;
     asm volatile ("movw %%ds, %0" : "=r"(ds_val));
-    video[180] = "0123456789ABCDEF"[(ds_val >> 12) & 0xF];
-    video[181] = 0x2E;
-    video[182] = "0123456789ABCDEF"[(ds_val >> 8) & 0xF];
-    video[183] = 0x2E;
-    video[184] = "0123456789ABCDEF"[(ds_val >> 4) & 0xF];
-    video[185] = 0x2E;
-    video[186] = "0123456789ABCDEF"[ds_val & 0xF];
-    video[187] = 0x2E;
-    
+    klog_debug("shell: esp %08X ds %04X", esp_val, ds_val);
+#endif
+
     keyboard_init();
-    
+
+#if CONFIG_DEBUG
     extern void keyboard_interrupt_handler(unsigned char);
     keyboard_interrupt_handler(0x1E); // Should write X or Y to screen if handler works
-    
+    klog_debug("shell: default_handler %p", (void *)default_handler);
+#endif
+
     //video[20] = '*'; // Should appear when a key is pressed
     video[21] = 0x4E;
-    
-    unsigned int handler_addr = (unsigned int)default_handler;
-    video[200] = "0123456789ABCDEF"[(handler_addr >> 28) & 0xF];
-    video[201] = 0x2E;
-    video[202] = "0123456789ABCDEF"[(handler_addr >> 24) & 0xF];
-    video[203] = 0x2E;
-    video[204] = "0123456789ABCDEF"[(handler_addr >> 20) & 0xF];
-    video[205] = 0x2E;
-    video[206] = "0123456789ABCDEF"[(handler_addr >> 16) & 0xF];
-    video[207] = 0x2E;
-    video[208] = "0123456789ABCDEF"[(handler_addr >> 12) & 0xF];
-    video[209] = 0x2E;
-    video[210] = "0123456789ABCDEF"[(handler_addr >> 8) & 0xF];
-    video[211] = 0x2E;
-    video[212] = "0123456789ABCDEF"[(handler_addr >> 4) & 0xF];
-    video[213] = 0x2E;
-    video[214] = "0123456789ABCDEF"[handler_addr & 0xF];
-    video[215] = 0x2E;
-    
+
     #define LINE_LEN 80
     char input_line[LINE_LEN] = {0};
     int input_len = 0;
     int cursor_pos = 0; // Position in input_line (0..input_len)
     int input_screen_start = msg_len; // Where input starts on screen
-    int screen_row = input_screen_start / 80; // Track current row
+    screen_row = input_screen_start / 80; // Track current row
     const char *prompt = "amxos> ";
     int prompt_len = 7; // Length of the prompt string
     // Draw initial input line and block cursor
@@ -395,6 +828,8 @@ void shell_task(void) {
         video[(input_screen_start + i) * 2 + 1] = 0x0F;
     }
     video[(input_screen_start + prompt_len + cursor_pos) * 2 + 1] = 0x7F;
+    console_write("\nAMXOS serial console\n");
+    shell_serial_redraw(prompt, input_line, input_len, cursor_pos);
 
     #define HISTORY_SIZE 16
     char history[HISTORY_SIZE][LINE_LEN] = {{0}};
@@ -402,29 +837,26 @@ void shell_task(void) {
     int history_pos = 0; // For navigating history
     int browsing_history = 0; // 0: not browsing, 1: browsing
 
-    // Program PIT for ~100Hz (blinking)
-    outb(0x43, 0x36);
-    outb(0x40, 0x9B);
-    outb(0x40, 0x2E);
-    
+    boot_phase("shell ready");
+    shell_ready_tsc = rdtsc();
+
     while (1) {
-        char c = keyboard_getchar();
+        char c = console_getchar();
         int blinked = 0;
         if (cursor_blink_request) {
             // Redraw cursor only
             int cur = input_screen_start + prompt_len + cursor_pos;
-            if (cursor_visible)
-                video[cur * 2 + 1] = 0x7F;
-            else
-                video[cur * 2 + 1] = 0x0F;
+            if (shell_vga()) video[cur * 2 + 1] = cursor_visible ? 0x7F : 0x0F;
             cursor_blink_request = 0;
             blinked = 1;
         }
         if (c) {
             // Restore the character and attribute under the old cursor
             int cur = input_screen_start + prompt_len + cursor_pos;
-            video[cur * 2] = input_line[cursor_pos] ? input_line[cursor_pos] : ' ';
-            video[cur * 2 + 1] = 0x0F;
+            if (shell_vga()) {
+                video[cur * 2] = input_line[cursor_pos] ? input_line[cursor_pos] : ' ';
+                video[cur * 2 + 1] = 0x0F;
+            }
 
             if (c == '\b') { // Backspace
                 if (cursor_pos > 0) {
@@ -437,6 +869,7 @@ void shell_task(void) {
                 browsing_history = 0;
             } else if (c == '\n') { // Enter
                 input_line[input_len] = 0; // Null-terminate
+                console_write("\n");
                 if (input_len > 0) {
                     // Add to history if not duplicate of last
                     if (history_count == 0 || strcmp(input_line, history[(history_count - 1) % HISTORY_SIZE]) != 0) {
@@ -453,18 +886,36 @@ void shell_task(void) {
                     while (*args && *args != ' ') ++args;
                     if (*args) { *args = 0; ++args; } else { args = 0; }
                     if (!strcmp(cmd, "help")) {
-                        print_line("Available commands: help, clear, echo, about, ls, memtest, pmmtest, pagingtest, faulttest", ++screen_row);
+                        shell_println("Available commands: help, clear, echo, about, ls, memtest, pmmtest, pagingtest, faulttest, console, dmesg, trace, prof, top, zpool, bench, boottime, user, cat, write, mkdir, rm, exec, disk, async, dl, meminfo, wq");
                     } else if (!strcmp(cmd, "clear")) {
-                        clear_screen();
+                        if (shell_vga()) clear_screen();
                         screen_row = 0;
                         input_screen_start = 0;
                     } else if (!strcmp(cmd, "echo")) {
-                        if (args && *args) print_line(args, ++screen_row);
-                        else print_line("", ++screen_row);
+                        if (args && *args) shell_println(args);
+                        else shell_println("");
                     } else if (!strcmp(cmd, "about")) {
-                        print_line("AMXOS: A simple x86 hobby OS shell", ++screen_row);
+                        shell_println("AMXOS: A simple x86 hobby OS shell");
                     } else if (!strcmp(cmd, "ls")) {
-                        print_line("help clear echo about ls memtest pmmtest pagingtest faulttest", ++screen_row);
+                        shell_ls(args);
+                    } else if (!strcmp(cmd, "cat")) {
+                        shell_cat(args);
+                    } else if (!strcmp(cmd, "write")) {
+                        shell_write(args);
+                    } else if (!strcmp(cmd, "mkdir")) {
+                        int err = args ? vfs_mkdir(args) : VFS_EINVAL;
+                        if (err) shell_vfs_error("mkdir", err);
+                    } else if (!strcmp(cmd, "rm")) {
+                        int err = args ? vfs_unlink(args) : VFS_EINVAL;
+                        if (err) shell_vfs_error("rm", err);
+                    } else if (!strcmp(cmd, "exec")) {
+                        shell_exec(args);
+                    } else if (!strcmp(cmd, "disk")) {
+                        shell_disk(args);
+                    } else if (!strcmp(cmd, "async")) {
+                        shell_async(args);
+                    } else if (!strcmp(cmd, "wq")) {
+                        shell_wq(args);
                     } else if (!strcmp(cmd, "memtest")) {
                         void *a = kmalloc(32);
                         void *b = kmalloc(64);
@@ -487,7 +938,7 @@ void shell_task(void) {
                         buf[pos++] = ' ';
                         for (int i = 0; i < 8; ++i) buf[pos++] = hd[i];
                         buf[pos] = 0;
-                        print_line(buf, ++screen_row);
+                        shell_println(buf);
                     } else if (!strcmp(cmd, "pmmtest")) {
                         void *p1 = alloc_page();
                         void *p2 = alloc_page();
@@ -510,9 +961,9 @@ void shell_task(void) {
                         buf[pos++] = ' ';
                         for (int i = 0; i < 8; ++i) buf[pos++] = h4[i];
                         buf[pos] = 0;
-                        print_line(buf, ++screen_row);
+                        shell_println(buf);
                     } else if (!strcmp(cmd, "pagingtest")) {
-                        print_line("Paging is enabled!", ++screen_row);
+                        shell_paging_test();
                     } else if (!strcmp(cmd, "faulttest")) {
                         volatile int *bad = (int*)0xDEADBEEF;
                         *bad = 42;
@@ -523,27 +974,109 @@ void shell_task(void) {
                         hex_to_str(idt[0xE].base_lo | (idt[0xE].base_hi << 16), h);
                         for (int i = 0; i < 8; ++i) dbg[i] = h[i];
                         dbg[8] = 0;
-                        print_line(dbg, ++screen_row);
+                        shell_println(dbg);
+                    } else if (!strcmp(cmd, "console")) {
+                        if (args && !strcmp(args, "vga")) console_set_sinks(CONSOLE_VGA);
+                        else if (args && !strcmp(args, "serial")) console_set_sinks(CONSOLE_SERIAL);
+                        else if (args && !strcmp(args, "both")) console_set_sinks(CONSOLE_VGA | CONSOLE_SERIAL);
+                        int sinks = console_get_sinks();
+                        if (sinks == (CONSOLE_VGA | CONSOLE_SERIAL)) shell_println("console: vga+serial");
+                        else if (sinks == CONSOLE_SERIAL) shell_println("console: serial");
+                        else shell_println("console: vga");
+                        if (!serial_present()) shell_println("console: no UART detected on COM1");
+                    } else if (!strcmp(cmd, "top")) {
+                        shell_top();
+                    } else if (!strcmp(cmd, "dl")) {
+                        shell_dl(args);
+                    } else if (!strcmp(cmd, "meminfo")) {
+                        shell_meminfo(args);
+                    } else if (!strcmp(cmd, "bench")) {
+                        int machine = 0;
+                        if (args && args[0] == '-' && args[1] == 'm') {
+                            machine = 1;
+                            args += 2;
+                            while (*args == ' ') ++args;
+                        }
+                        bench_run(args, machine);
+                    } else if (!strcmp(cmd, "zpool")) {
+                        char buf[80];
+                        if (args) {
+                            char *end;
+                            int low = (int)strtoul(args, &end, 0);
+                            int high = (int)strtoul(end, &end, 0);
+                            if (!pmm_zpool_set_watermarks(low, high))
+                                shell_println("usage: zpool [low high] (0 <= low <= high <= 256)");
+                        }
+                        pmm_zpool_stats_t st;
+                        pmm_zpool_stats(&st);
+                        ksnprintf(buf, sizeof(buf), "zpool: %d pages (low %d, high %d)", st.count, st.low, st.high);
+                        shell_println(buf);
+                        ksnprintf(buf, sizeof(buf), "zpool: %u hits, %u misses, %u refilled by idle",
+                                  st.hits, st.misses, st.refilled);
+                        shell_println(buf);
+                    } else if (!strcmp(cmd, "user")) {
+                        void (*prog)(void) = user_demo;
+                        if (args && !strcmp(args, "fault")) prog = user_fault;
+                        else if (args && *args) {
+                            shell_println("usage: user [fault]");
+                            prog = 0;
+                        }
+                        task_t *ut = prog ? task_create_user(prog) : 0;
+                        if (ut) task_set_name(ut, "user");
+                        else if (prog) shell_println("user: cannot create task");
+                    } else if (!strcmp(cmd, "boottime")) {
+                        boottime_print(shell_println);
+                    } else if (!strcmp(cmd, "dmesg")) {
+                        klog_dump(shell_println);
+                    } else if (!strcmp(cmd, "trace")) {
+                        if (!CONFIG_TRACE) {
+                            shell_println("trace: tracepoints compiled out (CONFIG_TRACE=0)");
+                        } else if (args && !strcmp(args, "on")) {
+                            trace_start();
+                        } else if (args && !strcmp(args, "off")) {
+                            trace_stop();
+                        } else if (args && !strcmp(args, "clear")) {
+                            trace_clear();
+                        } else if (args && !strcmp(args, "dump")) {
+                            trace_dump();
+                        } else {
+                            shell_println("usage: trace on|off|clear|dump");
+                        }
+#if CONFIG_TRACE // trace_enabled only exists with the tracepoints built in
+                        char buf[80];
+                        ksnprintf(buf, sizeof(buf), "trace: %s, %u records", trace_enabled ? "on" : "off", trace_count());
+                        shell_println(buf);
+#endif
+                    } else if (!strcmp(cmd, "prof")) {
+                        char buf[80];
+                        if (args && !strcmp(args, "start")) prof_start();
+                        else if (args && !strcmp(args, "stop")) prof_stop();
+                        else if (args && !strcmp(args, "reset")) prof_reset();
+                        else if (args && !strcmp(args, "dump")) prof_dump();
+                        else shell_println("usage: prof start|stop|reset|dump");
+                        ksnprintf(buf, sizeof(buf), "prof: %s, %u samples, %u dropped",
+                                  prof_running() ? "running" : "stopped", prof_samples(), prof_dropped());
+                        shell_println(buf);
                     } else if (*cmd) {
-                        print_at("Unknown command: ", ++screen_row, 0);
-                        print_at(cmd, screen_row, 18);
+                        char msg[LINE_LEN + 20];
+                        int pos = 0;
+                        for (const char *s = "Unknown command: "; *s; ++s) msg[pos++] = *s;
+                        for (const char *s = cmd; *s && pos < LINE_LEN + 19; ++s) msg[pos++] = *s;
+                        msg[pos] = 0;
+                        shell_println(msg);
                     }
                 } else {
-                    ++screen_row;
+                    shell_newline();
                 }
                 for (int i = 0; i < input_len; ++i) input_line[i] = 0;
-                for (int i = 0; i < LINE_LEN; ++i) {
-                    video[((screen_row + 1) * 80 + i) * 2] = ' ';
-                    video[((screen_row + 1) * 80 + i) * 2 + 1] = 0x0F;
-                }
                 // Always start prompt at the beginning of a new line
-                screen_row++;
+                shell_newline();
                 input_len = 0;
                 cursor_pos = 0;
                 input_screen_start = screen_row * 80;
                 // Draw prompt at start of new input line
-                for (int i = 0; i < prompt_len; ++i) {
-                    video[(input_screen_start + i) * 2] = prompt[i];
+                for (int i = 0; i < LINE_LEN && shell_vga(); ++i) {
+                    video[(input_screen_start + i) * 2] = i < prompt_len ? prompt[i] : ' ';
                     video[(input_screen_start + i) * 2 + 1] = 0x0F;
                 }
             } else if (c == '\t') { // Tab
@@ -607,35 +1140,63 @@ void shell_task(void) {
                 }
                 browsing_history = 0;
             }
-            // Redraw input line (after prompt)
-            for (int i = 0; i < LINE_LEN; ++i) {
-                video[(input_screen_start + prompt_len + i) * 2] = input_line[i] ? input_line[i] : ' ';
-                video[(input_screen_start + prompt_len + i) * 2 + 1] = 0x0F;
+            if (shell_vga()) {
+                // Redraw input line (after prompt)
+                for (int i = 0; i < LINE_LEN; ++i) {
+                    video[(input_screen_start + prompt_len + i) * 2] = input_line[i] ? input_line[i] : ' ';
+                    video[(input_screen_start + prompt_len + i) * 2 + 1] = 0x0F;
+                }
+                // Draw block cursor at new position (after prompt)
+                int newcur = input_screen_start + prompt_len + cursor_pos;
+                if (cursor_visible)
+                    video[newcur * 2 + 1] = 0x7F;
+                else
+                    video[newcur * 2 + 1] = 0x0F;
             }
-            // Draw block cursor at new position (after prompt)
-            int newcur = input_screen_start + prompt_len + cursor_pos;
-            if (cursor_visible)
-                video[newcur * 2 + 1] = 0x7F;
-            else
-                video[newcur * 2 + 1] = 0x0F;
+            shell_serial_redraw(prompt, input_line, input_len, cursor_pos);
         }
-        task_yield(); // Yield to other tasks
+        console_wait_input(); // Block until a key arrives or the cursor blinks
     }
 }
 
+// RAM above the PMM bitmap, as far as the page tables reach, is handed out
+// through kmap(); boot modules stay out of it
+static void add_high_memory(uint64_t base, uint64_t len, void *ctx) {
+    (void)ctx;
+    uint64_t end = base + len;
+    if (end > paging_max_phys()) end = paging_max_phys();
+    if (base < multiboot_modules_end()) base = multiboot_modules_end();
+    if (end > base && !pmm_add_region(base, end - base))
+        klog_warn("pmm: region table full, %u MB at %u MB unused", (uint32_t)((end - base) >> 20),
+                  (uint32_t)(base >> 20));
+}
+
 void idle_task(void) {
-    while (1) { asm volatile ("hlt"); }
+    while (1) {
+        // Spare cycles go to zeroing pages; halt once there is nothing to do
+        if (pmm_zpool_needs_refill() && pmm_zpool_refill()) continue;
+        asm volatile ("sti; hlt");
+    }
 }
 
 
+// Wait for the next 100-tick (~1 second) period: a deadline job when the
+// task was admitted to the deadline class, a plain sleep otherwise
+static void test_sleep_period(int periodic) {
+    if (periodic) task_wait_period();
+    else task_sleep(100);
+}
+
 void test_sleep_task(void) {
     int row = 0;
+    // One tick of budget per period, due within the period
+    int periodic = task_set_deadline(get_current_task(), 1, 100, 100) == 0;
     
     while (1) {
         print_line("=== TEST TASK RUNNING ===", row);
-        task_sleep(100); // Sleep for 100 timer ticks (~1 second)
+        test_sleep_period(periodic);
         print_line("=== TEST TASK WOKE UP  ===", row + 1);
-        task_sleep(100);
+        test_sleep_period(periodic);
         // Clear lines for next cycle
         print_line("                        ", row);
         print_line("                        ", row + 1);
@@ -645,98 +1206,148 @@ void test_sleep_task(void) {
 
 // Unified kernel panic handler
 void kernel_panic(const char *msg) {
+    asm volatile ("cli");
+    // Get the log out over serial synchronously; nothing else will run
+    serial_enter_panic_mode();
+    klog_flush();
+    console_write("KERNEL PANIC: ");
+    console_write(msg);
+    console_write("\n");
     print_line("KERNEL PANIC:", 23);
     print_line(msg, 24);
     while (1) { asm volatile ("cli; hlt"); }
 }
 
 
-void kmain(void) {
+void kmain(uint32_t magic, multiboot_info_t *mbi) {
     print_line("Welcome to AMXOS!", 0);
+    boot_phase("entry");
+    klib_init();
+    serial_init();
+    boot_phase("klib+serial");
+    if (!multiboot_init(magic, mbi))
+        klog_warn("multiboot: bad magic %08X, no boot info", magic);
+    else
+        klog_info("cmdline: %s", kernel_cmdline());
+    char mode[16];
+    int perf_mode = cmdline_option("amxos.mode", mode, sizeof(mode)) && !strcmp(mode, "perf");
+    boot_phase("multiboot");
     pic_remap();
-    heap_init();
+    // GRUB loads modules right after the kernel image; if they run into
+    // the default heap spot, put the heap above them instead
+    uint32_t heap_base = KERNEL_HEAP_START;
+    if (multiboot_modules_end() > heap_base)
+        heap_base = (multiboot_modules_end() + PMM_PAGE_SIZE - 1) & ~(PMM_PAGE_SIZE - 1);
+    heap_init_region((void *)heap_base, KERNEL_HEAP_SIZE);
+    boot_phase("heap");
     pmm_init();
+    pmm_reserve(heap_base, KERNEL_HEAP_SIZE);
+    for (int i = 0; i < multiboot_module_count(); ++i) {
+        const multiboot_module_t *mod = multiboot_module(i);
+        pmm_reserve(mod->mod_start, mod->mod_end - mod->mod_start);
+    }
+    boot_phase("pmm");
     paging_init();
+    multiboot_memory_foreach(add_high_memory, NULL);
+    uint32_t high_frames, high_free;
+    pmm_high_stats(&high_frames, &high_free);
+    if (high_frames) klog_info("pmm: %u MB above %u MB, reached through kmap", high_frames / 256, PMM_TOTAL_MEM >> 20);
+    boot_phase("paging");
+    // The first archive among the modules becomes the initrd; it has to
+    // sit inside the identity map since files are read in place
+    for (int i = 0; i < multiboot_module_count() && !initrd_format(); ++i) {
+        const multiboot_module_t *mod = multiboot_module(i);
+        if (mod->mod_end > IDENTITY_MAP_END) {
+            klog_warn("initrd: module %d at %08X is not mapped", i, mod->mod_start);
+            continue;
+        }
+        int n = initrd_init((const void *)mod->mod_start, mod->mod_end - mod->mod_start);
+        if (n >= 0) klog_info("initrd: %s archive, %d entries, %u KB in place", initrd_format(), n,
+                              (mod->mod_end - mod->mod_start) / 1024);
+    }
+    boot_phase("initrd");
+    if (vfs_init()) klog_warn("ramfs: no memory for the root directory");
+    gdt_init();
+    // Ring-3 programs linked into the kernel image (user.c)
+    extern char _user_start, _user_end;
+    paging_set_user((uint32_t)&_user_start, &_user_end - &_user_start, 1);
+
+    // Set all entries to default_handler first; the specific gates below
+    // must not be overwritten (this used to clobber the page fault gate)
+    for (int i = 0; i < IDT_SIZE; i++) {
+        idt_set_gate(i, (uint32_t)default_handler, 0x08, 0x8E);
+    }
     // Register page fault handler (interrupt 0xE)
     idt_set_gate(0xE, (uint32_t)asm_page_fault_handler, 0x08, 0x8E);
+    extern void asm_gp_fault_handler(void);
+    idt_set_gate(0xD, (uint32_t)asm_gp_fault_handler, 0x08, 0x8E);
 
-    // Debug output: print handler address, IDT entry for 0xE, and ESP
-    char dbgline[80], pfh[9], idtlo[9], idthi[9], idtsel[9], idtflg[9], espstr[9];
-    hex_to_str((unsigned int)asm_page_fault_handler, pfh);
-    hex_to_str((unsigned int)idt[0xE].base_lo, idtlo);
-    hex_to_str((unsigned int)idt[0xE].base_hi, idthi);
-    hex_to_str((unsigned int)idt[0xE].sel, idtsel);
-    hex_to_str((unsigned int)idt[0xE].flags, idtflg);
+    // Debug output: handler address, IDT entry for 0xE, and ESP
     unsigned int esp_val;
     asm volatile ("movl %%esp, %0" : "=r"(esp_val));
-    hex_to_str(esp_val, espstr);
-    int dpos = 0;
-    for (const char *s = "PFH:"; *s; ++s) dbgline[dpos++] = *s;
-    for (int i = 0; i < 8; ++i) dbgline[dpos++] = pfh[i];
-    dbgline[dpos++] = ' ';
-    for (const char *s = "IDT0E:"; *s; ++s) dbgline[dpos++] = *s;
-    for (int i = 0; i < 8; ++i) dbgline[dpos++] = idtlo[i];
-    dbgline[dpos++] = ':';
-    for (int i = 0; i < 8; ++i) dbgline[dpos++] = idthi[i];
-    dbgline[dpos++] = ' ';
-    for (const char *s = "SEL:"; *s; ++s) dbgline[dpos++] = *s;
-    for (int i = 0; i < 8; ++i) dbgline[dpos++] = idtsel[i];
-    dbgline[dpos++] = ' ';
-    for (const char *s = "FLG:"; *s; ++s) dbgline[dpos++] = *s;
-    for (int i = 0; i < 8; ++i) dbgline[dpos++] = idtflg[i];
-    dbgline[dpos++] = ' ';
-    for (const char *s = "ESP:"; *s; ++s) dbgline[dpos++] = *s;
-    for (int i = 0; i < 8; ++i) dbgline[dpos++] = espstr[i];
-    dbgline[dpos] = 0;
-    print_line(dbgline, 2);
+    klog_debug("PFH:%p IDT0E:%04X:%04X SEL:%04X FLG:%02X ESP:%08X",
+            (void *)asm_page_fault_handler, idt[0xE].base_lo, idt[0xE].base_hi,
+            idt[0xE].sel, idt[0xE].flags, esp_val);
 
     // Set up IDT pointer
     idtp.limit = (sizeof(struct idt_entry) * IDT_SIZE) - 1;
     idtp.base = (uint32_t)&idt;
+    klog_debug("idtp.base:%08X idtp.limit:%04X idt:%p", idtp.base, idtp.limit, (void *)&idt);
+    klog_info("%s build, klib: using %s memcpy/memset", CONFIG_PROFILE, klib_variant());
 
-    // Print IDT pointer and handler address for debugging (after setup)
-    char idtbase[9], idtlim[9], idtaddr[9];
-    hex_to_str((unsigned int)idtp.base, idtbase);
-    hex_to_str((unsigned int)idtp.limit, idtlim);
-    hex_to_str((unsigned int)&idt, idtaddr);
-    dpos = 0;
-    for (const char *s = "idtp.base:"; *s; ++s) dbgline[dpos++] = *s;
-    for (int i = 0; i < 8; ++i) dbgline[dpos++] = idtbase[i];
-    dbgline[dpos++] = ' ';
-    for (const char *s = "idtp.limit:"; *s; ++s) dbgline[dpos++] = *s;
-    for (int i = 0; i < 8; ++i) dbgline[dpos++] = idtlim[i];
-    dbgline[dpos++] = ' ';
-    for (const char *s = "idt:"; *s; ++s) dbgline[dpos++] = *s;
-    for (int i = 0; i < 8; ++i) dbgline[dpos++] = idtaddr[i];
-    dbgline[dpos++] = ' ';
-    for (const char *s = "pfh:"; *s; ++s) dbgline[dpos++] = *s;
-    for (int i = 0; i < 8; ++i) dbgline[dpos++] = pfh[i];
-    dbgline[dpos] = 0;
-    print_line(dbgline, 5);
-
-    // Set all entries to default_handler
-    for (int i = 0; i < IDT_SIZE; i++) {
-        idt_set_gate(i, (uint32_t)default_handler, 0x08, 0x8E);
-    }
     // Set IRQ1 (keyboard) handler: vector 0x21
     extern void asm_keyboard_on_interrupt(void);
     idt_set_gate(0x21, (uint32_t)asm_keyboard_on_interrupt, 0x08, 0x8E);
 
+    // Set IRQ4 (COM1) handler: vector 0x24
+    extern void asm_serial_on_interrupt(void);
+    idt_set_gate(0x24, (uint32_t)asm_serial_on_interrupt, 0x08, 0x8E);
+
     // Set IRQ0 (timer) handler: vector 0x20
     idt_set_gate(0x20, (uint32_t)asm_timer_on_interrupt, 0x08, 0x8E);
 
+    // Set IRQ14/IRQ15 (ATA channels) handlers: vectors 0x2E/0x2F
+    extern void asm_ata_primary_irq(void);
+    extern void asm_ata_secondary_irq(void);
+    idt_set_gate(0x2E, (uint32_t)asm_ata_primary_irq, 0x08, 0x8E);
+    idt_set_gate(0x2F, (uint32_t)asm_ata_secondary_irq, 0x08, 0x8E);
+
     // Set double fault handler: vector 0x8
     extern void asm_double_fault_handler(void);
     idt_set_gate(0x8, (uint32_t)asm_double_fault_handler, 0x08, 0x8E);
 
+    // System calls: int 0x80 gate and SYSENTER MSRs
+    syscall_init();
+
     // Load the IDT
     idt_load();
+    boot_phase("idt");
+
+    // IDE disks and the buffer cache; completions need the IDT loaded
+    if (ata_init()) klog_info("block: %d buffers of %d bytes", block_init(), BLOCK_SIZE);
+    boot_phase("disk");
 
-    asm volatile("sti");
+    // Program PIT for ~100Hz (scheduler tick, cursor blink)
+    outb(0x43, 0x36);
+    outb(0x40, 0x9B);
+    outb(0x40, 0x2E);
 
+    // Interrupts stay off until the jump below: a tick while the tasks are
+    // being created would save this boot context as the shell's. The
+    // trampoline turns them on as the first task starts.
     tasking_init(); // Initialize tasking system
-    task_create(shell_task);
-    task_create(test_sleep_task);
+    task_set_name(task_create(shell_task), "shell");
+    task_set_name(task_create(test_sleep_task), "test_sleep");
+    task_set_name(task_create(klogd_task), "klogd");
+    task_set_name(task_create(async_executor_task), "async");
+    workqueue_pool_init();
+    queue_delayed_work(&system_wq, &blink_work, cursor_blink, NULL, 25);
+    if (perf_mode) task_set_name(task_create(perf_task), "perf");
+    task_set_name(task_create(boottime_task), "boottime");
+    task_t *idle = task_create(idle_task);
+    task_set_name(idle, "idle");
+    task_set_idle(idle);
+    boot_phase("tasks");
     
     // Directly jump to the first task's context
     task_t *t = get_current_task();
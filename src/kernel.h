@@ -2,31 +2,33 @@
 #define KERNEL_H
 
 #include <stdint.h>
+#include "heap.h" // kmalloc/kfree
+#include "pmm.h"  // alloc_page/free_page
+#include "paging.h" // paging_*, kmap, IDENTITY_MAP_END
 
 // IDT and interrupt setup
 void idt_set_gate(int num, uint32_t base, uint16_t sel, uint8_t flags);
 void idt_load(void);
 void pic_remap(void);
+void pic_unmask(int irq); // enable one IRQ line (0-15)
 
 // Preemption control
 void preempt_disable_enter(void);
 void preempt_disable_exit(void);
 
-// Timer interrupt
-void timer_interrupt_handler(void);
+// Register frame built by the asm interrupt stubs: segment pushes, pusha,
+// then what the CPU pushed
+typedef struct irq_frame {
+    uint32_t gs, fs, es, ds;
+    uint32_t edi, esi, ebp, esp, ebx, edx, ecx, eax;
+    uint32_t eip, cs, eflags;
+} irq_frame_t;
 
-// Heap allocator
-void heap_init(void);
-void *kmalloc(int size);
-void kfree(void *ptr);
-
-// Physical memory manager
-void pmm_init(void);
-void *alloc_page(void);
-void free_page(void *addr);
-
-// Paging
-void paging_init(void);
+// Timer interrupt (PIT at TIMER_HZ)
+#define TIMER_HZ 100
+extern volatile uint32_t timer_ticks;
+extern volatile uint64_t shell_ready_tsc; // TSC when the shell began taking input
+void timer_interrupt_handler(irq_frame_t *frame);
 
 // Panic
 void kernel_panic(const char *msg);
@@ -36,6 +38,7 @@ void print_line(const char *str, int row);
 void clear_screen(void);
 void print_at(const char *str, int row, int col);
 void scroll_screen(void);
+void shell_println(const char *str);
 
 // Utility
 void hex_to_str(unsigned int val, char *buf);
@@ -46,6 +49,7 @@ void idle_task(void);
 void test_sleep_task(void);
 
 // Main kernel entry
-void kmain(void);
+struct multiboot_info;
+void kmain(uint32_t magic, struct multiboot_info *mbi);
 
 #endif // KERNEL_H 
\ No newline at end of file
@@ -1,12 +1,14 @@
 #include "keyboard.h"
 #include <stdint.h>
 #include "debug.h"
+#include "trace.h"
+#include "console.h"
 
 #define KB_BUFFER_SIZE 128
 
 static char kb_buffer[KB_BUFFER_SIZE];
-static uint8_t kb_head = 0;
-static uint8_t kb_tail = 0;
+static volatile uint8_t kb_head = 0; // written by the IRQ handler
+static volatile uint8_t kb_tail = 0;
 
 // Simple US QWERTY scancode to ASCII table (partial, for demonstration)
 static const char scancode_ascii[128] = {
@@ -29,7 +31,16 @@ static const char scancode_ascii_shift[128] = {
 static uint8_t shift_pressed = 0;
 static uint8_t e0_prefix = 0; // Track if 0xE0 prefix was received
 
+static void keyboard_decode(uint8_t scancode);
+
 void keyboard_interrupt_handler(uint8_t scancode) {
+    TRACE(TRACE_IRQ_ENTRY, 0x21, scancode);
+    keyboard_decode(scancode);
+    console_kick(); // wake a shell blocked on input
+    TRACE(TRACE_IRQ_EXIT, 0x21, 0);
+}
+
+static void keyboard_decode(uint8_t scancode) {
     // Handle Shift press/release
     if (scancode == 0x2A || scancode == 0x36) { // Left or Right Shift pressed
         shift_pressed = 1;
@@ -84,6 +95,10 @@ char keyboard_getchar(void) {
     return c;
 }
 
+int keyboard_has_input(void) {
+    return kb_head != kb_tail;
+}
+
 void keyboard_init(void) {
     kb_head = kb_tail = 0;
 }
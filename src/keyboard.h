@@ -5,6 +5,7 @@
 
 void keyboard_init(void);
 char keyboard_getchar(void);
+int keyboard_has_input(void);
 void page_fault_handler(uint32_t err_code);
 
 #endif
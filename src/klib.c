@@ -0,0 +1,347 @@
+#include "klib.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// XMM registers are not part of the task context and the interrupt stubs
+// assume DF=0, so SSE loops and backward (std) copies run with interrupts
+// off, SSE one bounded chunk at a time.
+#ifndef KLIB_HOST_TEST
+#include "cpu.h"
+#define guard_begin() irq_save()
+#define guard_end(flags) irq_restore(flags)
+#else
+#define guard_begin() 0
+#define guard_end(flags) ((void)(flags))
+#endif
+
+#define SSE_CHUNK 4096
+
+#define SSE2_MIN 256 // below this the setup cost outweighs the wide loop
+
+typedef uint32_t __attribute__((may_alias)) u32_alias_t;
+
+// --- memcpy ---
+
+void *memcpy_byte(void *dst, const void *src, size_t n) {
+    volatile uint8_t *d = dst; // volatile keeps gcc from turning this into a memcpy call
+    const uint8_t *s = src;
+    while (n--) *d++ = *s++;
+    return dst;
+}
+
+void *memcpy_rep(void *dst, const void *src, size_t n) {
+    void *ret = dst;
+    if (n >= 64) { // align the destination so the dword stores do not split
+        size_t head = (-(uintptr_t)dst) & 3;
+        n -= head;
+        asm volatile ("rep movsb" : "+D"(dst), "+S"(src), "+c"(head) : : "memory");
+    }
+    size_t dwords = n >> 2, tail = n & 3;
+    asm volatile ("rep movsl" : "+D"(dst), "+S"(src), "+c"(dwords) : : "memory");
+    asm volatile ("rep movsb" : "+D"(dst), "+S"(src), "+c"(tail) : : "memory");
+    return ret;
+}
+
+void *memcpy_erms(void *dst, const void *src, size_t n) {
+    void *ret = dst;
+    asm volatile ("rep movsb" : "+D"(dst), "+S"(src), "+c"(n) : : "memory");
+    return ret;
+}
+
+__attribute__((target("sse2")))
+void *memcpy_sse2(void *dst, const void *src, size_t n) {
+    if (n < SSE2_MIN) return memcpy_rep(dst, src, n);
+    void *ret = dst;
+    size_t head = (-(uintptr_t)dst) & 15;
+    n -= head;
+    asm volatile ("rep movsb" : "+D"(dst), "+S"(src), "+c"(head) : : "memory");
+    while (n >= 64) {
+        size_t chunk = n < SSE_CHUNK ? n & ~(size_t)63 : SSE_CHUNK;
+        size_t blocks = chunk >> 6;
+        n -= chunk;
+        uint32_t flags = guard_begin();
+        asm volatile (
+            "1:\n\t"
+            "movdqu   (%1), %%xmm0\n\t"
+            "movdqu 16(%1), %%xmm1\n\t"
+            "movdqu 32(%1), %%xmm2\n\t"
+            "movdqu 48(%1), %%xmm3\n\t"
+            "movdqa %%xmm0,   (%0)\n\t"
+            "movdqa %%xmm1, 16(%0)\n\t"
+            "movdqa %%xmm2, 32(%0)\n\t"
+            "movdqa %%xmm3, 48(%0)\n\t"
+            "add $64, %0\n\t"
+            "add $64, %1\n\t"
+            "dec %2\n\t"
+            "jnz 1b"
+            : "+r"(dst), "+r"(src), "+r"(blocks)
+            :
+            : "xmm0", "xmm1", "xmm2", "xmm3", "memory", "cc");
+        guard_end(flags);
+    }
+    asm volatile ("rep movsb" : "+D"(dst), "+S"(src), "+c"(n) : : "memory");
+    return ret;
+}
+
+// --- memset ---
+
+void *memset_byte(void *dst, int c, size_t n) {
+    volatile uint8_t *d = dst;
+    while (n--) *d++ = (uint8_t)c;
+    return dst;
+}
+
+void *memset_rep(void *dst, int c, size_t n) {
+    void *ret = dst;
+    uint32_t pattern = (uint8_t)c * 0x01010101u;
+    if (n >= 64) {
+        size_t head = (-(uintptr_t)dst) & 3;
+        n -= head;
+        asm volatile ("rep stosb" : "+D"(dst), "+c"(head) : "a"(pattern) : "memory");
+    }
+    size_t dwords = n >> 2, tail = n & 3;
+    asm volatile ("rep stosl" : "+D"(dst), "+c"(dwords) : "a"(pattern) : "memory");
+    asm volatile ("rep stosb" : "+D"(dst), "+c"(tail) : "a"(pattern) : "memory");
+    return ret;
+}
+
+void *memset_erms(void *dst, int c, size_t n) {
+    void *ret = dst;
+    asm volatile ("rep stosb" : "+D"(dst), "+c"(n) : "a"(c) : "memory");
+    return ret;
+}
+
+__attribute__((target("sse2")))
+void *memset_sse2(void *dst, int c, size_t n) {
+    if (n < SSE2_MIN) return memset_rep(dst, c, n);
+    void *ret = dst;
+    uint32_t pattern = (uint8_t)c * 0x01010101u;
+    size_t head = (-(uintptr_t)dst) & 15;
+    n -= head;
+    asm volatile ("rep stosb" : "+D"(dst), "+c"(head) : "a"(pattern) : "memory");
+    while (n >= 64) {
+        size_t chunk = n < SSE_CHUNK ? n & ~(size_t)63 : SSE_CHUNK;
+        size_t blocks = chunk >> 6;
+        n -= chunk;
+        uint32_t flags = guard_begin();
+        asm volatile (
+            "movd %2, %%xmm0\n\t"
+            "pshufd $0, %%xmm0, %%xmm0\n\t"
+            "1:\n\t"
+            "movdqa %%xmm0,   (%0)\n\t"
+            "movdqa %%xmm0, 16(%0)\n\t"
+            "movdqa %%xmm0, 32(%0)\n\t"
+            "movdqa %%xmm0, 48(%0)\n\t"
+            "add $64, %0\n\t"
+            "dec %1\n\t"
+            "jnz 1b"
+            : "+r"(dst), "+r"(blocks)
+            : "r"(pattern)
+            : "xmm0", "memory", "cc");
+        guard_end(flags);
+    }
+    asm volatile ("rep stosb" : "+D"(dst), "+c"(n) : "a"(pattern) : "memory");
+    return ret;
+}
+
+__attribute__((target("sse2")))
+void *memzero_nt_sse2(void *dst, size_t n) {
+    void *ret = dst;
+    while (n) {
+        size_t chunk = n < SSE_CHUNK ? n : SSE_CHUNK;
+        size_t blocks = chunk >> 6;
+        n -= chunk;
+        uint32_t flags = guard_begin();
+        asm volatile (
+            "pxor %%xmm0, %%xmm0\n\t"
+            "1:\n\t"
+            "movntdq %%xmm0,   (%0)\n\t"
+            "movntdq %%xmm0, 16(%0)\n\t"
+            "movntdq %%xmm0, 32(%0)\n\t"
+            "movntdq %%xmm0, 48(%0)\n\t"
+            "add $64, %0\n\t"
+            "dec %1\n\t"
+            "jnz 1b\n\t"
+            "sfence"
+            : "+r"(dst), "+r"(blocks)
+            :
+            : "xmm0", "memory", "cc");
+        guard_end(flags);
+    }
+    return ret;
+}
+
+// --- Dispatch ---
+
+static void *(*memset_impl)(void *, int, size_t) = memset_rep;
+static const char *variant_name = "rep";
+static int have_sse2 = 0;
+
+#ifndef KLIB_HOST_TEST
+static void *(*memcpy_impl)(void *, const void *, size_t) = memcpy_rep;
+
+void klib_init(void) {
+    uint32_t a, b, c, d;
+    cpuid(0, 0, &a, &b, &c, &d);
+    uint32_t max_leaf = a;
+    cpuid(1, 0, &a, &b, &c, &d);
+    int sse2 = (d >> 26) & 1 && (d >> 24) & 1; // SSE2 and FXSR
+    int erms = 0;
+    if (max_leaf >= 7) {
+        cpuid(7, 0, &a, &b, &c, &d);
+        erms = (b >> 9) & 1;
+    }
+    have_sse2 = sse2;
+    if (sse2) {
+        // Allow SSE instructions: CR0.EM off, CR0.MP on, CR4.OSFXSR/OSXMMEXCPT on
+        uint32_t cr;
+        asm volatile ("mov %%cr0, %0" : "=r"(cr));
+        cr = (cr & ~0x4u) | 0x2u;
+        asm volatile ("mov %0, %%cr0" : : "r"(cr));
+        asm volatile ("mov %%cr4, %0" : "=r"(cr));
+        cr |= (1u << 9) | (1u << 10);
+        asm volatile ("mov %0, %%cr4" : : "r"(cr));
+    }
+    if (erms) {
+        memcpy_impl = memcpy_erms;
+        memset_impl = memset_erms;
+        variant_name = "erms";
+    } else if (sse2) {
+        memcpy_impl = memcpy_sse2;
+        memset_impl = memset_sse2;
+        variant_name = "sse2";
+    }
+}
+
+void *memcpy(void *dst, const void *src, size_t n) {
+    return memcpy_impl(dst, src, n);
+}
+
+void *memset(void *dst, int c, size_t n) {
+    return memset_impl(dst, c, n);
+}
+
+void *memmove(void *dst, const void *src, size_t n) {
+    return klib_memmove(dst, src, n);
+}
+
+int memcmp(const void *a, const void *b, size_t n) {
+    return klib_memcmp(a, b, n);
+}
+
+size_t strlen(const char *s) {
+    return klib_strlen(s);
+}
+
+char *strncpy(char *dst, const char *src, size_t n) {
+    return klib_strncpy(dst, src, n);
+}
+
+int strcmp(const char *a, const char *b) {
+    return klib_strcmp(a, b);
+}
+
+unsigned long strtoul(const char *s, char **end, int base) {
+    return klib_strtoul(s, end, base);
+}
+#endif
+
+void *memzero_nt(void *dst, size_t n) {
+    if (have_sse2 && !((uintptr_t)dst & 15) && n && !(n & 63))
+        return memzero_nt_sse2(dst, n);
+    return memset_impl(dst, 0, n);
+}
+
+const char *klib_variant(void) {
+    return variant_name;
+}
+
+// --- memmove/memcmp/strings ---
+
+void *klib_memmove(void *dst, const void *src, size_t n) {
+    uintptr_t d = (uintptr_t)dst, s = (uintptr_t)src;
+    if (d <= s || d >= s + n)
+        return memcpy_rep(dst, src, n); // forward copy is safe
+    // Overlapping with dst above src: copy backwards with DF set
+    size_t dwords = n >> 2, tail = n & 3;
+    uint32_t flags = guard_begin();
+    if (tail) {
+        uint8_t *dp = (uint8_t *)dst + n - 1;
+        const uint8_t *sp = (const uint8_t *)src + n - 1;
+        asm volatile ("std; rep movsb; cld" : "+D"(dp), "+S"(sp), "+c"(tail) : : "memory");
+    }
+    if (dwords) {
+        uint8_t *dp = (uint8_t *)dst + dwords * 4 - 4;
+        const uint8_t *sp = (const uint8_t *)src + dwords * 4 - 4;
+        asm volatile ("std; rep movsl; cld" : "+D"(dp), "+S"(sp), "+c"(dwords) : : "memory");
+    }
+    guard_end(flags);
+    return dst;
+}
+
+int klib_memcmp(const void *a, const void *b, size_t n) {
+    const uint8_t *pa = a, *pb = b;
+    // Skip equal dwords quickly, then find the differing byte
+    while (n >= 4 && *(const u32_alias_t *)pa == *(const u32_alias_t *)pb) {
+        pa += 4;
+        pb += 4;
+        n -= 4;
+    }
+    for (; n; --n, ++pa, ++pb)
+        if (*pa != *pb) return *pa - *pb;
+    return 0;
+}
+
+size_t klib_strlen(const char *s) {
+    const char *p = s;
+    while ((uintptr_t)p & 3) {
+        if (!*p) return p - s;
+        p++;
+    }
+    // Aligned dword reads never cross a page boundary
+    const u32_alias_t *w = (const u32_alias_t *)p;
+    while (!((*w - 0x01010101u) & ~*w & 0x80808080u)) w++;
+    p = (const char *)w;
+    while (*p) p++;
+    return p - s;
+}
+
+char *klib_strncpy(char *dst, const char *src, size_t n) {
+    size_t i = 0;
+    for (; i < n && src[i]; ++i)
+        dst[i] = src[i];
+    if (i < n)
+        memset_impl(dst + i, 0, n - i);
+    return dst;
+}
+
+int klib_strcmp(const char *a, const char *b) {
+    while (*a && (*a == *b)) {
+        a++;
+        b++;
+    }
+    return *(const unsigned char*)a - *(const unsigned char*)b;
+}
+
+// Accepts leading spaces, an optional 0x prefix (base 16 or 0) and stops at
+// the first character that is not a digit in the base
+unsigned long klib_strtoul(const char *s, char **end, int base) {
+    unsigned long val = 0;
+    while (*s == ' ') s++;
+    if ((base == 0 || base == 16) && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        s += 2;
+        base = 16;
+    }
+    if (base == 0) base = 10;
+    for (;; ++s) {
+        int digit;
+        if (*s >= '0' && *s <= '9') digit = *s - '0';
+        else if (*s >= 'a' && *s <= 'f') digit = *s - 'a' + 10;
+        else if (*s >= 'A' && *s <= 'F') digit = *s - 'A' + 10;
+        else break;
+        if (digit >= base) break;
+        val = val * base + digit;
+    }
+    if (end) *end = (char *)s;
+    return val;
+}
@@ -0,0 +1,47 @@
+#ifndef KLIB_H
+#define KLIB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Kernel memory/string core. memcpy and memset dispatch to the fastest
+// variant for this CPU, chosen once by klib_init() from CPUID.
+void klib_init(void);
+const char *klib_variant(void);
+
+#ifndef KLIB_HOST_TEST
+void *memcpy(void *dst, const void *src, size_t n);
+void *memmove(void *dst, const void *src, size_t n);
+void *memset(void *dst, int c, size_t n);
+int memcmp(const void *a, const void *b, size_t n);
+size_t strlen(const char *s);
+char *strncpy(char *dst, const char *src, size_t n);
+int strcmp(const char *a, const char *b);
+unsigned long strtoul(const char *s, char **end, int base);
+#else
+#include <stdlib.h> // host builds use libc's versions
+#include <string.h>
+#endif
+
+// Zero memory without pulling it into the cache (movntdq when SSE2 is
+// available and dst/n are 64-byte multiples, plain memset otherwise)
+void *memzero_nt(void *dst, size_t n);
+
+// Individual implementations, exposed for the host-side test suite
+void *memcpy_byte(void *dst, const void *src, size_t n);
+void *memcpy_rep(void *dst, const void *src, size_t n);  // rep movsd + tail
+void *memcpy_erms(void *dst, const void *src, size_t n); // rep movsb (ERMS)
+void *memcpy_sse2(void *dst, const void *src, size_t n); // 64-byte SSE2 blocks
+void *memset_byte(void *dst, int c, size_t n);
+void *memset_rep(void *dst, int c, size_t n);
+void *memset_erms(void *dst, int c, size_t n);
+void *memset_sse2(void *dst, int c, size_t n);
+void *klib_memmove(void *dst, const void *src, size_t n);
+int klib_memcmp(const void *a, const void *b, size_t n);
+size_t klib_strlen(const char *s);
+char *klib_strncpy(char *dst, const char *src, size_t n);
+int klib_strcmp(const char *a, const char *b);
+unsigned long klib_strtoul(const char *s, char **end, int base);
+void *memzero_nt_sse2(void *dst, size_t n); // dst 16-aligned, n multiple of 64
+
+#endif // KLIB_H
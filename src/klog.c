@@ -0,0 +1,240 @@
+#include "klog.h"
+#include "cpu.h"
+#include "console.h"
+#include "task.h"
+#include "klib.h"
+#include <stdarg.h>
+#include <stdint.h>
+
+extern void print_line(const char *str, int row);
+
+#define KLOG_VGA_ROW 24    // bottom row shows the latest log line
+#define KLOGD_INTERVAL 5   // timer ticks between flushes
+
+// A record is valid for slot s once commit == s + 1. Producers reserve a slot
+// with an atomic add and publish with a release store; the consumer re-checks
+// commit after copying so a record overwritten mid-read is detected.
+typedef struct klog_rec {
+    volatile uint32_t commit;
+    uint32_t seq;
+    uint64_t tsc;
+    char text[KLOG_MSG_LEN];
+} klog_rec_t;
+
+typedef struct klog_ring {
+    volatile uint32_t head;    // next slot to reserve
+    uint32_t flushed;          // next slot klogd will emit
+    klog_rec_t recs[KLOG_RING_SIZE];
+} klog_ring_t;
+
+static klog_ring_t klog_rings[NR_CPUS];
+static volatile uint32_t klog_seq = 0;
+static uint32_t klog_lost = 0;
+
+// --- Formatter ---
+
+typedef struct {
+    char *buf;
+    int size;
+    int pos;
+} fmt_out_t;
+
+static void fmt_putc(fmt_out_t *o, char c) {
+    if (o->pos < o->size - 1) o->buf[o->pos] = c;
+    o->pos++;
+}
+
+static void fmt_num(fmt_out_t *o, uint64_t val, int base, int upper, int neg,
+                    int width, int zero, int left) {
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char tmp[24];
+    int n = 0;
+    if (base == 16) {
+        do { tmp[n++] = digits[val & 0xF]; val >>= 4; } while (val);
+    } else {
+        // Decimal is only used for 32-bit values, avoiding libgcc's __udivdi3
+        uint32_t v = (uint32_t)val;
+        do { tmp[n++] = digits[v % 10]; v /= 10; } while (v);
+    }
+    int len = n + neg;
+    if (neg && zero) fmt_putc(o, '-');
+    if (!left)
+        for (; len < width; ++len) fmt_putc(o, zero ? '0' : ' ');
+    if (neg && !zero) fmt_putc(o, '-');
+    while (n) fmt_putc(o, tmp[--n]);
+    if (left)
+        for (; len < width; ++len) fmt_putc(o, ' ');
+}
+
+int kvsnprintf(char *buf, int size, const char *fmt, va_list ap) {
+    fmt_out_t o = { buf, size, 0 };
+    for (; *fmt; ++fmt) {
+        if (*fmt != '%') { fmt_putc(&o, *fmt); continue; }
+        ++fmt;
+        int zero = 0, left = 0, width = 0, lng = 0;
+        for (;; ++fmt) {
+            if (*fmt == '0') zero = 1;
+            else if (*fmt == '-') left = 1;
+            else break;
+        }
+        while (*fmt >= '0' && *fmt <= '9') width = width * 10 + (*fmt++ - '0');
+        while (*fmt == 'l') { lng++; fmt++; }
+        switch (*fmt) {
+            case 'd': case 'i': {
+                int v = va_arg(ap, int);
+                uint32_t mag = v < 0 ? -(uint32_t)v : (uint32_t)v;
+                fmt_num(&o, mag, 10, 0, v < 0, width, zero, left);
+                break;
+            }
+            case 'u':
+                fmt_num(&o, va_arg(ap, uint32_t), 10, 0, 0, width, zero, left);
+                break;
+            case 'x': case 'X': {
+                uint64_t v = lng >= 2 ? va_arg(ap, uint64_t) : va_arg(ap, uint32_t);
+                fmt_num(&o, v, 16, *fmt == 'X', 0, width, zero, left);
+                break;
+            }
+            case 'p':
+                fmt_num(&o, (uint32_t)va_arg(ap, void *), 16, 0, 0, 8, 1, 0);
+                break;
+            case 's': {
+                const char *s = va_arg(ap, const char *);
+                if (!s) s = "(null)";
+                int len = 0;
+                while (s[len]) len++;
+                if (!left) for (; len < width; ++len) fmt_putc(&o, ' ');
+                while (*s) fmt_putc(&o, *s++);
+                if (left) for (; len < width; ++len) fmt_putc(&o, ' ');
+                break;
+            }
+            case 'c':
+                fmt_putc(&o, (char)va_arg(ap, int));
+                break;
+            case '%':
+                fmt_putc(&o, '%');
+                break;
+            case 0:
+                --fmt;
+                break;
+            default:
+                fmt_putc(&o, '%');
+                fmt_putc(&o, *fmt);
+                break;
+        }
+    }
+    if (size > 0) buf[o.pos < size ? o.pos : size - 1] = 0;
+    return o.pos;
+}
+
+int ksnprintf(char *buf, int size, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = kvsnprintf(buf, size, fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+// --- Ring ---
+
+void kprintf(const char *fmt, ...) {
+    klog_ring_t *ring = &klog_rings[cpu_id()];
+    uint32_t slot = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED);
+    klog_rec_t *rec = &ring->recs[slot & (KLOG_RING_SIZE - 1)];
+    __atomic_store_n(&rec->commit, 0, __ATOMIC_RELAXED);
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    rec->seq = __atomic_fetch_add(&klog_seq, 1, __ATOMIC_RELAXED);
+    rec->tsc = rdtsc();
+    va_list ap;
+    va_start(ap, fmt);
+    kvsnprintf(rec->text, KLOG_MSG_LEN, fmt, ap);
+    va_end(ap);
+    // Drop a trailing newline, records are lines
+    for (int i = 0; i < KLOG_MSG_LEN && rec->text[i]; ++i)
+        if (rec->text[i] == '\n' && !rec->text[i + 1]) rec->text[i] = 0;
+    __atomic_store_n(&rec->commit, slot + 1, __ATOMIC_RELEASE);
+}
+
+// Copy slot out of the ring. Returns 1 on success, 0 if not yet committed,
+// -1 if it has already been overwritten.
+static int klog_read(klog_ring_t *ring, uint32_t slot, klog_rec_t *out) {
+    klog_rec_t *rec = &ring->recs[slot & (KLOG_RING_SIZE - 1)];
+    uint32_t c = __atomic_load_n(&rec->commit, __ATOMIC_ACQUIRE);
+    if (c != slot + 1) {
+        // Either still being written (retry later) or reused by a newer slot
+        if (ring->head - slot > KLOG_RING_SIZE) return -1;
+        return 0;
+    }
+    out->seq = rec->seq;
+    out->tsc = rec->tsc;
+    memcpy(out->text, rec->text, KLOG_MSG_LEN);
+    out->text[KLOG_MSG_LEN - 1] = 0;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&rec->commit, __ATOMIC_ACQUIRE) != slot + 1) return -1;
+    return 1;
+}
+
+static void klog_format(const klog_rec_t *rec, char *line, int size) {
+    ksnprintf(line, size, "[%5u %08x%08x] %s", rec->seq,
+              (uint32_t)(rec->tsc >> 32), (uint32_t)rec->tsc, rec->text);
+}
+
+void klog_flush(void) {
+    char line[KLOG_MSG_LEN + 32];
+    klog_rec_t rec;
+    for (int cpu = 0; cpu < NR_CPUS; ++cpu) {
+        klog_ring_t *ring = &klog_rings[cpu];
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (head - ring->flushed > KLOG_RING_SIZE) {
+            klog_lost += head - ring->flushed - KLOG_RING_SIZE;
+            ring->flushed = head - KLOG_RING_SIZE;
+        }
+        while (ring->flushed != head) {
+            int r = klog_read(ring, ring->flushed, &rec);
+            if (r == 0) break; // producer still writing; retry next flush
+            if (r > 0) {
+                klog_format(&rec, line, sizeof(line));
+                if (console_get_sinks() & CONSOLE_SERIAL) {
+                    console_write(line);
+                    console_write("\n");
+                }
+                if (console_get_sinks() & CONSOLE_VGA) {
+                    char row[81];
+                    int i = 0;
+                    for (; i < 80 && rec.text[i]; ++i) row[i] = rec.text[i];
+                    for (; i < 80; ++i) row[i] = ' ';
+                    row[80] = 0;
+                    print_line(row, KLOG_VGA_ROW);
+                }
+            } else {
+                klog_lost++;
+            }
+            ring->flushed++;
+        }
+    }
+}
+
+void klog_dump(void (*emit)(const char *line)) {
+    char line[KLOG_MSG_LEN + 32];
+    klog_rec_t rec;
+    for (int cpu = 0; cpu < NR_CPUS; ++cpu) {
+        klog_ring_t *ring = &klog_rings[cpu];
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint32_t slot = head > KLOG_RING_SIZE ? head - KLOG_RING_SIZE : 0;
+        for (; slot != head; ++slot) {
+            if (klog_read(ring, slot, &rec) <= 0) continue;
+            klog_format(&rec, line, sizeof(line));
+            emit(line);
+        }
+    }
+}
+
+uint32_t klog_dropped(void) {
+    return klog_lost;
+}
+
+void klogd_task(void) {
+    while (1) {
+        klog_flush();
+        task_sleep(KLOGD_INTERVAL);
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef KLOG_H
+#define KLOG_H
+
+#include <stdarg.h>
+#include <stdint.h>
+#include "kconfig.h"
+
+// Kernel log: kprintf formats into a per-CPU lock-free ring. Safe from IRQ
+// and scheduler context; output reaches the console only when klogd (or an
+// explicit klog_flush) drains the ring.
+#define KLOG_RING_SIZE 128 // records per CPU, power of two
+#define KLOG_MSG_LEN   96
+
+void kprintf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+// Leveled logging. Messages above CONFIG_LOG_LEVEL compile out entirely but
+// keep their format checking.
+#define KLOG_ERR   1
+#define KLOG_WARN  2
+#define KLOG_INFO  3
+#define KLOG_DEBUG 4
+#define KLOG_AT(level, ...) do { if ((level) <= CONFIG_LOG_LEVEL) kprintf(__VA_ARGS__); } while (0)
+#define klog_err(...)   KLOG_AT(KLOG_ERR, __VA_ARGS__)
+#define klog_warn(...)  KLOG_AT(KLOG_WARN, __VA_ARGS__)
+#define klog_info(...)  KLOG_AT(KLOG_INFO, __VA_ARGS__)
+#define klog_debug(...) KLOG_AT(KLOG_DEBUG, __VA_ARGS__)
+
+// Minimal formatter: %d %i %u %x %X %p %s %c %%, '0'/'-' flags, width, 'l', 'llx'
+int ksnprintf(char *buf, int size, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+int kvsnprintf(char *buf, int size, const char *fmt, va_list ap);
+
+// Drain unflushed records to the console sinks
+void klog_flush(void);
+
+// Walk every retained record, oldest first, as formatted "[seq tsc] text" lines
+void klog_dump(void (*emit)(const char *line));
+
+uint32_t klog_dropped(void);
+
+// Low-priority flusher task
+void klogd_task(void);
+
+#endif // KLOG_H
@@ -0,0 +1,68 @@
+#include "multiboot.h"
+#include <stddef.h>
+
+static const multiboot_info_t *boot_info = NULL;
+static const char *cmdline = "";
+
+int multiboot_init(uint32_t magic, const multiboot_info_t *mbi) {
+    if (magic != MULTIBOOT_BOOTLOADER_MAGIC || !mbi) return 0;
+    boot_info = mbi;
+    if ((mbi->flags & MULTIBOOT_INFO_CMDLINE) && mbi->cmdline)
+        cmdline = (const char *)mbi->cmdline; // identity-mapped low memory
+    return 1;
+}
+
+const multiboot_info_t *multiboot_info(void) {
+    return boot_info;
+}
+
+int multiboot_module_count(void) {
+    if (!boot_info || !(boot_info->flags & MULTIBOOT_INFO_MODS)) return 0;
+    return (int)boot_info->mods_count;
+}
+
+const multiboot_module_t *multiboot_module(int i) {
+    if (i < 0 || i >= multiboot_module_count()) return NULL;
+    return (const multiboot_module_t *)boot_info->mods_addr + i;
+}
+
+uint32_t multiboot_modules_end(void) {
+    uint32_t end = 0;
+    for (int i = 0; i < multiboot_module_count(); ++i)
+        if (multiboot_module(i)->mod_end > end) end = multiboot_module(i)->mod_end;
+    return end;
+}
+
+void multiboot_memory_foreach(void (*fn)(uint64_t base, uint64_t len, void *ctx), void *ctx) {
+    if (!boot_info || !(boot_info->flags & MULTIBOOT_INFO_MMAP)) return;
+    uint32_t p = boot_info->mmap_addr, end = p + boot_info->mmap_length;
+    while (p < end) {
+        const multiboot_mmap_entry_t *e = (const multiboot_mmap_entry_t *)(uintptr_t)p;
+        if (e->type == MULTIBOOT_MEMORY_AVAILABLE && e->len) fn(e->addr, e->len, ctx);
+        p += e->size + sizeof(e->size);
+    }
+}
+
+const char *kernel_cmdline(void) {
+    return cmdline;
+}
+
+int cmdline_option(const char *key, char *val, int len) {
+    const char *p = cmdline;
+    while (*p) {
+        while (*p == ' ') p++;
+        const char *k = key;
+        while (*k && *p == *k) { p++; k++; }
+        if (!*k && (*p == '=' || *p == ' ' || !*p)) {
+            int n = 0;
+            if (*p == '=') {
+                p++;
+                while (*p && *p != ' ' && n < len - 1) val[n++] = *p++;
+            }
+            if (len > 0) val[n] = 0;
+            return 1;
+        }
+        while (*p && *p != ' ') p++; // skip the rest of this word
+    }
+    return 0;
+}
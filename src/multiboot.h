@@ -0,0 +1,57 @@
+#ifndef MULTIBOOT_H
+#define MULTIBOOT_H
+
+#include <stdint.h>
+
+// Multiboot (v1) handoff: EAX holds the magic, EBX the info structure
+#define MULTIBOOT_BOOTLOADER_MAGIC 0x2BADB002
+
+#define MULTIBOOT_INFO_MEMORY  0x001
+#define MULTIBOOT_INFO_CMDLINE 0x004
+#define MULTIBOOT_INFO_MODS    0x008
+#define MULTIBOOT_INFO_MMAP    0x040
+
+typedef struct multiboot_info {
+    uint32_t flags;
+    uint32_t mem_lower, mem_upper;  // KB below 1 MB / above 1 MB
+    uint32_t boot_device;
+    uint32_t cmdline;               // physical address of a C string
+    uint32_t mods_count, mods_addr;
+    uint32_t syms[4];
+    uint32_t mmap_length, mmap_addr;
+} __attribute__((packed)) multiboot_info_t;
+
+// BIOS memory map entry; `size` counts the bytes after itself
+#define MULTIBOOT_MEMORY_AVAILABLE 1
+typedef struct multiboot_mmap_entry {
+    uint32_t size;
+    uint64_t addr, len;
+    uint32_t type;
+} __attribute__((packed)) multiboot_mmap_entry_t;
+
+typedef struct multiboot_module {
+    uint32_t mod_start, mod_end;
+    uint32_t string;
+    uint32_t reserved;
+} __attribute__((packed)) multiboot_module_t;
+
+// Remember the boot information; returns 0 if not booted by a multiboot loader
+int multiboot_init(uint32_t magic, const multiboot_info_t *mbi);
+const multiboot_info_t *multiboot_info(void);
+
+// Boot modules loaded by GRUB `module` lines, in physical memory
+int multiboot_module_count(void);
+const multiboot_module_t *multiboot_module(int i);
+uint32_t multiboot_modules_end(void); // highest module end address, 0 if none
+
+// Call `fn` for every range of available RAM in the loader's memory map
+void multiboot_memory_foreach(void (*fn)(uint64_t base, uint64_t len, void *ctx), void *ctx);
+
+// Kernel command line ("" when none was passed)
+const char *kernel_cmdline(void);
+
+// Look up a "key=value" word on the command line and copy the value into
+// `val`; a bare "key" yields an empty value. Returns 0 if the key is absent.
+int cmdline_option(const char *key, char *val, int len);
+
+#endif // MULTIBOOT_H
@@ -0,0 +1,342 @@
+#include "paging.h"
+#include "vm.h"
+#include "kernel.h"
+#include "multiboot.h"
+#include "klog.h"
+#include "cpu.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define PAGE_SIZE    4096
+#define PAGE_ENTRIES 1024 // 32-bit tables
+#define PAE_ENTRIES  512  // PAE tables and directories
+#define LARGE_SIZE   0x200000
+#define IDENTITY_TABLES (IDENTITY_MAP_END / (PAGE_ENTRIES * PAGE_SIZE))
+
+// Entry bits; the low twelve mean the same in both formats
+#define PG_PRESENT 0x1
+#define PG_RW      0x2
+#define PG_USER    0x4
+#define PG_LARGE   0x80 // PAE directory entry mapping a 2 MB page
+#define PG_NX      (1ull << 63)
+#define PG_ADDR32  0xFFFFF000u
+#define PG_ADDR64  0x000FFFFFFFFFF000ull
+
+#define CPUID_EDX_PAE (1u << 6)  // leaf 1
+#define CPUID_EDX_NX  (1u << 20) // leaf 0x80000001
+#define CR4_PAE       (1u << 5)
+#define MSR_EFER      0xC0000080
+#define EFER_NXE      (1u << 11)
+
+extern char _text_start, _user_end; // code: kernel text, then ring-3 programs
+
+static int pae = 0, nx = 0;
+static uint64_t max_phys = 1ull << 32;
+static uint32_t loaded_root = 0;
+
+// 32-bit mode: one directory and the identity-map tables. Under PAE the
+// tables serve as the first split 2 MB pages instead.
+__attribute__((aligned(4096))) static uint32_t page_directory[PAGE_ENTRIES];
+__attribute__((aligned(4096))) static uint32_t identity_tables[IDENTITY_TABLES][PAGE_ENTRIES];
+static int split_tables_used = 0;
+
+// PAE: the kernel's directory covers the first GB, identity map included
+__attribute__((aligned(32))) static uint64_t kernel_pdpt[4];
+__attribute__((aligned(4096))) static uint64_t kernel_pd[PAE_ENTRIES];
+
+// Page table of the kmap window, in the active format
+__attribute__((aligned(4096))) static uint32_t kmap_table[PAGE_ENTRIES];
+static uint32_t kmap_used = 0; // one bit per slot
+
+static inline void invlpg(uint32_t va) {
+    asm volatile ("invlpg (%0)" : : "r"(va) : "memory");
+}
+
+// Tables are reached through the identity map; alloc_zeroed_page() only
+// hands out pages below its end
+static void *alloc_table_page(void) {
+    return alloc_zeroed_page();
+}
+
+static void detect_features(void) {
+    uint32_t a, b, c, d;
+    cpuid(1, 0, &a, &b, &c, &d);
+    if (!(d & CPUID_EDX_PAE) || cmdline_option("nopae", NULL, 0)) return;
+    pae = 1;
+    max_phys = 1ull << 36; // architectural minimum for PAE
+    cpuid(0x80000000, 0, &a, &b, &c, &d);
+    uint32_t max_ext = a;
+    if (max_ext >= 0x80000001) {
+        cpuid(0x80000001, 0, &a, &b, &c, &d);
+        nx = (d & CPUID_EDX_NX) != 0;
+    }
+    if (max_ext >= 0x80000008) {
+        cpuid(0x80000008, 0, &a, &b, &c, &d);
+        if ((a & 0xFF) > 36 && (a & 0xFF) <= 52) max_phys = 1ull << (a & 0xFF);
+    }
+}
+
+static void legacy_init(void) {
+    // Identity map first 16MB (4 page tables)
+    for (int t = 0; t < IDENTITY_TABLES; ++t) {
+        uint32_t *pt = identity_tables[t];
+        for (int i = 0; i < PAGE_ENTRIES; ++i)
+            pt[i] = ((t * PAGE_ENTRIES + i) * PAGE_SIZE) | PG_PRESENT | PG_RW;
+        page_directory[t] = ((uint32_t)pt) | PG_PRESENT | PG_RW;
+    }
+    for (int i = IDENTITY_TABLES; i < PAGE_ENTRIES; ++i)
+        page_directory[i] = 0;
+    page_directory[KMAP_BASE >> 22] = (uint32_t)kmap_table | PG_PRESENT | PG_RW;
+}
+
+// Replace the 2 MB page behind `pde` by a table of 4 KB pages with the same
+// attributes; returns the table, NULL when out of memory
+static uint64_t *pae_split(uint64_t *pde) {
+    if (!(*pde & PG_LARGE)) return (uint64_t *)(uintptr_t)(*pde & PG_ADDR64);
+    uint64_t *pt = split_tables_used < IDENTITY_TABLES ? (uint64_t *)identity_tables[split_tables_used++]
+                                                       : alloc_table_page();
+    if (!pt) return NULL;
+    uint64_t base = *pde & PG_ADDR64;
+    uint64_t attrs = *pde & (PG_NX | (0xFFF & ~PG_LARGE));
+    for (int i = 0; i < PAE_ENTRIES; ++i) pt[i] = (base + i * PAGE_SIZE) | attrs;
+    // The entries below decide NX and user access
+    *pde = (uint32_t)pt | PG_PRESENT | PG_RW | PG_USER;
+    invlpg((uint32_t)base);
+    return pt;
+}
+
+static void pae_init(void) {
+    uint64_t data_nx = nx ? PG_NX : 0;
+    for (uint32_t i = 0; i < IDENTITY_MAP_END / LARGE_SIZE; ++i)
+        kernel_pd[i] = (uint64_t)i * LARGE_SIZE | PG_PRESENT | PG_RW | PG_LARGE | data_nx;
+    if (nx) {
+        // Only the kernel text and the ring-3 programs stay executable, so
+        // the 2 MB pages holding them are broken up
+        uint32_t code_start = (uint32_t)&_text_start, code_end = (uint32_t)&_user_end;
+        for (uint32_t a = code_start & ~(LARGE_SIZE - 1); a < code_end; a += LARGE_SIZE) {
+            uint64_t *pt = pae_split(&kernel_pd[a / LARGE_SIZE]);
+            for (int i = 0; i < PAE_ENTRIES; ++i) {
+                uint32_t page = a + i * PAGE_SIZE;
+                if (page >= code_start && page < code_end) pt[i] &= ~PG_NX;
+            }
+        }
+    }
+    kernel_pd[KMAP_BASE / LARGE_SIZE] = (uint32_t)kmap_table | PG_PRESENT | PG_RW;
+    kernel_pdpt[0] = (uint32_t)kernel_pd | PG_PRESENT;
+}
+
+void paging_init(void) {
+    detect_features();
+    if (pae) pae_init();
+    else legacy_init();
+    loaded_root = paging_kernel_root();
+    if (nx) wrmsr(MSR_EFER, rdmsr(MSR_EFER) | EFER_NXE);
+    if (pae) {
+        uint32_t cr4;
+        asm volatile ("mov %%cr4, %0" : "=r"(cr4));
+        asm volatile ("mov %0, %%cr4" : : "r"(cr4 | CR4_PAE));
+    }
+    asm volatile ("mov %0, %%cr3" : : "r"(loaded_root));
+    // Enable paging
+    uint32_t cr0;
+    asm volatile ("mov %%cr0, %0" : "=r"(cr0));
+    cr0 |= 0x80000000;
+    asm volatile ("mov %0, %%cr0" : : "r"(cr0));
+    if (pae) klog_info("paging: PAE, 2 MB identity pages, NX %s, %u-bit physical",
+                       nx ? "on" : "unsupported", (uint32_t)__builtin_ctzll(max_phys));
+    else klog_info("paging: 32-bit tables%s", cmdline_option("nopae", NULL, 0) ? " (nopae)" : ", no PAE");
+}
+
+int paging_pae(void) {
+    return pae;
+}
+
+int paging_nx(void) {
+    return nx;
+}
+
+uint64_t paging_max_phys(void) {
+    return max_phys;
+}
+
+uint32_t paging_kernel_root(void) {
+    return pae ? (uint32_t)kernel_pdpt : (uint32_t)page_directory;
+}
+
+// Low half of the kernel's entry for the identity-mapped page at `addr`:
+// the flags live there in both formats. Without `split`, a PAE 2 MB page
+// answers for itself.
+static uint32_t *kernel_entry(uint32_t addr, int split) {
+    if (addr >= IDENTITY_MAP_END) return NULL;
+    if (!pae) return &identity_tables[addr >> 22][(addr >> 12) % PAGE_ENTRIES];
+    uint64_t *pde = &kernel_pd[addr / LARGE_SIZE];
+    if ((*pde & PG_LARGE) && !split) return (uint32_t *)pde;
+    uint64_t *pt = pae_split(pde);
+    return pt ? (uint32_t *)&pt[(addr >> 12) % PAE_ENTRIES] : NULL;
+}
+
+int paging_set_user(uint32_t addr, uint32_t len, int user) {
+    uint32_t end = addr + len;
+    if (end < addr) return 0;
+    for (uint32_t a = addr & ~(PAGE_SIZE-1); a < end; a += PAGE_SIZE) {
+        uint32_t *pte = kernel_entry(a, 1);
+        if (!pte) return 0;
+        // The directory entry stays user-accessible; the PTE decides
+        if (!pae) page_directory[a >> 22] |= PG_USER;
+        if (user) *pte |= PG_USER;
+        else *pte &= ~PG_USER;
+        invlpg(a);
+    }
+    return 1;
+}
+
+int paging_user_ok(uint32_t addr, uint32_t len) {
+    uint32_t end = addr + len;
+    if (end < addr) return 0;
+    for (uint32_t a = addr & ~(PAGE_SIZE-1); a < end; a += PAGE_SIZE) {
+        uint32_t *pte = kernel_entry(a, 0);
+        if (!pte || (*pte & (PG_PRESENT | PG_USER)) != (PG_PRESENT | PG_USER)) return 0;
+    }
+    return 1;
+}
+
+// --- Address-space roots ---
+// 32-bit: a directory whose kernel half copies the kernel's entries. PAE:
+// a PDPT sharing the kernel's directories outside the user range, with
+// its own directories for the user range allocated up front, since the
+// CPU only reads PDPT entries when CR3 is loaded.
+#define USER_PDPT_FIRST (USER_BASE >> 30)
+#define USER_PDPT_END   (USER_STACK_TOP >> 30)
+
+uint32_t paging_root_create(void) {
+    if (!pae) {
+        uint32_t *pd = alloc_table_page();
+        if (!pd) return 0;
+        for (uint32_t i = 0; i < USER_BASE >> 22; ++i) pd[i] = page_directory[i];
+        return (uint32_t)pd;
+    }
+    uint64_t *pdpt = alloc_table_page();
+    if (!pdpt) return 0;
+    for (uint32_t i = 0; i < 4; ++i) {
+        if (i < USER_PDPT_FIRST || i >= USER_PDPT_END) {
+            pdpt[i] = kernel_pdpt[i];
+            continue;
+        }
+        void *pd = alloc_table_page();
+        if (!pd) {
+            paging_root_destroy((uint32_t)pdpt, NULL);
+            return 0;
+        }
+        pdpt[i] = (uint32_t)pd | PG_PRESENT;
+    }
+    return (uint32_t)pdpt;
+}
+
+void paging_root_destroy(uint32_t root, void (*free_frame)(uint64_t pa)) {
+    if (!pae) {
+        uint32_t *pd = (uint32_t *)root;
+        for (uint32_t i = USER_BASE >> 22; i < USER_STACK_TOP >> 22; ++i) {
+            if (!(pd[i] & PG_PRESENT)) continue;
+            uint32_t *pt = (uint32_t *)(pd[i] & PG_ADDR32);
+            for (int j = 0; j < PAGE_ENTRIES; ++j)
+                if ((pt[j] & PG_PRESENT) && free_frame) free_frame(pt[j] & PG_ADDR32);
+            free_page(pt);
+        }
+        free_page(pd);
+        return;
+    }
+    uint64_t *pdpt = (uint64_t *)root;
+    for (uint32_t i = USER_PDPT_FIRST; i < USER_PDPT_END; ++i) {
+        if (!(pdpt[i] & PG_PRESENT)) continue;
+        uint64_t *pd = (uint64_t *)(uintptr_t)(pdpt[i] & PG_ADDR64);
+        for (int j = 0; j < PAE_ENTRIES; ++j) {
+            if (!(pd[j] & PG_PRESENT)) continue;
+            uint64_t *pt = (uint64_t *)(uintptr_t)(pd[j] & PG_ADDR64);
+            for (int k = 0; k < PAE_ENTRIES; ++k)
+                if ((pt[k] & PG_PRESENT) && free_frame) free_frame(pt[k] & PG_ADDR64);
+            free_page(pt);
+        }
+        free_page(pd);
+    }
+    free_page(pdpt);
+}
+
+int paging_map(uint32_t root, uint32_t va, uint64_t pa, int flags) {
+    if (pa >= max_phys) return 0;
+    uint32_t bits = PG_PRESENT;
+    if (flags & PAGING_WRITE) bits |= PG_RW;
+    if (flags & PAGING_USER) bits |= PG_USER;
+    if (!pae) {
+        uint32_t *pde = &((uint32_t *)root)[va >> 22];
+        if (!(*pde & PG_PRESENT)) {
+            void *pt = alloc_table_page();
+            if (!pt) return 0;
+            *pde = (uint32_t)pt | PG_PRESENT | PG_RW | PG_USER;
+        }
+        uint32_t *pt = (uint32_t *)(*pde & PG_ADDR32);
+        pt[(va >> 12) % PAGE_ENTRIES] = (uint32_t)pa | bits;
+    } else {
+        uint64_t pdpte = ((uint64_t *)root)[va >> 30];
+        if (!(pdpte & PG_PRESENT)) return 0; // outside the user range
+        uint64_t *pde = (uint64_t *)(uintptr_t)(pdpte & PG_ADDR64) + (va >> 21) % PAE_ENTRIES;
+        if (!(*pde & PG_PRESENT)) {
+            void *pt = alloc_table_page();
+            if (!pt) return 0;
+            *pde = (uint32_t)pt | PG_PRESENT | PG_RW | PG_USER;
+        }
+        uint64_t *pt = (uint64_t *)(uintptr_t)(*pde & PG_ADDR64);
+        pt[(va >> 12) % PAE_ENTRIES] = pa | bits | (nx && !(flags & PAGING_EXEC) ? PG_NX : 0);
+    }
+    if (root == loaded_root) invlpg(va);
+    return 1;
+}
+
+uint64_t paging_lookup(uint32_t root, uint32_t va) {
+    if (!pae) {
+        uint32_t pde = ((uint32_t *)root)[va >> 22];
+        if (!(pde & PG_PRESENT)) return 0;
+        uint32_t pte = ((uint32_t *)(pde & PG_ADDR32))[(va >> 12) % PAGE_ENTRIES];
+        return (pte & PG_PRESENT) ? (pte & PG_ADDR32) : 0;
+    }
+    uint64_t pdpte = ((uint64_t *)root)[va >> 30];
+    if (!(pdpte & PG_PRESENT)) return 0;
+    uint64_t pde = ((uint64_t *)(uintptr_t)(pdpte & PG_ADDR64))[(va >> 21) % PAE_ENTRIES];
+    if (!(pde & PG_PRESENT)) return 0;
+    if (pde & PG_LARGE) return (pde & PG_ADDR64 & ~(uint64_t)(LARGE_SIZE - 1)) + (va & (LARGE_SIZE - PAGE_SIZE));
+    uint64_t pte = ((uint64_t *)(uintptr_t)(pde & PG_ADDR64))[(va >> 12) % PAE_ENTRIES];
+    return (pte & PG_PRESENT) ? (pte & PG_ADDR64) : 0;
+}
+
+void paging_load(uint32_t root) {
+    if (root == loaded_root) return;
+    loaded_root = root;
+    asm volatile ("mov %0, %%cr3" : : "r"(root) : "memory");
+}
+
+// --- Temporary mappings ---
+void *kmap(uint64_t pa) {
+    if (pa + PAGE_SIZE <= IDENTITY_MAP_END) return (void *)(uintptr_t)pa;
+    if (pa >= max_phys) kernel_panic("kmap: frame beyond the physical address width");
+    uint32_t flags = irq_save();
+    if (kmap_used == ~0u) kernel_panic("kmap: out of slots");
+    int slot = __builtin_ctz(~kmap_used);
+    kmap_used |= 1u << slot;
+    if (pae) ((uint64_t *)kmap_table)[slot] = (pa & PG_ADDR64) | PG_PRESENT | PG_RW | (nx ? PG_NX : 0);
+    else kmap_table[slot] = (uint32_t)pa | PG_PRESENT | PG_RW;
+    uint32_t va = KMAP_BASE + slot * PAGE_SIZE;
+    invlpg(va);
+    irq_restore(flags);
+    return (void *)va;
+}
+
+void kunmap(void *va) {
+    uint32_t a = (uint32_t)va;
+    if (a < KMAP_BASE || a >= KMAP_BASE + KMAP_SLOTS * PAGE_SIZE) return; // identity address
+    int slot = (a - KMAP_BASE) / PAGE_SIZE;
+    uint32_t flags = irq_save();
+    if (pae) ((uint64_t *)kmap_table)[slot] = 0;
+    else kmap_table[slot] = 0;
+    invlpg(a & ~(PAGE_SIZE - 1));
+    kmap_used &= ~(1u << slot);
+    irq_restore(flags);
+}
@@ -0,0 +1,49 @@
+#ifndef PAGING_H
+#define PAGING_H
+
+#include <stdint.h>
+
+// Kernel page tables. The first 16 MB are identity-mapped for the kernel.
+// With PAE (three-level tables, 64-bit entries) the identity map uses 2 MB
+// pages, split into 4 KB ones only where permissions differ, frames above
+// 4 GB can be mapped, and data/stack pages get the NX bit when the CPU has
+// it. Without PAE, or with `nopae` on the command line, the classic
+// two-level 32-bit format is used.
+#define IDENTITY_MAP_END 0x1000000
+
+void paging_init(void);
+int paging_pae(void);         // three-level 64-bit tables in use
+int paging_nx(void);          // NX enforced on non-code pages
+uint64_t paging_max_phys(void); // first physical address that cannot be mapped
+
+// Set or clear user access on the identity-mapped pages covering [addr, addr+len)
+int paging_set_user(uint32_t addr, uint32_t len, int user);
+// Whether ring 3 may access all of [addr, addr+len)
+int paging_user_ok(uint32_t addr, uint32_t len);
+
+// Address-space roots for vm.c. A root is the value loaded into CR3; every
+// root shares the kernel's mappings below USER_BASE.
+#define PAGING_WRITE 0x1
+#define PAGING_USER  0x2
+#define PAGING_EXEC  0x4
+uint32_t paging_kernel_root(void);
+uint32_t paging_root_create(void); // 0 when out of memory
+// Free the root and its user-range tables, handing every mapped frame to
+// `free_frame`; must not be the loaded root
+void paging_root_destroy(uint32_t root, void (*free_frame)(uint64_t pa));
+// Map the 4 KB page at `va` to frame `pa`; 0 if a table could not be
+// allocated or `pa` is out of reach
+int paging_map(uint32_t root, uint32_t va, uint64_t pa, int flags);
+// Frame mapped at `va`, or 0 if none
+uint64_t paging_lookup(uint32_t root, uint32_t va);
+void paging_load(uint32_t root); // switch CR3, skipped if already loaded
+
+// Temporary kernel mappings of frames outside the identity map (identity
+// addresses are returned as they are). Slots are few and meant to be held
+// briefly; running out of them is a kernel bug and panics.
+#define KMAP_BASE  IDENTITY_MAP_END
+#define KMAP_SLOTS 32
+void *kmap(uint64_t pa);
+void kunmap(void *va);
+
+#endif // PAGING_H
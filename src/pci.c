@@ -0,0 +1,91 @@
+#include "pci.h"
+#include "cpu.h"
+#include <stdint.h>
+
+#define PCI_CONFIG_ADDR 0xCF8
+#define PCI_CONFIG_DATA 0xCFC
+
+static uint32_t config_addr(uint8_t bus, uint8_t dev, uint8_t fn, uint8_t off) {
+    return 0x80000000u | (bus << 16) | (dev << 11) | (fn << 8) | (off & 0xFC);
+}
+
+static uint32_t read_raw(uint8_t bus, uint8_t dev, uint8_t fn, uint8_t off) {
+    uint32_t flags = irq_save(); // address/data is a two-step sequence
+    outl(PCI_CONFIG_ADDR, config_addr(bus, dev, fn, off));
+    uint32_t val = inl(PCI_CONFIG_DATA);
+    irq_restore(flags);
+    return val;
+}
+
+uint32_t pci_read32(const pci_dev_t *d, uint8_t off) {
+    return read_raw(d->bus, d->dev, d->fn, off);
+}
+
+void pci_write32(const pci_dev_t *d, uint8_t off, uint32_t val) {
+    uint32_t flags = irq_save();
+    outl(PCI_CONFIG_ADDR, config_addr(d->bus, d->dev, d->fn, off));
+    outl(PCI_CONFIG_DATA, val);
+    irq_restore(flags);
+}
+
+uint16_t pci_read16(const pci_dev_t *d, uint8_t off) {
+    return (uint16_t)(pci_read32(d, off) >> ((off & 2) * 8));
+}
+
+void pci_write16(const pci_dev_t *d, uint8_t off, uint16_t val) {
+    uint32_t v = pci_read32(d, off);
+    int shift = (off & 2) * 8;
+    v = (v & ~(0xFFFFu << shift)) | ((uint32_t)val << shift);
+    pci_write32(d, off, v);
+}
+
+static int probe(uint8_t bus, uint8_t dev, uint8_t fn, pci_dev_t *out) {
+    uint32_t id = read_raw(bus, dev, fn, PCI_VENDOR_ID);
+    if ((id & 0xFFFF) == 0xFFFF) return 0;
+    uint32_t cls = read_raw(bus, dev, fn, PCI_CLASS_REV);
+    out->bus = bus;
+    out->dev = dev;
+    out->fn = fn;
+    out->vendor = id & 0xFFFF;
+    out->device = id >> 16;
+    out->class_code = cls >> 24;
+    out->subclass = (cls >> 16) & 0xFF;
+    out->prog_if = (cls >> 8) & 0xFF;
+    return 1;
+}
+
+void pci_scan(int (*fn)(const pci_dev_t *d, void *ctx), void *ctx) {
+    pci_dev_t d;
+    for (int bus = 0; bus < 256; ++bus) {
+        for (int dev = 0; dev < 32; ++dev) {
+            if (!probe(bus, dev, 0, &d)) continue;
+            if (fn(&d, ctx)) return;
+            // Header type bit 7: multi-function device
+            if (!(read_raw(bus, dev, 0, 0x0C) & 0x00800000)) continue;
+            for (int f = 1; f < 8; ++f)
+                if (probe(bus, dev, f, &d) && fn(&d, ctx)) return;
+        }
+    }
+}
+
+typedef struct find_ctx {
+    uint8_t class_code, subclass;
+    int index, found;
+    pci_dev_t *out;
+} find_ctx_t;
+
+static int find_one(const pci_dev_t *d, void *arg) {
+    find_ctx_t *c = arg;
+    if (d->class_code != c->class_code || d->subclass != c->subclass) return 0;
+    if (c->index-- == 0) {
+        *c->out = *d;
+        c->found = 1;
+    }
+    return c->found;
+}
+
+int pci_find_class(uint8_t class_code, uint8_t subclass, int index, pci_dev_t *out) {
+    find_ctx_t c = { class_code, subclass, index, 0, out };
+    pci_scan(find_one, &c);
+    return c.found;
+}
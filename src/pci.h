@@ -0,0 +1,36 @@
+#ifndef PCI_H
+#define PCI_H
+
+#include <stdint.h>
+
+// PCI configuration space through the legacy 0xCF8/0xCFC mechanism
+#define PCI_VENDOR_ID  0x00
+#define PCI_COMMAND    0x04
+#define PCI_CLASS_REV  0x08 // class << 24 | subclass << 16 | prog-if << 8 | revision
+#define PCI_BAR0       0x10
+#define PCI_BAR4       0x20
+#define PCI_INTERRUPT  0x3C
+
+#define PCI_CMD_IO     0x1
+#define PCI_CMD_MEMORY 0x2
+#define PCI_CMD_MASTER 0x4
+
+typedef struct pci_dev {
+    uint8_t bus, dev, fn;
+    uint16_t vendor, device;
+    uint8_t class_code, subclass, prog_if;
+} pci_dev_t;
+
+uint32_t pci_read32(const pci_dev_t *d, uint8_t off);
+void pci_write32(const pci_dev_t *d, uint8_t off, uint32_t val);
+uint16_t pci_read16(const pci_dev_t *d, uint8_t off);
+void pci_write16(const pci_dev_t *d, uint8_t off, uint16_t val);
+
+// Find the `index`-th function with the given class/subclass; returns 0
+// when there is none
+int pci_find_class(uint8_t class_code, uint8_t subclass, int index, pci_dev_t *out);
+
+// Call `fn` for every function present, until it returns nonzero
+void pci_scan(int (*fn)(const pci_dev_t *d, void *ctx), void *ctx);
+
+#endif // PCI_H
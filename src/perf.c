@@ -0,0 +1,131 @@
+#include "perf.h"
+#include "kernel.h"
+#include "task.h"
+#include "cpu.h"
+#include "klog.h"
+#include "serial.h"
+#include "boottime.h"
+#include <stdint.h>
+
+#define PERF_RUN_TICKS       20 // duration of the rate measurements
+#define PERF_ALLOC_OPS       20000
+#define PERF_LATENCY_SAMPLES 100
+
+static uint32_t tsc_per_us = 1;
+
+static uint32_t cycles_to_us(uint64_t cycles) {
+    return (uint32_t)div_u64(cycles, tsc_per_us);
+}
+
+static void report(const char *metric, uint32_t value) {
+    char line[64];
+    int n = ksnprintf(line, sizeof(line), "PERF %s %u\n", metric, value);
+    serial_write_wait(line, n);
+}
+
+// --- Workloads ---
+
+static volatile int partner_run = 0;
+
+static void perf_partner(void) {
+    while (partner_run) task_yield();
+}
+
+static uint32_t perf_ctxswitch_rate(void) {
+    partner_run = 1;
+    task_t *partner = task_create(perf_partner);
+    if (!partner) return 0;
+    task_set_name(partner, "perf2");
+    task_yield();
+    uint32_t round_trips = 0;
+    uint32_t start = timer_ticks;
+    uint64_t t0 = rdtsc();
+    while (timer_ticks - start < PERF_RUN_TICKS) {
+        task_yield();
+        round_trips++;
+    }
+    uint32_t us = cycles_to_us(rdtsc() - t0);
+    partner_run = 0;
+    while (partner->state != TASK_TERMINATED) task_yield();
+    return us ? (uint32_t)div_u64((uint64_t)round_trips * 2 * 1000000, us) : 0;
+}
+
+// Mixed-size kmalloc/kfree with a small live set, in operations per second
+static uint32_t perf_kmalloc_rate(void) {
+    static void *live[32];
+    static const int sizes[] = { 16, 24, 64, 200, 512, 1500 };
+    uint32_t seed = 12345;
+    for (int i = 0; i < 32; ++i) live[i] = 0;
+    preempt_disable_enter();
+    uint64_t t0 = rdtsc();
+    for (int op = 0; op < PERF_ALLOC_OPS; ++op) {
+        seed = seed * 1103515245 + 12345;
+        int slot = (seed >> 16) & 31;
+        if (live[slot]) {
+            kfree(live[slot]);
+            live[slot] = 0;
+        } else {
+            live[slot] = kmalloc(sizes[(seed >> 8) % 6]);
+        }
+    }
+    uint32_t us = cycles_to_us(rdtsc() - t0);
+    preempt_disable_exit();
+    for (int i = 0; i < 32; ++i) kfree(live[i]);
+    return us ? (uint32_t)div_u64((uint64_t)PERF_ALLOC_OPS * 1000000, us) : 0;
+}
+
+static uint32_t perf_page_rate(void) {
+    preempt_disable_enter();
+    uint64_t t0 = rdtsc();
+    for (int op = 0; op < PERF_ALLOC_OPS; ++op) free_page(alloc_page());
+    uint32_t us = cycles_to_us(rdtsc() - t0);
+    preempt_disable_exit();
+    return us ? (uint32_t)div_u64((uint64_t)PERF_ALLOC_OPS * 2 * 1000000, us) : 0;
+}
+
+// Delay from the timer tick that wakes a sleeper to the sleeper running.
+// task_tick stamps the wakeup and the switch in charges the wait to
+// wait_cycles, so a wakeup held up past later ticks still counts from the
+// tick that made it runnable.
+static void perf_timer_latency(uint32_t *avg_ns, uint32_t *max_ns) {
+    uint64_t total = 0, worst = 0;
+    task_t *self = get_current_task();
+    for (int i = 0; i < PERF_LATENCY_SAMPLES; ++i) {
+        uint64_t waited = self->wait_cycles;
+        task_sleep(1);
+        uint64_t lat = self->wait_cycles - waited;
+        total += lat;
+        if (lat > worst) worst = lat;
+    }
+    *avg_ns = (uint32_t)div_u64(div_u64(total, PERF_LATENCY_SAMPLES) * 1000, tsc_per_us);
+    *max_ns = (uint32_t)div_u64(worst * 1000, tsc_per_us);
+}
+
+void perf_task(void) {
+    while (!shell_ready_tsc) task_yield();
+    kprintf("perf: running benchmark workloads");
+    tsc_per_us = tsc_mhz();
+
+    uint32_t boot_us = cycles_to_us(shell_ready_tsc - boot_tsc_start);
+    uint32_t ctx = perf_ctxswitch_rate();
+    uint32_t kmalloc_rate = perf_kmalloc_rate();
+    uint32_t page_rate = perf_page_rate();
+    uint32_t lat_avg, lat_max;
+    perf_timer_latency(&lat_avg, &lat_max);
+
+    char line[64];
+    int n = ksnprintf(line, sizeof(line), "PERF BEGIN tsc_mhz=%u\n", tsc_per_us);
+    serial_write_wait(line, n);
+    report("boot_to_shell_us", boot_us);
+    report("ctxswitch_per_sec", ctx);
+    report("kmalloc_ops_per_sec", kmalloc_rate);
+    report("page_ops_per_sec", page_rate);
+    report("timer_latency_avg_ns", lat_avg);
+    report("timer_latency_max_ns", lat_max);
+    serial_write_wait("PERF END\n", 9);
+    serial_flush();
+
+    // QEMU exits with status (value << 1) | 1; without the device this is a no-op
+    outb(PERF_EXIT_PORT, 0);
+    task_exit();
+}
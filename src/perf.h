@@ -0,0 +1,13 @@
+#ifndef PERF_H
+#define PERF_H
+
+// Boot-time benchmark mode (kernel command line amxos.mode=perf). The perf
+// task runs a fixed workload set once the shell is up, reports over serial
+// between "PERF BEGIN" and "PERF END" lines ("PERF <metric> <value>") and
+// then exits QEMU through the isa-debug-exit device. `make perf` compares
+// the report against tools/perf_baseline.txt.
+#define PERF_EXIT_PORT 0xf4
+
+void perf_task(void);
+
+#endif // PERF_H
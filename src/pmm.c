@@ -0,0 +1,244 @@
+#include "pmm.h"
+#include "heap.h"
+#include "klib.h"
+#include "cpu.h"
+#include "paging.h" // kmap, IDENTITY_MAP_END
+#include <stdint.h>
+
+static uint8_t pmm_bitmap[PMM_BITMAP_SIZE];
+
+static void pmm_zpool_reset(void);
+static void pmm_high_reset(void);
+
+void pmm_init(void) {
+    // The bitmap lives in .bss, which the loader zeroes, so only a
+    // re-init has to clear it
+    static int initialized = 0;
+    if (initialized) memset(pmm_bitmap, 0, PMM_BITMAP_SIZE);
+    initialized = 1;
+    pmm_zpool_reset();
+    pmm_high_reset();
+    // Mark pages used by kernel and heap as allocated, whole bytes first
+    int heap_pages = (KERNEL_HEAP_START + KERNEL_HEAP_SIZE) / PMM_PAGE_SIZE;
+    memset(pmm_bitmap, 0xFF, heap_pages / 8);
+    for (int i = heap_pages & ~7; i < heap_pages; ++i) {
+        pmm_bitmap[i / 8] |= (1 << (i % 8));
+    }
+}
+
+void pmm_reserve(uint32_t addr, uint32_t len) {
+    if (!len) return;
+    uint32_t first = addr / PMM_PAGE_SIZE;
+    uint32_t last = (addr + len - 1) / PMM_PAGE_SIZE;
+    if (last >= PMM_NUM_PAGES) last = PMM_NUM_PAGES - 1;
+    uint32_t flags = irq_save();
+    for (uint32_t i = first; i <= last; ++i)
+        pmm_bitmap[i / 8] |= (1 << (i % 8));
+    irq_restore(flags);
+}
+
+void *alloc_page(void) {
+    uint32_t flags = irq_save(); // idle refills the zero pool concurrently
+    for (int i = 0; i < PMM_NUM_PAGES; ++i) {
+        if (!(pmm_bitmap[i / 8] & (1 << (i % 8)))) {
+            pmm_bitmap[i / 8] |= (1 << (i % 8));
+            irq_restore(flags);
+            return (void *)(uintptr_t)(i * PMM_PAGE_SIZE);
+        }
+    }
+    irq_restore(flags);
+    return 0; // Out of memory
+}
+
+void free_page(void *addr) {
+    int i = (uintptr_t)addr / PMM_PAGE_SIZE;
+    uint32_t flags = irq_save();
+    pmm_bitmap[i / 8] &= ~(1 << (i % 8));
+    irq_restore(flags);
+}
+
+// --- Frames beyond the bitmap ---
+typedef struct pmm_region {
+    uint64_t next, end; // [next, end) never handed out yet
+} pmm_region_t;
+
+static pmm_region_t regions[PMM_MAX_REGIONS];
+static int nregions = 0;
+static uint64_t high_free_list = 0; // 0 terminates: frame 0 is never high
+static uint32_t high_total = 0, high_free = 0;
+
+static void pmm_high_reset(void) {
+    nregions = 0;
+    high_free_list = 0;
+    high_total = high_free = 0;
+}
+
+int pmm_add_region(uint64_t base, uint64_t len) {
+    uint64_t end = (base + len) & ~(uint64_t)(PMM_PAGE_SIZE - 1);
+    base = (base + PMM_PAGE_SIZE - 1) & ~(uint64_t)(PMM_PAGE_SIZE - 1);
+    if (base < PMM_TOTAL_MEM) base = PMM_TOTAL_MEM; // the bitmap owns what is below
+    if (end <= base) return 1;
+    uint32_t flags = irq_save();
+    if (nregions == PMM_MAX_REGIONS) {
+        irq_restore(flags);
+        return 0;
+    }
+    regions[nregions].next = base;
+    regions[nregions].end = end;
+    nregions++;
+    uint32_t frames = (uint32_t)((end - base) / PMM_PAGE_SIZE);
+    high_total += frames;
+    high_free += frames;
+    irq_restore(flags);
+    return 1;
+}
+
+uint64_t pmm_alloc_frame(void) {
+    uint32_t flags = irq_save();
+    uint64_t pa = high_free_list;
+    if (pa) {
+        uint64_t *link = PMM_KMAP(pa);
+        high_free_list = *link;
+        PMM_KUNMAP(link);
+    } else {
+        for (int i = 0; i < nregions && !pa; ++i) {
+            if (regions[i].next < regions[i].end) {
+                pa = regions[i].next;
+                regions[i].next += PMM_PAGE_SIZE;
+            }
+        }
+    }
+    if (pa) {
+        high_free--;
+        irq_restore(flags);
+    } else {
+        // Any bitmap page will do: the frame is zeroed through kmap, which
+        // also reaches the part of the bitmap above the identity map
+        irq_restore(flags);
+        pa = (uintptr_t)alloc_page();
+        if (!pa) return 0;
+    }
+    void *page = PMM_KMAP(pa);
+    memset(page, 0, PMM_PAGE_SIZE);
+    PMM_KUNMAP(page);
+    return pa;
+}
+
+void pmm_free_frame(uint64_t pa) {
+    if (pa < PMM_TOTAL_MEM) {
+        free_page((void *)(uintptr_t)pa);
+        return;
+    }
+    uint32_t flags = irq_save();
+    uint64_t *link = PMM_KMAP(pa);
+    *link = high_free_list;
+    PMM_KUNMAP(link);
+    high_free_list = pa;
+    high_free++;
+    irq_restore(flags);
+}
+
+void pmm_high_stats(uint32_t *total, uint32_t *free_frames) {
+    uint32_t flags = irq_save();
+    *total = high_total;
+    *free_frames = high_free;
+    irq_restore(flags);
+}
+
+// Pre-zeroed page pool. The idle task tops it up to the high watermark once
+// it drops below the low one, zeroing with non-temporal stores so the work
+// does not evict anyone's cache. alloc_zeroed_page() takes from the pool and
+// only zeroes synchronously when it is empty.
+#define ZPOOL_MAX 256
+static void *zpool[ZPOOL_MAX];
+static volatile int zpool_count = 0;
+static int zpool_low = 16;
+static int zpool_high = 64;
+static volatile int zpool_filling = 0; // refill in progress, until high is reached
+static uint32_t zpool_hits = 0, zpool_misses = 0, zpool_refilled = 0;
+
+// Zeroed pages are written, and used by their callers, through the identity
+// map: a page above it goes straight back, since low memory ran out
+static void *alloc_direct_page(void) {
+    void *page = alloc_page();
+    if (page && (uintptr_t)page + PMM_PAGE_SIZE > IDENTITY_MAP_END) {
+        free_page(page);
+        return NULL;
+    }
+    return page;
+}
+
+// Pooled pages live in the bitmap as allocated, so dropping them is enough
+static void pmm_zpool_reset(void) {
+    zpool_count = 0;
+    zpool_filling = 0;
+    zpool_hits = zpool_misses = zpool_refilled = 0;
+}
+
+void *alloc_zeroed_page(void) {
+    uint32_t flags = irq_save();
+    if (zpool_count > 0) {
+        void *page = zpool[--zpool_count];
+        zpool_hits++;
+        if (zpool_count < zpool_low) zpool_filling = 1;
+        irq_restore(flags);
+        return page;
+    }
+    zpool_misses++;
+    zpool_filling = 1;
+    irq_restore(flags);
+    void *page = alloc_direct_page();
+    if (page) memset(PHYS_TO_VIRT(page), 0, PMM_PAGE_SIZE);
+    return page;
+}
+
+int pmm_zpool_needs_refill(void) {
+    return zpool_filling;
+}
+
+// Zero one page into the pool; returns 0 once the pool is full or memory ran out
+int pmm_zpool_refill(void) {
+    if (zpool_count >= zpool_high) {
+        zpool_filling = 0;
+        return 0;
+    }
+    void *page = alloc_direct_page();
+    if (!page) {
+        zpool_filling = 0;
+        return 0;
+    }
+    memzero_nt(PHYS_TO_VIRT(page), PMM_PAGE_SIZE);
+    uint32_t flags = irq_save();
+    if (zpool_count < zpool_high) {
+        zpool[zpool_count++] = page;
+        zpool_refilled++;
+        page = 0;
+    }
+    irq_restore(flags);
+    if (page) free_page(page); // high watermark lowered meanwhile
+    return 1;
+}
+
+// Returns 0 if the watermarks are out of range; surplus pages go back to the PMM
+int pmm_zpool_set_watermarks(int low, int high) {
+    if (low < 0 || high < low || high > ZPOOL_MAX) return 0;
+    uint32_t flags = irq_save();
+    zpool_low = low;
+    zpool_high = high;
+    while (zpool_count > zpool_high) free_page(zpool[--zpool_count]);
+    if (zpool_count < zpool_low) zpool_filling = 1;
+    irq_restore(flags);
+    return 1;
+}
+
+void pmm_zpool_stats(pmm_zpool_stats_t *st) {
+    uint32_t flags = irq_save();
+    st->count = zpool_count;
+    st->low = zpool_low;
+    st->high = zpool_high;
+    st->hits = zpool_hits;
+    st->misses = zpool_misses;
+    st->refilled = zpool_refilled;
+    irq_restore(flags);
+}
+
@@ -0,0 +1,57 @@
+#ifndef PMM_H
+#define PMM_H
+
+#include <stdint.h>
+
+// Physical memory manager: one bit per 4 KB page, first-fit scan
+#define PMM_TOTAL_MEM (32 * 1024 * 1024) // 32MB for demo
+#define PMM_PAGE_SIZE 4096
+#define PMM_NUM_PAGES (PMM_TOTAL_MEM / PMM_PAGE_SIZE)
+#define PMM_BITMAP_SIZE (PMM_NUM_PAGES / 8)
+
+// Where the PMM touches page contents. The kernel identity-maps physical
+// memory; host tests back it with a malloc'd arena.
+#ifdef KERNEL_HOST_TEST
+extern uint8_t *pmm_host_base;
+#define PHYS_TO_VIRT(pa) ((void *)(pmm_host_base + (uintptr_t)(pa)))
+#define PMM_KMAP(pa) PHYS_TO_VIRT(pa)
+#define PMM_KUNMAP(va) ((void)(va))
+#else
+#define PHYS_TO_VIRT(pa) ((void *)(uintptr_t)(pa))
+#define PMM_KMAP(pa) kmap(pa)
+#define PMM_KUNMAP(va) kunmap(va)
+#endif
+
+void pmm_init(void);
+void *alloc_page(void);
+void free_page(void *addr);
+// Mark the pages covering [addr, addr+len) as in use (boot modules etc.)
+void pmm_reserve(uint32_t addr, uint32_t len);
+
+// Frames beyond the bitmap: RAM above PMM_TOTAL_MEM, including above 4 GB
+// under PAE. The kernel reaches them only through kmap(), so they back
+// memory it does not address directly, such as user pages. Free frames
+// are kept on a list linked through the frames themselves; pages never
+// handed out are carved from the regions on demand.
+#define PMM_MAX_REGIONS 8
+int pmm_add_region(uint64_t base, uint64_t len); // 0 if the table is full
+// A zeroed frame from the regions, or from the bitmap once they are used
+// up; 0 when out of memory
+uint64_t pmm_alloc_frame(void);
+void pmm_free_frame(uint64_t pa);
+void pmm_high_stats(uint32_t *total, uint32_t *free_frames);
+
+// Pre-zeroed page pool, refilled by the idle task. Zeroed pages always lie
+// below IDENTITY_MAP_END; once that memory is used up alloc_zeroed_page()
+// returns NULL even if the bitmap has pages above it.
+typedef struct pmm_zpool_stats {
+    int count, low, high;
+    uint32_t hits, misses, refilled;
+} pmm_zpool_stats_t;
+void *alloc_zeroed_page(void);
+int pmm_zpool_needs_refill(void);
+int pmm_zpool_refill(void);
+int pmm_zpool_set_watermarks(int low, int high);
+void pmm_zpool_stats(pmm_zpool_stats_t *st);
+
+#endif // PMM_H
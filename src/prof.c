@@ -0,0 +1,112 @@
+#include "prof.h"
+#include "klog.h"
+#include "serial.h"
+#include <stdint.h>
+
+typedef struct prof_bucket {
+    uint32_t count;
+    uint32_t depth;
+    uint32_t pc[PROF_DEPTH];
+} prof_bucket_t;
+
+static prof_bucket_t prof_table[PROF_BUCKETS];
+static volatile int prof_on = 0;
+static uint32_t prof_total = 0;
+static uint32_t prof_lost = 0; // table full
+
+// Frame pointers must stay inside identity-mapped kernel memory and move
+// towards the stack top, otherwise the walk stops.
+#define PROF_MIN_ADDR 0x100000
+#define PROF_MAX_ADDR 0x1000000
+
+static int frame_ok(uint32_t ebp, uint32_t prev) {
+    return ebp > prev && !(ebp & 3) && ebp >= PROF_MIN_ADDR && ebp + 8 <= PROF_MAX_ADDR;
+}
+
+void prof_sample(const irq_frame_t *frame) {
+    if (!prof_on) return;
+    uint32_t pc[PROF_DEPTH];
+    uint32_t depth = 0;
+    pc[depth++] = frame->eip;
+    if ((frame->cs & 3) == 0) { // only walk kernel stacks
+        uint32_t ebp = frame->ebp, prev = 0;
+        while (depth < PROF_DEPTH && frame_ok(ebp, prev)) {
+            uint32_t ret = ((uint32_t *)ebp)[1];
+            if (!ret) break;
+            pc[depth++] = ret;
+            prev = ebp;
+            ebp = ((uint32_t *)ebp)[0];
+        }
+    }
+
+    uint32_t h = 2166136261u; // FNV-1a over the PCs
+    for (uint32_t i = 0; i < depth; ++i) h = (h ^ pc[i]) * 16777619u;
+    for (uint32_t probe = 0; probe < PROF_BUCKETS; ++probe) {
+        prof_bucket_t *b = &prof_table[(h + probe) & (PROF_BUCKETS - 1)];
+        if (b->count == 0) {
+            b->depth = depth;
+            for (uint32_t i = 0; i < depth; ++i) b->pc[i] = pc[i];
+            b->count = 1;
+            prof_total++;
+            return;
+        }
+        if (b->depth == depth) {
+            uint32_t i = 0;
+            while (i < depth && b->pc[i] == pc[i]) i++;
+            if (i == depth) {
+                b->count++;
+                prof_total++;
+                return;
+            }
+        }
+    }
+    prof_lost++;
+}
+
+void prof_start(void) {
+    prof_on = 1;
+}
+
+void prof_stop(void) {
+    prof_on = 0;
+}
+
+int prof_running(void) {
+    return prof_on;
+}
+
+void prof_reset(void) {
+    int was_on = prof_on;
+    prof_on = 0;
+    for (int i = 0; i < PROF_BUCKETS; ++i) prof_table[i].count = 0;
+    prof_total = prof_lost = 0;
+    prof_on = was_on;
+}
+
+uint32_t prof_samples(void) {
+    return prof_total;
+}
+
+uint32_t prof_dropped(void) {
+    return prof_lost;
+}
+
+void prof_dump(void) {
+    char line[16 + PROF_DEPTH * 9];
+    int was_on = prof_on;
+    prof_on = 0; // keep the table stable while it is read out
+    int n = ksnprintf(line, sizeof(line), "PROF BEGIN samples=%u dropped=%u\n",
+                      prof_total, prof_lost);
+    serial_write_wait(line, n);
+    for (int i = 0; i < PROF_BUCKETS; ++i) {
+        prof_bucket_t *b = &prof_table[i];
+        if (!b->count) continue;
+        n = ksnprintf(line, sizeof(line), "P %u", b->count);
+        for (uint32_t d = 0; d < b->depth; ++d)
+            n += ksnprintf(line + n, sizeof(line) - n, " %x", b->pc[d]);
+        line[n++] = '\n';
+        serial_write_wait(line, n);
+    }
+    serial_write_wait("PROF END\n", 9);
+    prof_on = was_on;
+}
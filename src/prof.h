@@ -0,0 +1,24 @@
+#ifndef PROF_H
+#define PROF_H
+
+#include <stdint.h>
+#include "kernel.h"
+
+// Timer-driven sampling profiler. Each tick records the interrupted EIP plus
+// a frame-pointer backtrace; identical stacks share a histogram bucket.
+#define PROF_DEPTH   8    // PCs per sample, interrupted EIP first
+#define PROF_BUCKETS 1024 // distinct stacks, power of two
+
+void prof_sample(const irq_frame_t *frame); // timer IRQ context
+void prof_start(void);
+void prof_stop(void);
+void prof_reset(void);
+int prof_running(void);
+uint32_t prof_samples(void);
+uint32_t prof_dropped(void);
+
+// Write the histogram to serial between "PROF BEGIN"/"PROF END" lines for
+// tools/profsym.py
+void prof_dump(void);
+
+#endif // PROF_H
@@ -0,0 +1,217 @@
+#include "ramfs.h"
+#include "kernel.h"
+#include "klib.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define RADIX_SLOTS (1u << RAMFS_RADIX_SHIFT)
+#define RADIX_MASK  (RADIX_SLOTS - 1)
+#define PAGE_SHIFT  12
+#define PAGE_PTR(pa) ((uint8_t *)PHYS_TO_VIRT(pa))
+
+static ramfs_dentry_t *dhash[RAMFS_DHASH];
+static ramfs_dentry_t *root = NULL;
+static uint32_t next_ino = 1;
+static ramfs_stats_t stats;
+
+static uint32_t name_hash(const ramfs_dentry_t *parent, const char *name, uint32_t len) {
+    uint32_t h = 2166136261u ^ (uint32_t)(uintptr_t)parent; // FNV-1a, seeded by the parent
+    for (uint32_t i = 0; i < len; ++i) h = (h ^ (uint8_t)name[i]) * 16777619u;
+    return h;
+}
+
+// Data and radix pages are reached through the identity map, which is
+// where alloc_zeroed_page() takes them from; it fails rather than go past
+// its end. 0 means no page: page 0 is never handed out.
+static uint32_t alloc_fs_page(void) {
+    void *p = alloc_zeroed_page();
+    if (p) stats.pages++;
+    return (uint32_t)(uintptr_t)p;
+}
+
+static void free_fs_page(uint32_t pa) {
+    free_page((void *)(uintptr_t)pa);
+    stats.pages--;
+}
+
+static uint32_t capacity(int height) { // pages addressable at this height
+    return 1u << (RAMFS_RADIX_SHIFT * height);
+}
+
+// Physical address of page `index` of the file, or 0. With `create`, the
+// tree grows and missing nodes and the page itself are allocated.
+static uint32_t radix_get(ramfs_inode_t *ino, uint32_t index, int create) {
+    while (index >= capacity(ino->height)) {
+        if (!create) return 0;
+        if (ino->root) { // the old tree becomes slot 0 of a new root
+            uint32_t node = alloc_fs_page();
+            if (!node) return 0;
+            ino->npages++;
+            ((uint32_t *)PAGE_PTR(node))[0] = ino->root;
+            ino->root = node;
+        }
+        ino->height++;
+    }
+    uint32_t *slot = &ino->root;
+    for (int h = ino->height; h > 0; --h) {
+        if (!*slot) {
+            if (!create || !(*slot = alloc_fs_page())) return 0;
+            ino->npages++;
+        }
+        slot = (uint32_t *)PAGE_PTR(*slot) + ((index >> (RAMFS_RADIX_SHIFT * (h - 1))) & RADIX_MASK);
+    }
+    if (!*slot && create && (*slot = alloc_fs_page())) ino->npages++;
+    return *slot;
+}
+
+static void radix_free(uint32_t node, int height) {
+    if (!node) return;
+    if (height > 0) {
+        uint32_t *slots = (uint32_t *)PAGE_PTR(node);
+        for (uint32_t i = 0; i < RADIX_SLOTS; ++i) radix_free(slots[i], height - 1);
+    }
+    free_fs_page(node);
+}
+
+static ramfs_dentry_t *new_dentry(ramfs_dentry_t *parent, const char *name, uint32_t len, int is_dir) {
+    ramfs_dentry_t *d = kmalloc(sizeof(ramfs_dentry_t));
+    ramfs_inode_t *ino = kmalloc(sizeof(ramfs_inode_t));
+    if (!d || !ino) {
+        if (d) kfree(d);
+        if (ino) kfree(ino);
+        return NULL;
+    }
+    memset(ino, 0, sizeof(*ino));
+    ino->ino = next_ino++;
+    ino->is_dir = is_dir;
+    ino->nlink = 1;
+    memcpy(d->name, name, len);
+    d->name[len] = 0;
+    d->inode = ino;
+    d->parent = parent ? parent : d;
+    d->hash = name_hash(d->parent, name, len);
+    d->hash_next = NULL;
+    d->sibling = NULL;
+    stats.inodes++;
+    stats.dentries++;
+    return d;
+}
+
+int ramfs_init(void) {
+    if (root) return 0;
+    root = new_dentry(NULL, "", 0, 1);
+    return root ? 0 : -1;
+}
+
+ramfs_dentry_t *ramfs_root(void) {
+    return root;
+}
+
+ramfs_dentry_t *ramfs_lookup(ramfs_dentry_t *dir, const char *name, uint32_t len) {
+    if (len > RAMFS_NAME_MAX) return NULL;
+    uint32_t h = name_hash(dir, name, len);
+    stats.lookups++;
+    for (ramfs_dentry_t *d = dhash[h & (RAMFS_DHASH - 1)]; d; d = d->hash_next) {
+        stats.probes++;
+        if (d->hash == h && d->parent == dir && !memcmp(d->name, name, len) && !d->name[len]) return d;
+    }
+    return NULL;
+}
+
+ramfs_dentry_t *ramfs_create(ramfs_dentry_t *dir, const char *name, uint32_t len, int is_dir) {
+    if (!dir->inode->is_dir || !len || len > RAMFS_NAME_MAX) return NULL;
+    ramfs_dentry_t *d = new_dentry(dir, name, len, is_dir);
+    if (!d) return NULL;
+    ramfs_dentry_t **bucket = &dhash[d->hash & (RAMFS_DHASH - 1)];
+    d->hash_next = *bucket;
+    *bucket = d;
+    d->sibling = dir->inode->children;
+    dir->inode->children = d;
+    dir->inode->nchildren++;
+    return d;
+}
+
+static void free_inode(ramfs_inode_t *ino) {
+    ramfs_truncate(ino);
+    kfree(ino);
+    stats.inodes--;
+}
+
+int ramfs_unlink(ramfs_dentry_t *d) {
+    ramfs_inode_t *ino = d->inode;
+    if (d == root || (ino->is_dir && ino->children)) return -1;
+    for (ramfs_dentry_t **p = &dhash[d->hash & (RAMFS_DHASH - 1)]; *p; p = &(*p)->hash_next) {
+        if (*p == d) {
+            *p = d->hash_next;
+            break;
+        }
+    }
+    ramfs_inode_t *dir = d->parent->inode;
+    for (ramfs_dentry_t **p = &dir->children; *p; p = &(*p)->sibling) {
+        if (*p == d) {
+            *p = d->sibling;
+            break;
+        }
+    }
+    dir->nchildren--;
+    kfree(d);
+    stats.dentries--;
+    ino->nlink = 0;
+    if (!ino->open_count) free_inode(ino);
+    return 0;
+}
+
+void ramfs_iget(ramfs_inode_t *inode) {
+    inode->open_count++;
+}
+
+void ramfs_iput(ramfs_inode_t *inode) {
+    if (--inode->open_count == 0 && !inode->nlink) free_inode(inode);
+}
+
+int ramfs_read(ramfs_inode_t *inode, uint32_t off, void *buf, uint32_t n) {
+    if (off >= inode->size) return 0;
+    if (n > inode->size - off) n = inode->size - off;
+    uint32_t done = 0;
+    while (done < n) {
+        uint32_t pos = off + done;
+        uint32_t in_page = pos & (PMM_PAGE_SIZE - 1);
+        uint32_t chunk = PMM_PAGE_SIZE - in_page;
+        if (chunk > n - done) chunk = n - done;
+        uint32_t page = radix_get(inode, pos >> PAGE_SHIFT, 0);
+        if (page) memcpy((uint8_t *)buf + done, PAGE_PTR(page) + in_page, chunk);
+        else memset((uint8_t *)buf + done, 0, chunk); // hole
+        done += chunk;
+    }
+    return (int)done;
+}
+
+int ramfs_write(ramfs_inode_t *inode, uint32_t off, const void *buf, uint32_t n) {
+    if (off >= RAMFS_MAX_SIZE) return n ? -1 : 0;
+    if (n > RAMFS_MAX_SIZE - off) n = RAMFS_MAX_SIZE - off;
+    uint32_t done = 0;
+    while (done < n) {
+        uint32_t pos = off + done;
+        uint32_t in_page = pos & (PMM_PAGE_SIZE - 1);
+        uint32_t chunk = PMM_PAGE_SIZE - in_page;
+        if (chunk > n - done) chunk = n - done;
+        uint32_t page = radix_get(inode, pos >> PAGE_SHIFT, 1);
+        if (!page) break; // out of memory: short write
+        memcpy(PAGE_PTR(page) + in_page, (const uint8_t *)buf + done, chunk);
+        done += chunk;
+    }
+    if (off + done > inode->size) inode->size = off + done;
+    return (done || !n) ? (int)done : -1;
+}
+
+void ramfs_truncate(ramfs_inode_t *inode) {
+    radix_free(inode->root, inode->height);
+    inode->root = 0;
+    inode->height = 0;
+    inode->npages = 0;
+    inode->size = 0;
+}
+
+void ramfs_stats(ramfs_stats_t *st) {
+    *st = stats;
+}
@@ -0,0 +1,64 @@
+#ifndef RAMFS_H
+#define RAMFS_H
+
+#include <stdint.h>
+
+// In-memory filesystem. File contents live in whole PMM pages found through
+// a per-file radix tree of page-sized nodes (1024 physical page addresses
+// each), allocated as the file grows and returned when it is removed. The
+// namespace itself is the dentry cache: every name is a dentry hashed on
+// (parent, name), so a path walk is one hash probe per component.
+#define RAMFS_NAME_MAX   27
+#define RAMFS_DHASH      128
+#define RAMFS_RADIX_SHIFT 10 // slots per node: one page of uint32_t
+#define RAMFS_MAX_SIZE   0x40000000u // 1 GB, two radix levels
+
+typedef struct ramfs_inode {
+    uint32_t ino;
+    int is_dir;
+    int nlink;     // 0 once unlinked
+    int open_count; // open files; the inode outlives its name until 0
+    uint32_t size;
+    uint32_t root;   // radix root: data page at height 0, else node page
+    int height;
+    uint32_t npages; // data and node pages held
+    struct ramfs_dentry *children; // directories: first child
+    uint32_t nchildren;
+} ramfs_inode_t;
+
+typedef struct ramfs_dentry {
+    char name[RAMFS_NAME_MAX + 1];
+    uint32_t hash;
+    ramfs_inode_t *inode;
+    struct ramfs_dentry *parent;
+    struct ramfs_dentry *hash_next;
+    struct ramfs_dentry *sibling; // next child of the parent
+} ramfs_dentry_t;
+
+typedef struct ramfs_stats {
+    uint32_t inodes, dentries, pages;
+    uint32_t lookups, probes; // dcache lookups and chain entries examined
+} ramfs_stats_t;
+
+int ramfs_init(void);
+ramfs_dentry_t *ramfs_root(void);
+
+// Child `name` (len bytes) of `dir`, or NULL
+ramfs_dentry_t *ramfs_lookup(ramfs_dentry_t *dir, const char *name, uint32_t len);
+// New empty file or directory; NULL when out of memory (name checked by caller)
+ramfs_dentry_t *ramfs_create(ramfs_dentry_t *dir, const char *name, uint32_t len, int is_dir);
+// Remove the name; the inode goes with it unless still open. Directories
+// must be empty. Returns 0 or -1.
+int ramfs_unlink(ramfs_dentry_t *d);
+void ramfs_iget(ramfs_inode_t *inode); // take an open reference
+void ramfs_iput(ramfs_inode_t *inode); // drop one
+
+// Byte I/O; holes read as zeros. Return bytes transferred, or -1 when a
+// write runs out of pages before anything was written.
+int ramfs_read(ramfs_inode_t *inode, uint32_t off, void *buf, uint32_t n);
+int ramfs_write(ramfs_inode_t *inode, uint32_t off, const void *buf, uint32_t n);
+void ramfs_truncate(ramfs_inode_t *inode); // to zero length, pages freed
+
+void ramfs_stats(ramfs_stats_t *st);
+
+#endif // RAMFS_H
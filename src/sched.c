@@ -0,0 +1,38 @@
+#include "sched.h"
+#include <stddef.h>
+
+task_t *sched_pick_deadline(task_t *head, task_t *current) {
+    task_t *best = NULL;
+    for (task_t *t = head; t; t = t->next) {
+        if (!t->dl_period || !sched_runnable(t)) continue;
+        if (!best) {
+            best = t;
+            continue;
+        }
+        int32_t d = (int32_t)(t->dl_abs_deadline - best->dl_abs_deadline);
+        if (d < 0 || (d == 0 && t == current)) best = t;
+    }
+    return best;
+}
+
+task_t *sched_pick(task_t *head, task_t *current, task_t *idle) {
+    if (!current) return head;
+    task_t *start = current;
+    task_t *next = current->next ? current->next : head;
+    while (next != start) {
+        if (sched_runnable(next) && next != idle)
+            return next;
+        next = next->next ? next->next : head;
+    }
+    if (sched_runnable(current) && current != idle)
+        return current;
+    next = head;
+    do {
+        if (sched_runnable(next) && next != idle)
+            return next;
+        next = next->next ? next->next : head;
+    } while (next != head);
+    if (idle && sched_runnable(idle))
+        return idle;
+    return current;
+}
@@ -0,0 +1,22 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include "task.h"
+
+// A READY task may run unless it is a deadline task out of budget
+static inline int sched_runnable(const task_t *t) {
+    return t->state == TASK_READY && !t->dl_throttled;
+}
+
+// Scheduling policy, kept free of hardware state so it also builds on the
+// host. Returns the task to run after `current` from the list at `head`:
+// round-robin over runnable tasks, skipping sleeping/blocked/terminated
+// ones; `idle` only when nothing else is ready.
+task_t *sched_pick(task_t *head, task_t *current, task_t *idle);
+
+// Deadline class, consulted first while any deadline task exists: the
+// runnable one with the earliest absolute deadline (the current task wins
+// ties), or NULL
+task_t *sched_pick_deadline(task_t *head, task_t *current);
+
+#endif // SCHED_H
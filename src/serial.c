@@ -0,0 +1,235 @@
+#include "serial.h"
+#include "cpu.h"
+#include "task.h"
+#include "trace.h"
+#include "klib.h"
+#include "console.h"
+#include <stdint.h>
+
+#define COM1_PORT 0x3F8
+
+// 16550 register offsets
+#define UART_DATA 0 // RBR/THR, DLL when DLAB=1
+#define UART_IER  1 // DLM when DLAB=1
+#define UART_IIR  2 // FCR on write
+#define UART_LCR  3
+#define UART_MCR  4
+#define UART_LSR  5
+#define UART_MSR  6
+
+#define IER_RDA  0x01
+#define IER_THRE 0x02
+#define IER_LSI  0x04
+
+#define UART_FIFO_DEPTH 16
+
+// Ring sizes must be powers of two
+#define SERIAL_TX_SIZE 4096
+#define SERIAL_RX_SIZE 128
+
+static volatile char tx_buf[SERIAL_TX_SIZE];
+static volatile uint32_t tx_head = 0; // written by producers
+static volatile uint32_t tx_tail = 0; // advanced by the THRE interrupt
+static volatile int tx_active = 0;    // THRE interrupt armed
+static volatile uint32_t tx_dropped = 0;
+
+static volatile char rx_buf[SERIAL_RX_SIZE];
+static volatile uint32_t rx_head = 0;
+static volatile uint32_t rx_tail = 0;
+
+static int present = 0;
+static int polled = 0;   // panic mode: bypass the rings
+static uint8_t ier_shadow = 0;
+
+// Escape sequence decoder state for terminal arrow/home/end/delete keys
+static uint8_t esc_state = 0;
+
+static void rx_push(char c) {
+    uint32_t next = (rx_head + 1) & (SERIAL_RX_SIZE - 1);
+    if (next != rx_tail) { // drop when full
+        rx_buf[rx_head] = c;
+        rx_head = next;
+    }
+}
+
+static void rx_decode(uint8_t b) {
+    if (esc_state == 1) {
+        esc_state = (b == '[' || b == 'O') ? 2 : 0;
+        return;
+    }
+    if (esc_state == 2) {
+        esc_state = 0;
+        switch (b) {
+            case 'A': rx_push((char)0x82); return; // Up arrow
+            case 'B': rx_push((char)0x83); return; // Down arrow
+            case 'C': rx_push((char)0x81); return; // Right arrow
+            case 'D': rx_push((char)0x80); return; // Left arrow
+            case 'H': rx_push((char)0x84); return; // Home
+            case 'F': rx_push((char)0x85); return; // End
+            case '3': esc_state = 3; return;       // Delete is ESC [ 3 ~
+            default: return;
+        }
+    }
+    if (esc_state == 3) {
+        esc_state = 0;
+        if (b == '~') rx_push((char)0x86);
+        return;
+    }
+    if (b == 0x1B) { esc_state = 1; return; }
+    if (b == '\r') b = '\n';
+    else if (b == 0x7F) b = '\b';
+    if (b == '\n' || b == '\b' || b == '\t' || (b >= 0x20 && b < 0x7F))
+        rx_push((char)b);
+}
+
+// Fill the (empty) transmit FIFO from the ring, disarm THRE when drained
+static void tx_fill(void) {
+    int n = 0;
+    while (tx_tail != tx_head && n < UART_FIFO_DEPTH) {
+        outb(COM1_PORT + UART_DATA, tx_buf[tx_tail]);
+        tx_tail = (tx_tail + 1) & (SERIAL_TX_SIZE - 1);
+        n++;
+    }
+    if (tx_tail == tx_head) {
+        tx_active = 0;
+        ier_shadow &= ~IER_THRE;
+        outb(COM1_PORT + UART_IER, ier_shadow);
+    }
+}
+
+void serial_interrupt_handler(void) {
+    TRACE(TRACE_IRQ_ENTRY, 0x24, 0);
+    uint8_t iir;
+    while (!((iir = inb(COM1_PORT + UART_IIR)) & 0x01)) {
+        switch ((iir >> 1) & 0x07) {
+            case 0x2: // Received data available
+            case 0x6: // Character timeout
+                while (inb(COM1_PORT + UART_LSR) & 0x01)
+                    rx_decode(inb(COM1_PORT + UART_DATA));
+                console_kick();
+                break;
+            case 0x1: // Transmitter holding register empty
+                tx_fill();
+                break;
+            case 0x3: // Line status
+                (void)inb(COM1_PORT + UART_LSR);
+                break;
+            default:  // Modem status
+                (void)inb(COM1_PORT + UART_MSR);
+                break;
+        }
+    }
+    TRACE(TRACE_IRQ_EXIT, 0x24, 0);
+}
+
+void serial_init(void) {
+    outb(COM1_PORT + UART_IER, 0x00);  // Disable interrupts
+    outb(COM1_PORT + UART_LCR, 0x80);  // DLAB on
+    outb(COM1_PORT + UART_DATA, 0x01); // Divisor 1: 115200 baud
+    outb(COM1_PORT + UART_IER, 0x00);
+    outb(COM1_PORT + UART_LCR, 0x03);  // 8N1, DLAB off
+    outb(COM1_PORT + UART_IIR, 0xC7);  // Enable + clear FIFOs, 14-byte RX trigger
+
+    // Loopback self-test so a missing UART does not swallow output
+    outb(COM1_PORT + UART_MCR, 0x1E);
+    outb(COM1_PORT + UART_DATA, 0xAE);
+    if (inb(COM1_PORT + UART_DATA) != 0xAE) {
+        present = 0;
+        return;
+    }
+    present = 1;
+
+    outb(COM1_PORT + UART_MCR, 0x0B);  // DTR, RTS, OUT2 (routes IRQ4)
+    ier_shadow = IER_RDA | IER_LSI;
+    outb(COM1_PORT + UART_IER, ier_shadow);
+}
+
+int serial_present(void) {
+    return present;
+}
+
+int serial_write(const char *buf, int len) {
+    if (!present) return 0;
+    if (polled) {
+        for (int i = 0; i < len; ++i) {
+            while (!(inb(COM1_PORT + UART_LSR) & 0x20)) ;
+            outb(COM1_PORT + UART_DATA, buf[i]);
+        }
+        return len;
+    }
+    uint32_t flags = irq_save();
+    int written = 0;
+    for (; written < len; ++written) {
+        uint32_t next = (tx_head + 1) & (SERIAL_TX_SIZE - 1);
+        if (next == tx_tail) break;
+        tx_buf[tx_head] = buf[written];
+        tx_head = next;
+    }
+    tx_dropped += len - written;
+    if (written && !tx_active) {
+        // Arming THRE with an empty holding register raises the interrupt
+        // immediately, so the ISR starts the transfer.
+        tx_active = 1;
+        ier_shadow |= IER_THRE;
+        outb(COM1_PORT + UART_IER, ier_shadow);
+    }
+    irq_restore(flags);
+    return written;
+}
+
+int serial_tx_space(void) {
+    return (SERIAL_TX_SIZE - 1) - ((tx_head - tx_tail) & (SERIAL_TX_SIZE - 1));
+}
+
+void serial_write_wait(const char *buf, int len) {
+    if (!present) return;
+    while (len > 0) {
+        int chunk = serial_tx_space();
+        if (chunk == 0) {
+            task_yield(); // let the THRE interrupt drain the ring
+            continue;
+        }
+        if (chunk > len) chunk = len;
+        serial_write(buf, chunk);
+        buf += chunk;
+        len -= chunk;
+    }
+}
+
+void serial_flush(void) {
+    if (!present || polled) return;
+    while (tx_head != tx_tail) task_yield();
+    while (!(inb(COM1_PORT + UART_LSR) & 0x40)) task_yield(); // transmitter empty
+}
+
+void serial_puts(const char *str) {
+    serial_write(str, strlen(str));
+}
+
+char serial_getchar(void) {
+    if (rx_head == rx_tail)
+        return 0;
+    char c = rx_buf[rx_tail];
+    rx_tail = (rx_tail + 1) & (SERIAL_RX_SIZE - 1);
+    return c;
+}
+
+int serial_has_input(void) {
+    return rx_head != rx_tail;
+}
+
+void serial_enter_panic_mode(void) {
+    if (!present) return;
+    polled = 1;
+    outb(COM1_PORT + UART_IER, 0x00);
+    // Push out whatever is still queued before polled writes follow it
+    while (tx_tail != tx_head) {
+        while (!(inb(COM1_PORT + UART_LSR) & 0x20)) ;
+        outb(COM1_PORT + UART_DATA, tx_buf[tx_tail]);
+        tx_tail = (tx_tail + 1) & (SERIAL_TX_SIZE - 1);
+    }
+}
+
+uint32_t serial_tx_dropped(void) {
+    return tx_dropped;
+}
@@ -0,0 +1,31 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include <stdint.h>
+
+// COM1 16550 UART, interrupt driven (IRQ4, vector 0x24)
+void serial_init(void);
+int serial_present(void);
+
+// Queue bytes for transmission; never waits for the UART. Bytes that do not
+// fit in the TX ring are dropped and counted.
+int serial_write(const char *buf, int len);
+void serial_puts(const char *str);
+
+// Bulk output from task context (dumps): yields while the TX ring is full
+// instead of dropping. Never call from IRQ context.
+void serial_write_wait(const char *buf, int len);
+int serial_tx_space(void);
+// Yield until everything queued has left the UART (task context)
+void serial_flush(void);
+
+// Non-blocking read, same key codes as keyboard_getchar (0 when empty)
+char serial_getchar(void);
+int serial_has_input(void);
+
+uint32_t serial_tx_dropped(void);
+
+// Switch to polled output for the panic path (interrupts are off for good)
+void serial_enter_panic_mode(void);
+
+#endif // SERIAL_H
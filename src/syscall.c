@@ -0,0 +1,102 @@
+#include "syscall.h"
+#include "usyscall.h"
+#include "kernel.h"
+#include "task.h"
+#include "gdt.h"
+#include "cpu.h"
+#include "klog.h"
+#include "klib.h"
+#include "vm.h"
+#include <stdint.h>
+
+extern void asm_syscall_int80(void);
+extern void asm_sysenter_entry(void);
+
+#define SYS_WRITE_MAX 80 // one log line per call
+
+// Loaded programs are checked against their VMAs (the copy may then fault
+// pages in); built-in ring-3 code against the identity map
+static int user_range_ok(uint32_t addr, uint32_t len, int write) {
+    task_t *t = get_current_task();
+    if (t->as) return vm_user_ok(t->as, addr, len, write);
+    return paging_user_ok(addr, len);
+}
+
+static int32_t sys_null(uint32_t a, uint32_t b, uint32_t c) {
+    (void)a; (void)b; (void)c;
+    return 0;
+}
+
+static int32_t sys_exit(uint32_t a, uint32_t b, uint32_t c) {
+    (void)a; (void)b; (void)c;
+    task_exit();
+    return 0; // not reached
+}
+
+static int32_t sys_write(uint32_t buf, uint32_t len, uint32_t c) {
+    (void)c;
+    char line[SYS_WRITE_MAX + 1];
+    if (len > SYS_WRITE_MAX) len = SYS_WRITE_MAX;
+    if (!user_range_ok(buf, len, 0)) return SYS_EFAULT;
+    memcpy(line, (const void *)buf, len);
+    while (len && line[len - 1] == '\n') len--;
+    line[len] = 0;
+    kprintf("user[%d]: %s", get_current_task()->id, line);
+    return (int32_t)len;
+}
+
+static int32_t sys_yield(uint32_t a, uint32_t b, uint32_t c) {
+    (void)a; (void)b; (void)c;
+    task_yield();
+    return 0;
+}
+
+static int32_t sys_sleep(uint32_t ticks, uint32_t b, uint32_t c) {
+    (void)b; (void)c;
+    task_sleep((int)ticks);
+    return 0;
+}
+
+static int32_t sys_getpid(uint32_t a, uint32_t b, uint32_t c) {
+    (void)a; (void)b; (void)c;
+    return get_current_task()->id;
+}
+
+static const syscall_fn_t syscall_table[SYS_COUNT] = {
+    [SYS_NULL]   = sys_null,
+    [SYS_EXIT]   = sys_exit,
+    [SYS_WRITE]  = sys_write,
+    [SYS_YIELD]  = sys_yield,
+    [SYS_SLEEP]  = sys_sleep,
+    [SYS_GETPID] = sys_getpid,
+};
+
+int32_t syscall_dispatch(uint32_t nr, uint32_t a, uint32_t b, uint32_t c) {
+    if (nr >= SYS_COUNT) return SYS_ENOSYS;
+    return syscall_table[nr](a, b, c);
+}
+
+// CPUID.1:EDX.SEP, except on early Pentium Pros that report it without
+// implementing it
+static int cpu_has_sysenter(void) {
+    uint32_t a, b, c, d;
+    cpuid(1, 0, &a, &b, &c, &d);
+    if (!(d & (1u << 11))) return 0;
+    uint32_t family = (a >> 8) & 0xF, model = (a >> 4) & 0xF, stepping = a & 0xF;
+    return !(family == 6 && model < 3 && stepping < 3);
+}
+
+void syscall_init(void) {
+    idt_set_gate(SYSCALL_VECTOR, (uint32_t)asm_syscall_int80, GDT_KERNEL_CODE, 0xEF); // DPL 3 trap gate
+    if (cpu_has_sysenter()) {
+        wrmsr(MSR_SYSENTER_CS, GDT_KERNEL_CODE);
+        wrmsr(MSR_SYSENTER_ESP, (uint32_t)tss_esp0_ptr());
+        wrmsr(MSR_SYSENTER_EIP, (uint32_t)asm_sysenter_entry);
+        usys_fast = 1;
+    }
+    klog_info("syscall: int 0x80%s", usys_fast ? " + sysenter" : " only (no SEP)");
+}
+
+int syscall_fast_available(void) {
+    return usys_fast;
+}
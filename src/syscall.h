@@ -0,0 +1,29 @@
+#ifndef SYSCALL_H
+#define SYSCALL_H
+
+#include <stdint.h>
+
+// System call numbers. Arguments travel in ebx, esi, edi and the result
+// comes back in eax on both entry paths (int 0x80 and SYSENTER).
+#define SYS_NULL   0 // does nothing; for measuring the round trip
+#define SYS_EXIT   1
+#define SYS_WRITE  2 // (buf, len) -> bytes written
+#define SYS_YIELD  3
+#define SYS_SLEEP  4 // (ticks)
+#define SYS_GETPID 5
+#define SYS_COUNT  6
+
+#define SYSCALL_VECTOR 0x80
+#define SYS_ENOSYS (-1)
+#define SYS_EFAULT (-2)
+
+typedef int32_t (*syscall_fn_t)(uint32_t a, uint32_t b, uint32_t c);
+
+// Install the int 0x80 gate and, when the CPU has SEP, the SYSENTER MSRs
+void syscall_init(void);
+int syscall_fast_available(void);
+
+// Called by both asm entry stubs
+int32_t syscall_dispatch(uint32_t nr, uint32_t a, uint32_t b, uint32_t c);
+
+#endif // SYSCALL_H
@@ -0,0 +1,84 @@
+; System call entry stubs. Both build the same C call:
+;   syscall_dispatch(eax = nr, ebx, esi, edi)
+; and return its result in eax; ebx/esi/edi/ebp survive the C call.
+section .text
+extern syscall_dispatch
+
+; int 0x80, a DPL 3 trap gate: the CPU has already switched to the task's
+; kernel stack (TSS esp0) and interrupts stay enabled
+global asm_syscall_int80
+align 16
+asm_syscall_int80:
+    push ds
+    push es
+    push fs
+    push gs
+    mov cx, 0x10
+    mov ds, cx
+    mov es, cx
+    mov fs, cx
+    mov gs, cx
+    push edi
+    push esi
+    push ebx
+    push eax
+    call syscall_dispatch
+    add esp, 16
+    pop gs
+    pop fs
+    pop es
+    pop ds
+    iret
+
+; SYSENTER: CS/SS come from the MSRs, esp from MSR_SYSENTER_ESP, which
+; points at tss.esp0; interrupts are off. User ecx = return esp, edx =
+; return eip, handed back to SYSEXIT.
+global asm_sysenter_entry
+align 16
+asm_sysenter_entry:
+    mov esp, [esp]          ; the current task's kernel stack
+    push ecx
+    push edx
+    push ds
+    push es
+    push fs
+    push gs
+    mov cx, 0x10
+    mov ds, cx
+    mov es, cx
+    mov fs, cx
+    mov gs, cx
+    push edi
+    push esi
+    push ebx
+    push eax
+    sti
+    call syscall_dispatch
+    cli
+    add esp, 16
+    pop gs
+    pop fs
+    pop es
+    pop ds
+    pop edx
+    pop ecx
+    sti                     ; takes effect after sysexit
+    sysexit
+
+; void user_mode_enter(uint32_t eip, uint32_t esp): drop to ring 3
+global user_mode_enter
+align 16
+user_mode_enter:
+    mov ecx, [esp + 4]
+    mov edx, [esp + 8]
+    mov ax, 0x23            ; GDT_USER_DATA
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    push 0x23               ; ss
+    push edx                ; esp
+    push 0x202              ; eflags: IF
+    push 0x1B               ; cs = GDT_USER_CODE
+    push ecx                ; eip
+    iret
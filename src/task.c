@@ -1,15 +1,26 @@
 #include "task.h"
+#include "sched.h"
 #include <stddef.h>
 #include "debug.h"
+#include "trace.h"
+#include "cpu.h"
+#include "gdt.h"
+#include "kernel.h"
+#include "vm.h"
 #include <stdint.h>
 
-#define MAX_TASKS 8
+#define MAX_TASKS CONFIG_MAX_TASKS
 #define STACK_SIZE 4096
 #define STACK_CANARY 0xDEADBEEF
+#define DL_LIMIT_PERMILLE (CONFIG_SCHED_DL_LIMIT * 10)
 
 static task_t tasks[MAX_TASKS];
-static int num_tasks = 0;
+static int num_tasks = 0;   // slots ever handed out
+static int next_task_id = 1;
 static task_t *current_task = NULL;
+static task_t *idle_task_ptr = NULL;
+static uint32_t sched_ticks = 0; // deadline clock, advanced by task_tick
+static int dl_tasks = 0;         // tasks in the deadline class
 
 // Simple round-robin linked list
 static task_t *task_list_head = NULL;
@@ -19,7 +30,7 @@ extern void context_switch(cpu_context_t *old, cpu_context_t *new);
 extern void task_exit(void); // Use as fake return address
 extern void print_line(const char*, int); // For debug prints
 extern void task_trampoline(void); // Trampoline for task startup
-extern void kernel_panic(const char *msg);
+extern void user_mode_enter(uint32_t eip, uint32_t esp); // syscall_entry.asm
 
 void print_hex(uint32_t val, int row) {
     char buf[16];
@@ -37,17 +48,46 @@ __attribute__((weak)) void context_switch(cpu_context_t *old, cpu_context_t *new
 
 void tasking_init(void) {
     num_tasks = 0;
+    next_task_id = 1;
     task_list_head = NULL;
     current_task = NULL;
+    idle_task_ptr = NULL;
+    sched_ticks = 0;
+    dl_tasks = 0;
+}
+
+static void dl_clear(task_t *t) {
+    if (t->dl_period) dl_tasks--;
+    t->dl_runtime = t->dl_deadline = t->dl_period = 0;
+    t->dl_budget = t->dl_abs_deadline = t->dl_release = 0;
+    t->dl_throttled = t->dl_waiting = t->dl_active = t->dl_missed = 0;
+    t->dl_jobs = t->dl_misses = t->dl_throttles = 0;
+    t->dl_release_tsc = t->dl_max_response = 0;
 }
 
 task_t *task_create(void (*entry)(void)) {
-    if (num_tasks >= MAX_TASKS) return NULL;
-    task_t *t = &tasks[num_tasks++];
-    t->id = num_tasks;
-    t->state = TASK_READY;
+    // Reuse the slot of a task that has exited and been reaped
+    uint32_t flags = irq_save();
+    task_t *t = NULL;
+    for (int i = 0; i < num_tasks; ++i) {
+        if (tasks[i].state == TASK_TERMINATED && !tasks[i].stack) {
+            t = &tasks[i];
+            break;
+        }
+    }
+    if (!t && num_tasks < MAX_TASKS) t = &tasks[num_tasks++];
+    if (!t) {
+        irq_restore(flags);
+        return NULL;
+    }
     t->stack = (uint32_t*)kmalloc(STACK_SIZE);
-    if (!t->stack) return NULL;
+    if (!t->stack) {
+        t->state = TASK_TERMINATED;
+        irq_restore(flags);
+        return NULL;
+    }
+    t->id = next_task_id++;
+    t->state = TASK_READY;
     // Write canary at the bottom of the stack
     t->stack[0] = STACK_CANARY;
     // Set up initial stack for trampoline: [dummy][entry][task_exit]
@@ -61,6 +101,15 @@ task_t *task_create(void (*entry)(void)) {
     t->context.edi = t->context.esi = t->context.ebx = 0;
     t->next = NULL;
     t->sleep_ticks = 0;
+    t->name = 0;
+    t->run_cycles = t->wait_cycles = t->max_latency = 0;
+    t->vol_switches = t->invol_switches = 0;
+    t->last_switch_in = t->ready_since = rdtsc();
+    t->user_eip = t->user_esp = 0;
+    t->user_stack = NULL;
+    t->as = NULL;
+    t->wait_next = NULL;
+    dl_clear(t);
     // Add to task list
     if (!task_list_head) {
         task_list_head = t;
@@ -70,6 +119,7 @@ task_t *task_create(void (*entry)(void)) {
         cur->next = t;
     }
     if (!current_task) current_task = t;
+    irq_restore(flags);
     // Debug print
     // DEBUG_PRINT(print_line(msg, t->id + 2)); // Uncomment if you want to see task creation
     // Print trampoline address, entry, esp, and stack contents
@@ -86,6 +136,50 @@ task_t *task_create(void (*entry)(void)) {
     return t;
 }
 
+// Kernel-side start of every ring-3 task
+static void user_task_start(void) {
+    task_t *t = current_task;
+    user_mode_enter(t->user_eip, t->user_esp);
+}
+
+task_t *task_create_user(void (*entry)(void)) {
+    // The stack is used through the identity map; alloc_zeroed_page() only
+    // returns pages below its end, and NULL once they run out
+    void *ustack = alloc_zeroed_page();
+    if (!ustack) return NULL;
+    if (!paging_set_user((uint32_t)ustack, PMM_PAGE_SIZE, 1)) {
+        free_page(ustack);
+        return NULL;
+    }
+    // Fill in the user fields before the new task can be scheduled
+    uint32_t flags = irq_save();
+    task_t *t = task_create(user_task_start);
+    if (t) {
+        t->user_eip = (uint32_t)entry;
+        t->user_esp = (uint32_t)ustack + PMM_PAGE_SIZE;
+        t->user_stack = ustack;
+    }
+    irq_restore(flags);
+    if (!t) {
+        paging_set_user((uint32_t)ustack, PMM_PAGE_SIZE, 0);
+        free_page(ustack);
+    }
+    return t;
+}
+
+task_t *task_create_process(struct addr_space *as, uint32_t eip, uint32_t esp) {
+    uint32_t flags = irq_save();
+    task_t *t = task_create(user_task_start);
+    if (t) {
+        t->user_eip = eip;
+        t->user_esp = esp;
+        t->as = as;
+    }
+    irq_restore(flags);
+    return t;
+}
+
+#if CONFIG_DEBUG
 // Helper for debug: print all task states
 static void debug_print_all_tasks(void) {
     task_t *t = task_list_head;
@@ -108,48 +202,19 @@ static void debug_print_all_tasks(void) {
         msg[col++] = ' ';
         t = t->next;
     }
-    // DEBUG_PRINT(print_line(msg, row)); // Uncomment if you want to see all task states
+    DEBUG_PRINT(msg, row);
 }
+#else
+#define debug_print_all_tasks() ((void)0)
+#endif
 
-// Modular scheduler: round-robin for now, skip sleeping/blocked/terminated
-static task_t* schedule(void) {
+// `hint`, when runnable, jumps the round-robin order but not deadline tasks
+static task_t* schedule(task_t *hint) {
     debug_print_all_tasks(); // Print all task states each time scheduler runs
-    if (!current_task) return task_list_head;
-    task_t *start = current_task;
-    task_t *next = current_task->next ? current_task->next : task_list_head;
-    while (next != start) {
-        if (next->state == TASK_READY) {
-            // Debug print
-            char msg[32];
-            for (int i = 0; i < 32; ++i) msg[i] = 0;
-            msg[0] = 'S'; msg[1] = 'c'; msg[2] = 'h'; msg[3] = 'e'; msg[4] = 'd'; msg[5] = 'u'; msg[6] = 'l'; msg[7] = 'e'; msg[8] = ' '; msg[9] = 'T'; msg[10] = 'a'; msg[11] = 's'; msg[12] = 'k'; msg[13] = '#';
-            msg[14] = '0' + next->id;
-            // DEBUG_PRINT(print_line(msg, 20)); // Uncomment if you want to see scheduled task
-            return next;
-        }
-        next = next->next ? next->next : task_list_head;
-    }
-    if (current_task->state == TASK_READY) {
-        char msg[32];
-        for (int i = 0; i < 32; ++i) msg[i] = 0;
-        msg[0] = 'S'; msg[1] = 'c'; msg[2] = 'h'; msg[3] = 'e'; msg[4] = 'd'; msg[5] = 'u'; msg[6] = 'l'; msg[7] = 'e'; msg[8] = ' '; msg[9] = 'T'; msg[10] = 'a'; msg[11] = 's'; msg[12] = 'k'; msg[13] = '#';
-        msg[14] = '0' + current_task->id;
-        // DEBUG_PRINT(print_line(msg, 20));
-        return current_task;
-    }
-    next = task_list_head;
-    do {
-        if (next->state == TASK_READY) {
-            char msg[32];
-            for (int i = 0; i < 32; ++i) msg[i] = 0;
-            msg[0] = 'S'; msg[1] = 'c'; msg[2] = 'h'; msg[3] = 'e'; msg[4] = 'd'; msg[5] = 'u'; msg[6] = 'l'; msg[7] = 'e'; msg[8] = ' '; msg[9] = 'T'; msg[10] = 'a'; msg[11] = 's'; msg[12] = 'k'; msg[13] = '#';
-            msg[14] = '0' + next->id;
-            // DEBUG_PRINT(print_line(msg, 20));
-            return next;
-        }
-        next = next->next ? next->next : task_list_head;
-    } while (next != task_list_head);
-    return current_task;
+    task_t *next = dl_tasks ? sched_pick_deadline(task_list_head, current_task) : NULL;
+    if (next) return next;
+    if (hint && sched_runnable(hint)) return hint;
+    return sched_pick(task_list_head, current_task, idle_task_ptr);
 }
 
 // Helper: clean up terminated tasks (except the current one)
@@ -162,6 +227,16 @@ static void cleanup_terminated_tasks(void) {
             if (prev) prev->next = t->next;
             else task_list_head = t->next;
             if (t->stack) kfree(t->stack);
+            if (t->user_stack) {
+                paging_set_user((uint32_t)t->user_stack, PMM_PAGE_SIZE, 0);
+                free_page(t->user_stack);
+                t->user_stack = NULL;
+            }
+            if (t->as) {
+                vm_destroy(t->as);
+                t->as = NULL;
+            }
+            dl_clear(t); // returns its bandwidth
             task_t *to_free = t;
             t = t->next;
             to_free->stack = NULL;
@@ -185,31 +260,62 @@ static void check_stack_canaries(void) {
     }
 }
 
-void task_switch(void) {
+// Charge the outgoing task and stamp the incoming one
+static void account_switch(task_t *prev, task_t *next, int preempted) {
+    uint64_t now = rdtsc();
+    prev->run_cycles += now - prev->last_switch_in;
+    if (preempted) prev->invol_switches++;
+    else prev->vol_switches++;
+    if (prev->state == TASK_READY && prev != idle_task_ptr) prev->ready_since = now;
+    if (next->ready_since) {
+        uint64_t lat = now - next->ready_since;
+        next->wait_cycles += lat;
+        if (lat > next->max_latency) next->max_latency = lat;
+        next->ready_since = 0;
+    }
+    next->last_switch_in = now;
+}
+
+// `hint`, when runnable, goes next instead of the round-robin choice
+static void switch_tasks(int preempted, task_t *hint) {
     if (!current_task) return;
+    // Interrupts stay off across the switch; each task gets its own
+    // interrupt flag back when it is resumed.
+    uint32_t flags = irq_save();
     check_stack_canaries();
     cleanup_terminated_tasks();
     task_t *prev_task = current_task;
-    task_t *next = schedule();
-    // --- DEBUG_PRINT example: show task switch ---
-    char dbgmsg[32];
-    dbgmsg[0] = 'S'; dbgmsg[1] = 'w'; dbgmsg[2] = 'i'; dbgmsg[3] = 't'; dbgmsg[4] = 'c'; dbgmsg[5] = 'h'; dbgmsg[6] = ':';
-    dbgmsg[7] = ' '; dbgmsg[8] = '#';
-    dbgmsg[9] = '0' + prev_task->id;
-    dbgmsg[10] = '-'; dbgmsg[11] = '>'; dbgmsg[12] = '#';
-    dbgmsg[13] = '0' + next->id;
-    dbgmsg[14] = 0;
-    DEBUG_PRINT(dbgmsg, 21);
-    // --- END DEBUG_PRINT example ---
-    if (next == prev_task) return; // Only one runnable task
+    task_t *next = schedule(hint);
+    if (next == prev_task) { // Only one runnable task
+        irq_restore(flags);
+        return;
+    }
+    TRACE(TRACE_SWITCH, prev_task->id, next->id);
+    account_switch(prev_task, next, preempted);
     current_task = next;
+    // Entries from ring 3 (interrupts, SYSENTER) land on the task's own stack
+    tss_set_kernel_stack((uint32_t)(next->stack + STACK_SIZE/sizeof(uint32_t)));
+    vm_activate(next->as);
     context_switch(&prev_task->context, &next->context);
+    irq_restore(flags);
+}
+
+void task_switch(void) {
+    switch_tasks(0, NULL);
+}
+
+void task_switch_to(task_t *t) {
+    switch_tasks(0, t);
 }
 
 void task_yield(void) {
     task_switch();
 }
 
+void task_preempt(void) {
+    switch_tasks(1, NULL);
+}
+
 void task_exit(void) {
     if (!current_task) return;
     current_task->state = TASK_TERMINATED;
@@ -220,32 +326,188 @@ task_t *get_current_task(void) {
     return current_task;
 }
 
+void task_set_name(task_t *t, const char *name) {
+    if (t) t->name = name;
+}
+
+void task_set_idle(task_t *t) {
+    idle_task_ptr = t;
+    if (t) t->ready_since = 0;
+}
+
+task_t *task_get_idle(void) {
+    return idle_task_ptr;
+}
+
 // --- Sleeping/Blocking Support ---
 void task_sleep(int ticks) {
     if (!current_task || ticks <= 0) return;
     current_task->sleep_ticks = ticks;
     current_task->state = TASK_SLEEPING;
+    TRACE(TRACE_SLEEP, current_task->id, ticks);
     task_switch();
 }
 
 void task_wake(task_t *t) {
-    if (!t) return;
+    if (!t || t->dl_waiting) return; // periodic releases are timer-driven
     t->sleep_ticks = 0;
-    if (t->state == TASK_SLEEPING || t->state == TASK_BLOCKED)
+    if (t->state == TASK_SLEEPING || t->state == TASK_BLOCKED) {
         t->state = TASK_READY;
+        t->ready_since = rdtsc();
+        TRACE(TRACE_WAKEUP, t->id, 0);
+    }
+}
+
+void wait_queue_sleep(wait_queue_t *q) {
+    task_t *t = current_task;
+    t->state = TASK_BLOCKED;
+    t->wait_next = q->head;
+    q->head = t;
+    task_switch();
+    // Woken some other way (task_wake): unlink before the link is reused
+    for (task_t **p = &q->head; *p; p = &(*p)->wait_next) {
+        if (*p == t) {
+            *p = t->wait_next;
+            break;
+        }
+    }
+    t->wait_next = NULL;
+}
+
+void wait_queue_wake_all(wait_queue_t *q) {
+    uint32_t flags = irq_save();
+    task_t *t = q->head;
+    q->head = NULL;
+    while (t) {
+        task_t *next = t->wait_next;
+        t->wait_next = NULL;
+        task_wake(t);
+        t = next;
+    }
+    irq_restore(flags);
 }
 
-// Call this from the timer interrupt handler to update sleeping tasks
 task_t *task_list(void) { return task_list_head; }
-void task_tick(void) {
+
+// --- Deadline class ---
+
+// Release a job at tick `release`: fresh budget, deadline relative to it
+static void dl_release_job(task_t *t, uint32_t release) {
+    t->dl_budget = t->dl_runtime;
+    t->dl_abs_deadline = release + t->dl_deadline;
+    t->dl_release = release + t->dl_period;
+    t->dl_release_tsc = rdtsc();
+    t->dl_active = 1;
+    t->dl_missed = t->dl_throttled = 0;
+    if (t->dl_waiting) {
+        t->dl_waiting = 0;
+        t->state = TASK_READY;
+        t->ready_since = t->dl_release_tsc;
+        TRACE(TRACE_WAKEUP, t->id, 0);
+    }
+}
+
+// Reserved share in permille, rounded up so admission errs on the safe side
+static uint32_t dl_bandwidth(uint32_t runtime, uint32_t deadline) {
+    return (runtime * 1000 + deadline - 1) / deadline;
+}
+
+uint32_t task_dl_utilization(void) {
+    uint32_t flags = irq_save();
+    uint32_t total = 0;
+    for (task_t *t = task_list_head; t; t = t->next)
+        if (t->dl_period && t->state != TASK_TERMINATED) total += dl_bandwidth(t->dl_runtime, t->dl_deadline);
+    irq_restore(flags);
+    return total;
+}
+
+int task_set_deadline(task_t *t, uint32_t runtime, uint32_t deadline, uint32_t period) {
+    if (!t || t == idle_task_ptr) return -1;
+    if (runtime && (runtime > deadline || deadline > period || period > 0x40000000u)) return -1;
+    uint32_t flags = irq_save();
+    if (!runtime) {
+        if (t->dl_waiting) {
+            t->state = TASK_READY;
+            t->ready_since = rdtsc();
+        }
+        dl_clear(t);
+        irq_restore(flags);
+        return 0;
+    }
+    uint32_t others = 0;
+    for (task_t *o = task_list_head; o; o = o->next)
+        if (o != t && o->dl_period && o->state != TASK_TERMINATED)
+            others += dl_bandwidth(o->dl_runtime, o->dl_deadline);
+    if (others + dl_bandwidth(runtime, deadline) > DL_LIMIT_PERMILLE) {
+        irq_restore(flags);
+        return -2;
+    }
+    int was_dl = t->dl_period != 0;
+    t->dl_runtime = runtime;
+    t->dl_deadline = deadline;
+    t->dl_period = period;
+    if (!was_dl) {
+        dl_tasks++;
+        dl_release_job(t, sched_ticks);
+    }
+    else if (t->dl_budget > runtime) t->dl_budget = runtime; // new job parameters apply at the next release
+    irq_restore(flags);
+    return 0;
+}
+
+void task_wait_period(void) {
+    task_t *t = current_task;
+    if (!t || !t->dl_period) return;
+    uint32_t flags = irq_save();
+    uint64_t response = rdtsc() - t->dl_release_tsc;
+    if (response > t->dl_max_response) t->dl_max_response = response;
+    t->dl_jobs++;
+    t->dl_active = 0;
+    if ((int32_t)(sched_ticks - t->dl_release) >= 0) {
+        // Overran into the next period: start the next job now, with its
+        // deadline counted from here rather than from the missed release
+        dl_release_job(t, sched_ticks);
+    } else {
+        t->dl_waiting = 1;
+        t->state = TASK_SLEEPING;
+        TRACE(TRACE_SLEEP, t->id, t->dl_release - sched_ticks);
+        task_switch();
+    }
+    irq_restore(flags);
+}
+
+// Call this from the timer interrupt handler to update sleeping tasks
+int task_tick(void) {
+    int resched = 0;
+    uint32_t now = ++sched_ticks;
     task_t *t = task_list_head;
     while (t) {
         if (t->state == TASK_SLEEPING && t->sleep_ticks > 0) {
             t->sleep_ticks--;
             if (t->sleep_ticks == 0) {
                 t->state = TASK_READY;
+                t->ready_since = rdtsc();
+                TRACE(TRACE_WAKEUP, t->id, 0);
+            }
+        }
+        if (t->dl_period && t->state != TASK_TERMINATED) {
+            // The tick just ended is charged to the task that was running
+            if (t == current_task && t->dl_active && !t->dl_throttled && t->dl_budget && !--t->dl_budget) {
+                t->dl_throttled = 1;
+                t->dl_throttles++;
+                resched = 1;
+            }
+            if (t->dl_active && !t->dl_missed && (int32_t)(now - t->dl_abs_deadline) >= 0) {
+                t->dl_missed = 1;
+                t->dl_misses++;
+                TRACE(TRACE_DL_MISS, t->id, t->dl_abs_deadline);
+            }
+            if ((t->dl_waiting || t->dl_throttled) && (int32_t)(now - t->dl_release) >= 0) {
+                dl_release_job(t, t->dl_release);
+                resched = 1;
             }
         }
         t = t->next;
     }
-} 
\ No newline at end of file
+    return resched;
+}
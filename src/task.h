@@ -25,16 +25,90 @@ typedef struct task {
     task_state_t state;
     struct task *next;
     int sleep_ticks; // Number of timer ticks left to sleep
+    const char *name;
+    // CPU accounting, in TSC cycles
+    uint64_t run_cycles;      // time on the CPU
+    uint64_t wait_cycles;     // time runnable but waiting for the CPU
+    uint64_t last_switch_in;  // TSC when last switched in
+    uint64_t ready_since;     // TSC when it last became runnable, 0 if not waiting
+    uint64_t max_latency;     // longest runnable-to-running delay
+    uint32_t vol_switches;    // gave up the CPU (yield, sleep, exit)
+    uint32_t invol_switches;  // preempted by the timer
+    // Ring-3 tasks: entry point, initial stack pointer, and either the
+    // identity-mapped page backing the stack or a private address space
+    uint32_t user_eip, user_esp;
+    void *user_stack;
+    struct addr_space *as;
+    struct task *wait_next; // wait queue link
+    // Deadline class, when dl_period is set: every dl_period ticks a job is
+    // released with dl_runtime ticks of budget, due dl_deadline ticks later
+    uint32_t dl_runtime, dl_deadline, dl_period;
+    uint32_t dl_budget;       // ticks left for the current job
+    uint32_t dl_abs_deadline; // tick the current job is due
+    uint32_t dl_release;      // tick of the next release
+    uint8_t dl_throttled;     // budget used up, waiting for the next release
+    uint8_t dl_waiting;       // job done, waiting for the next release
+    uint8_t dl_active;        // a job is released and not finished
+    uint8_t dl_missed;        // the current job was already counted as missed
+    uint32_t dl_jobs;         // jobs completed
+    uint32_t dl_misses;       // jobs still unfinished at their deadline
+    uint32_t dl_throttles;    // jobs stopped for running over budget
+    uint64_t dl_release_tsc;  // TSC at the current job's release
+    uint64_t dl_max_response; // longest release-to-completion, in cycles
 } task_t;
 
+// Tasks blocked until a wake_all. Check the condition and sleep with
+// interrupts disabled so a wakeup from IRQ context cannot slip in between;
+// callers loop, since a wakeup only means "re-check".
+typedef struct wait_queue {
+    task_t *head;
+} wait_queue_t;
+
 void tasking_init(void);
 task_t *task_create(void (*entry)(void));
+// Run `entry` in ring 3 on a fresh user stack page. The code must lie in
+// user-accessible memory (see usyscall.h).
+task_t *task_create_user(void (*entry)(void));
+// Run a loaded program: ring 3 at `eip`/`esp` in address space `as`, which
+// the task owns from now on
+struct addr_space;
+task_t *task_create_process(struct addr_space *as, uint32_t eip, uint32_t esp);
 void task_switch(void);
+// Give the CPU to `t` if it is runnable (a directed handoff, e.g. to the
+// peer just woken), else behave like task_switch()
+void task_switch_to(task_t *t);
 void task_yield(void);
+void task_preempt(void); // Timer-driven (involuntary) switch
 void task_exit(void);
 void task_sleep(int ticks); // Sleep for a number of timer ticks
 void task_wake(task_t *t); // Wake a sleeping or blocked task
 
+// Deadline scheduling (EDF). Put `t` in the deadline class with a budget of
+// `runtime` ticks every `period` ticks, each job due `deadline` ticks after
+// its release (runtime <= deadline <= period). The first job is released
+// at once. Runnable deadline tasks always run ahead of best-effort ones,
+// earliest absolute deadline first; a job that uses up its budget is held
+// back until the next release. Returns 0, -1 for bad parameters, or -2 if
+// admission control rejects it: the summed runtime/deadline of all
+// deadline tasks may not exceed CONFIG_SCHED_DL_LIMIT percent. A runtime
+// of 0 returns `t` to the best-effort class.
+int task_set_deadline(task_t *t, uint32_t runtime, uint32_t deadline, uint32_t period);
+// End the current job and sleep until the next release (deadline tasks;
+// a no-op for best-effort ones)
+void task_wait_period(void);
+// CPU share reserved by deadline tasks, in permille
+uint32_t task_dl_utilization(void);
+
+void wait_queue_sleep(wait_queue_t *q); // interrupts must be off
+void wait_queue_wake_all(wait_queue_t *q); // safe from IRQ context
+
 task_t *get_current_task(void);
+task_t *task_list(void);
+// Timer tick: wake sleepers, release and police deadline jobs. Returns
+// nonzero when the running task should be preempted right away.
+int task_tick(void);
+void task_set_name(task_t *t, const char *name);
+void task_set_idle(task_t *t); // Runs only when nothing else is ready
+task_t *task_get_idle(void);
 
 #endif // TASK_H 
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "trace.h"
+#include "cpu.h"
+#include "klog.h"
+#include "serial.h"
+#include <stdint.h>
+
+typedef struct trace_ring {
+    volatile uint32_t head; // total records ever reserved
+    trace_rec_t recs[TRACE_RING_SIZE];
+} trace_ring_t;
+
+static trace_ring_t trace_rings[NR_CPUS];
+volatile int trace_enabled = 0;
+
+void trace_record(int event, uint32_t a, uint32_t b) {
+    int cpu = cpu_id();
+    trace_ring_t *ring = &trace_rings[cpu];
+    uint32_t slot = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED);
+    trace_rec_t *rec = &ring->recs[slot & (TRACE_RING_SIZE - 1)];
+    rec->tsc = rdtsc();
+    rec->cpu = cpu;
+    rec->event = event;
+    rec->reserved = 0;
+    rec->a = a;
+    rec->b = b;
+}
+
+void trace_start(void) {
+    trace_enabled = 1;
+}
+
+void trace_stop(void) {
+    trace_enabled = 0;
+}
+
+void trace_clear(void) {
+    for (int cpu = 0; cpu < NR_CPUS; ++cpu)
+        trace_rings[cpu].head = 0;
+}
+
+uint32_t trace_count(void) {
+    uint32_t n = 0;
+    for (int cpu = 0; cpu < NR_CPUS; ++cpu) {
+        uint32_t head = trace_rings[cpu].head;
+        n += head < TRACE_RING_SIZE ? head : TRACE_RING_SIZE;
+    }
+    return n;
+}
+
+void trace_dump(void) {
+    char line[80];
+    int was_enabled = trace_enabled;
+    trace_enabled = 0; // keep the ring stable while it is read out
+    int n = ksnprintf(line, sizeof(line), "TRACE BEGIN cpus=%d records=%u\n",
+                      NR_CPUS, trace_count());
+    serial_write_wait(line, n);
+    for (int cpu = 0; cpu < NR_CPUS; ++cpu) {
+        trace_ring_t *ring = &trace_rings[cpu];
+        uint32_t head = ring->head;
+        uint32_t slot = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+        for (; slot != head; ++slot) {
+            trace_rec_t *rec = &ring->recs[slot & (TRACE_RING_SIZE - 1)];
+            n = ksnprintf(line, sizeof(line), "T %u %08x%08x %u %x %x\n", rec->cpu,
+                          (uint32_t)(rec->tsc >> 32), (uint32_t)rec->tsc,
+                          rec->event, rec->a, rec->b);
+            serial_write_wait(line, n);
+        }
+    }
+    serial_write_wait("TRACE END\n", 10);
+    trace_enabled = was_enabled;
+}
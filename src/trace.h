@@ -0,0 +1,50 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#include "kconfig.h" // CONFIG_TRACE switches the tracepoints on or off
+
+#define TRACE_RING_SIZE 2048 // records per CPU, power of two
+
+// Trace events; the host-side tools/trace2json.py decodes the same numbers
+enum trace_event {
+    TRACE_SWITCH = 1,  // a = prev task id, b = next task id
+    TRACE_WAKEUP,      // a = task id
+    TRACE_SLEEP,       // a = task id, b = ticks
+    TRACE_IRQ_ENTRY,   // a = vector
+    TRACE_IRQ_EXIT,    // a = vector
+    TRACE_PAGE_FAULT,  // a = fault address, b = error code
+    TRACE_DL_MISS,     // a = task id, b = missed absolute deadline (tick)
+};
+
+typedef struct trace_rec {
+    uint64_t tsc;
+    uint8_t cpu;
+    uint8_t event;
+    uint16_t reserved;
+    uint32_t a;
+    uint32_t b;
+} trace_rec_t;
+
+#if CONFIG_TRACE
+extern volatile int trace_enabled;
+#define TRACE(ev, a, b) do { \
+        if (__builtin_expect(trace_enabled, 0)) \
+            trace_record((ev), (uint32_t)(a), (uint32_t)(b)); \
+    } while (0)
+#else
+#define TRACE(ev, a, b) ((void)0)
+#endif
+
+void trace_record(int event, uint32_t a, uint32_t b);
+void trace_start(void);
+void trace_stop(void);
+void trace_clear(void);
+uint32_t trace_count(void);
+
+// Write the retained records to serial as text, bracketed by
+// "TRACE BEGIN"/"TRACE END" lines for tools/trace2json.py
+void trace_dump(void);
+
+#endif // TRACE_H
@@ -3,6 +3,7 @@ global task_trampoline
 extern task_exit
 
 task_trampoline:
+    sti                ; task_switch runs with interrupts off; new tasks start with them on
     mov byte [0xB8000], 0x23 ; '#'
     mov byte [0xB8001], 0x4E
     pop eax            ; Pop entry function pointer into eax
@@ -0,0 +1,51 @@
+#include "usyscall.h"
+#include <stdint.h>
+
+// Ring-3 programs. Everything here is placed in the user-accessible .user
+// section, including constants; the helpers they call are always_inline
+// so no kernel code is reached except through a system call.
+
+int usys_fast USER_DATA = 0;
+uint32_t ubench_samples[2][BENCH_SAMPLES] USER_DATA;
+
+static const char hello_int80[] USER_RODATA = "hello from ring 3 (int 0x80)";
+static const char hello_sysenter[] USER_RODATA = "hello from ring 3 (sysenter)";
+static const char bye[] USER_RODATA = "ring 3 demo done";
+static const char poke[] USER_RODATA = "poking kernel memory from ring 3";
+
+USER_INLINE uint32_t user_rdtsc32(void) {
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return lo;
+}
+
+void USER_TEXT user_demo(void) {
+    usys_int80(SYS_WRITE, (uint32_t)hello_int80, sizeof(hello_int80) - 1, 0);
+    if (usys_fast)
+        usys_sysenter(SYS_WRITE, (uint32_t)hello_sysenter, sizeof(hello_sysenter) - 1, 0);
+    usys_sleep(10);
+    usys_write(bye, sizeof(bye) - 1);
+    usys_exit();
+}
+
+// Faults on a supervisor page; the kernel kills the task and carries on
+void USER_TEXT user_fault(void) {
+    usys_write(poke, sizeof(poke) - 1);
+    *(volatile uint16_t *)0xB8000 = 0x4F21;
+    usys_exit();
+}
+
+// Round-trip cost of SYS_NULL on each entry path, read back by bench.c
+void USER_TEXT user_bench(void) {
+    for (int i = 0; i < BENCH_SAMPLES; ++i) {
+        uint32_t t0 = user_rdtsc32();
+        usys_int80(SYS_NULL, 0, 0, 0);
+        ubench_samples[0][i] = user_rdtsc32() - t0;
+    }
+    for (int i = 0; i < BENCH_SAMPLES && usys_fast; ++i) {
+        uint32_t t0 = user_rdtsc32();
+        usys_sysenter(SYS_NULL, 0, 0, 0);
+        ubench_samples[1][i] = user_rdtsc32() - t0;
+    }
+    usys_exit();
+}
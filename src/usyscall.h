@@ -0,0 +1,66 @@
+#ifndef USYSCALL_H
+#define USYSCALL_H
+
+#include <stdint.h>
+#include "syscall.h"
+#include "bench.h" // BENCH_SAMPLES
+
+// Ring-3 side of the system call ABI. User code and data are linked into
+// the .user output section, which is the only kernel-image memory mapped
+// user-accessible; anything user code touches has to live there. String
+// literals and jump tables land in .rodata, so avoid both in user code.
+#define USER_TEXT   __attribute__((section(".user.text")))
+#define USER_RODATA __attribute__((section(".user.rodata")))
+#define USER_DATA   __attribute__((section(".user.data")))
+#define USER_INLINE static inline __attribute__((always_inline))
+
+// Set by syscall_init() when SYSENTER/SYSEXIT can be used
+extern int usys_fast;
+
+USER_INLINE int32_t usys_int80(uint32_t nr, uint32_t a, uint32_t b, uint32_t c) {
+    int32_t ret;
+    asm volatile ("int $0x80"
+                  : "=a"(ret) : "a"(nr), "b"(a), "S"(b), "D"(c)
+                  : "ecx", "edx", "memory", "cc");
+    return ret;
+}
+
+// The kernel returns with SYSEXIT to edx/ecx: label 1 and the current esp
+USER_INLINE int32_t usys_sysenter(uint32_t nr, uint32_t a, uint32_t b, uint32_t c) {
+    int32_t ret;
+    asm volatile ("mov %%esp, %%ecx\n"
+                  "mov $1f, %%edx\n"
+                  "sysenter\n"
+                  "1:\n"
+                  : "=a"(ret) : "a"(nr), "b"(a), "S"(b), "D"(c)
+                  : "ecx", "edx", "memory", "cc");
+    return ret;
+}
+
+USER_INLINE int32_t usys_call(uint32_t nr, uint32_t a, uint32_t b, uint32_t c) {
+    return usys_fast ? usys_sysenter(nr, a, b, c) : usys_int80(nr, a, b, c);
+}
+
+USER_INLINE void usys_exit(void) {
+    usys_call(SYS_EXIT, 0, 0, 0);
+}
+
+USER_INLINE int32_t usys_write(const char *buf, uint32_t len) {
+    return usys_call(SYS_WRITE, (uint32_t)buf, len, 0);
+}
+
+USER_INLINE int32_t usys_getpid(void) {
+    return usys_call(SYS_GETPID, 0, 0, 0);
+}
+
+USER_INLINE void usys_sleep(uint32_t ticks) {
+    usys_call(SYS_SLEEP, ticks, 0, 0);
+}
+
+// Ring-3 programs built into the kernel image (user.c)
+void user_demo(void);
+void user_fault(void);
+void user_bench(void); // fills ubench_samples: [0] int 0x80, [1] sysenter
+extern uint32_t ubench_samples[2][BENCH_SAMPLES];
+
+#endif // USYSCALL_H
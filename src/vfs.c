@@ -0,0 +1,192 @@
+#include "vfs.h"
+#include "ramfs.h"
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct vfs_file {
+    ramfs_inode_t *inode; // NULL: slot free
+    uint32_t pos;         // byte offset, or child index for directories
+    int flags;
+} vfs_file_t;
+
+static vfs_file_t files[VFS_MAX_FILES];
+
+int vfs_init(void) {
+    return ramfs_init() ? VFS_ENOSPC : 0;
+}
+
+const char *vfs_strerror(int err) {
+    switch (err) {
+    case VFS_ENOENT: return "no such file or directory";
+    case VFS_EEXIST: return "file exists";
+    case VFS_ENOTDIR: return "not a directory";
+    case VFS_EISDIR: return "is a directory";
+    case VFS_ENOTEMPTY: return "directory not empty";
+    case VFS_ENOSPC: return "out of memory";
+    case VFS_EBADF: return "bad file descriptor";
+    case VFS_EMFILE: return "too many open files";
+    case VFS_EINVAL: return "invalid argument";
+    case VFS_ENAMETOOLONG: return "name too long";
+    default: return "ok";
+    }
+}
+
+// One path component: "." and empty stay, ".." goes up, the rest is a
+// dentry cache lookup
+static ramfs_dentry_t *step(ramfs_dentry_t *dir, const char *name, uint32_t len) {
+    if (len == 0 || (len == 1 && name[0] == '.')) return dir;
+    if (len == 2 && name[0] == '.' && name[1] == '.') return dir->parent;
+    return ramfs_lookup(dir, name, len);
+}
+
+// Resolve everything but the last component of `path`: *dir gets the
+// directory it names, *name/*len the last component (empty for the root)
+static int resolve(const char *path, ramfs_dentry_t **dir, const char **name, uint32_t *len) {
+    ramfs_dentry_t *d = ramfs_root();
+    const char *p = path;
+    for (;;) {
+        while (*p == '/') p++;
+        const char *s = p;
+        while (*p && *p != '/') p++;
+        uint32_t n = p - s;
+        const char *rest = p;
+        while (*rest == '/') rest++;
+        if (!*rest) {
+            *dir = d;
+            *name = s;
+            *len = n;
+            return n > RAMFS_NAME_MAX ? VFS_ENAMETOOLONG : 0;
+        }
+        if (n > RAMFS_NAME_MAX) return VFS_ENAMETOOLONG;
+        if (!(d = step(d, s, n))) return VFS_ENOENT;
+        if (!d->inode->is_dir) return VFS_ENOTDIR;
+    }
+}
+
+static int lookup(const char *path, ramfs_dentry_t **out) {
+    ramfs_dentry_t *dir;
+    const char *name;
+    uint32_t len;
+    int err = resolve(path, &dir, &name, &len);
+    if (err) return err;
+    *out = step(dir, name, len);
+    return *out ? 0 : VFS_ENOENT;
+}
+
+static vfs_file_t *get_file(int fd) {
+    if (fd < 0 || fd >= VFS_MAX_FILES || !files[fd].inode) return NULL;
+    return &files[fd];
+}
+
+int vfs_open(const char *path, int flags) {
+    if (!(flags & (VFS_READ | VFS_WRITE))) return VFS_EINVAL;
+    int fd = 0;
+    while (fd < VFS_MAX_FILES && files[fd].inode) fd++;
+    if (fd == VFS_MAX_FILES) return VFS_EMFILE;
+    ramfs_dentry_t *dir;
+    const char *name;
+    uint32_t len;
+    int err = resolve(path, &dir, &name, &len);
+    if (err) return err;
+    ramfs_dentry_t *d = step(dir, name, len);
+    if (!d) {
+        if (!(flags & VFS_CREATE)) return VFS_ENOENT;
+        if (!(d = ramfs_create(dir, name, len, 0))) return VFS_ENOSPC;
+    }
+    if (d->inode->is_dir && (flags & VFS_WRITE)) return VFS_EISDIR;
+    if ((flags & (VFS_TRUNC | VFS_WRITE)) == (VFS_TRUNC | VFS_WRITE)) ramfs_truncate(d->inode);
+    ramfs_iget(d->inode);
+    files[fd].inode = d->inode;
+    files[fd].pos = 0;
+    files[fd].flags = flags;
+    return fd;
+}
+
+int vfs_close(int fd) {
+    vfs_file_t *f = get_file(fd);
+    if (!f) return VFS_EBADF;
+    ramfs_iput(f->inode);
+    f->inode = NULL;
+    return 0;
+}
+
+int vfs_read(int fd, void *buf, uint32_t n) {
+    vfs_file_t *f = get_file(fd);
+    if (!f || !(f->flags & VFS_READ)) return VFS_EBADF;
+    if (f->inode->is_dir) return VFS_EISDIR;
+    int r = ramfs_read(f->inode, f->pos, buf, n);
+    f->pos += r;
+    return r;
+}
+
+int vfs_write(int fd, const void *buf, uint32_t n) {
+    vfs_file_t *f = get_file(fd);
+    if (!f || !(f->flags & VFS_WRITE)) return VFS_EBADF;
+    if (f->flags & VFS_APPEND) f->pos = f->inode->size;
+    int r = ramfs_write(f->inode, f->pos, buf, n);
+    if (r < 0) return VFS_ENOSPC;
+    f->pos += r;
+    return r;
+}
+
+int vfs_seek(int fd, int32_t off, int whence) {
+    vfs_file_t *f = get_file(fd);
+    if (!f) return VFS_EBADF;
+    int64_t base;
+    switch (whence) {
+    case VFS_SEEK_SET: base = 0; break;
+    case VFS_SEEK_CUR: base = f->pos; break;
+    case VFS_SEEK_END: base = f->inode->size; break;
+    default: return VFS_EINVAL;
+    }
+    int64_t pos = base + off;
+    if (pos < 0 || pos > RAMFS_MAX_SIZE) return VFS_EINVAL;
+    f->pos = (uint32_t)pos;
+    return (int)pos;
+}
+
+int vfs_readdir(int fd, vfs_dirent_t *out) {
+    vfs_file_t *f = get_file(fd);
+    if (!f) return VFS_EBADF;
+    if (!f->inode->is_dir) return VFS_ENOTDIR;
+    ramfs_dentry_t *d = f->inode->children;
+    for (uint32_t i = 0; d && i < f->pos; ++i) d = d->sibling;
+    if (!d) return 0;
+    uint32_t i = 0;
+    for (; d->name[i]; ++i) out->name[i] = d->name[i];
+    out->name[i] = 0;
+    out->size = d->inode->size;
+    out->is_dir = d->inode->is_dir;
+    f->pos++;
+    return 1;
+}
+
+int vfs_mkdir(const char *path) {
+    ramfs_dentry_t *dir;
+    const char *name;
+    uint32_t len;
+    int err = resolve(path, &dir, &name, &len);
+    if (err) return err;
+    if (step(dir, name, len)) return VFS_EEXIST;
+    return ramfs_create(dir, name, len, 1) ? 0 : VFS_ENOSPC;
+}
+
+int vfs_unlink(const char *path) {
+    ramfs_dentry_t *d;
+    int err = lookup(path, &d);
+    if (err) return err;
+    if (d == ramfs_root() || d == d->parent) return VFS_EINVAL;
+    if (d->inode->is_dir && d->inode->children) return VFS_ENOTEMPTY;
+    return ramfs_unlink(d) ? VFS_EINVAL : 0;
+}
+
+int vfs_stat(const char *path, vfs_stat_t *st) {
+    ramfs_dentry_t *d;
+    int err = lookup(path, &d);
+    if (err) return err;
+    st->ino = d->inode->ino;
+    st->size = d->inode->size;
+    st->pages = d->inode->npages;
+    st->is_dir = d->inode->is_dir;
+    return 0;
+}
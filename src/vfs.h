@@ -0,0 +1,61 @@
+#ifndef VFS_H
+#define VFS_H
+
+#include <stdint.h>
+
+// File descriptors over the RAM filesystem. Paths are absolute or relative
+// to the root, "." and ".." are understood, and each component is resolved
+// through the dentry cache. Descriptors are kernel-wide.
+#define VFS_MAX_FILES 32
+#define VFS_PATH_MAX  128
+
+// Open flags
+#define VFS_READ   0x01
+#define VFS_WRITE  0x02
+#define VFS_CREATE 0x04
+#define VFS_TRUNC  0x08
+#define VFS_APPEND 0x10
+
+#define VFS_SEEK_SET 0
+#define VFS_SEEK_CUR 1
+#define VFS_SEEK_END 2
+
+// Errors, returned as negative values
+#define VFS_ENOENT       -1
+#define VFS_EEXIST       -2
+#define VFS_ENOTDIR      -3
+#define VFS_EISDIR       -4
+#define VFS_ENOTEMPTY    -5
+#define VFS_ENOSPC       -6
+#define VFS_EBADF        -7
+#define VFS_EMFILE       -8
+#define VFS_EINVAL       -9
+#define VFS_ENAMETOOLONG -10
+
+typedef struct vfs_stat {
+    uint32_t ino, size, pages;
+    int is_dir;
+} vfs_stat_t;
+
+typedef struct vfs_dirent {
+    char name[28];
+    uint32_t size;
+    int is_dir;
+} vfs_dirent_t;
+
+int vfs_init(void);
+const char *vfs_strerror(int err);
+
+int vfs_open(const char *path, int flags); // fd >= 0 or an error
+int vfs_close(int fd);
+int vfs_read(int fd, void *buf, uint32_t n);
+int vfs_write(int fd, const void *buf, uint32_t n);
+int vfs_seek(int fd, int32_t off, int whence); // new position or an error
+// Next entry of an open directory: 1 with `out` filled, 0 at the end
+int vfs_readdir(int fd, vfs_dirent_t *out);
+
+int vfs_mkdir(const char *path);
+int vfs_unlink(const char *path); // files and empty directories
+int vfs_stat(const char *path, vfs_stat_t *st);
+
+#endif // VFS_H
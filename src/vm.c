@@ -0,0 +1,113 @@
+#include "vm.h"
+#include "kernel.h"
+#include "paging.h"
+#include "klib.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define PG_PRESENT 0x1 // page fault error code bits
+#define PG_RW      0x2
+#define PG_SIZE    4096
+#define PG_MASK    (~(uint32_t)(PG_SIZE - 1))
+
+addr_space_t *vm_create(void) {
+    addr_space_t *as = kmalloc(sizeof(addr_space_t));
+    if (!as) return NULL;
+    as->root = paging_root_create();
+    if (!as->root) {
+        kfree(as);
+        return NULL;
+    }
+    as->vmas = NULL;
+    as->resident = as->faults = 0;
+    return as;
+}
+
+void vm_destroy(addr_space_t *as) {
+    paging_root_destroy(as->root, pmm_free_frame);
+    while (as->vmas) {
+        vma_t *v = as->vmas;
+        as->vmas = v->next;
+        kfree(v);
+    }
+    kfree(as);
+}
+
+static vma_t *find_vma(addr_space_t *as, uint32_t addr) {
+    for (vma_t *v = as->vmas; v; v = v->next)
+        if (addr >= v->start && addr < v->end) return v;
+    return NULL;
+}
+
+int vm_map(addr_space_t *as, uint32_t start, uint32_t len, int flags,
+           const uint8_t *file, uint32_t file_len) {
+    uint32_t end = start + len;
+    if (!len || end < start || start < USER_BASE || end > USER_STACK_TOP || file_len > len) return 0;
+    for (vma_t *v = as->vmas; v; v = v->next)
+        if (start < v->end && v->start < end) return 0;
+    vma_t *v = kmalloc(sizeof(vma_t));
+    if (!v) return 0;
+    v->start = start;
+    v->end = end;
+    v->flags = flags;
+    v->file = file;
+    v->file_len = file_len;
+    v->next = as->vmas;
+    as->vmas = v;
+    return 1;
+}
+
+uint64_t vm_populate(addr_space_t *as, uint32_t addr) {
+    uint32_t page = addr & PG_MASK;
+    uint64_t frame = paging_lookup(as->root, page);
+    if (frame) return frame;
+
+    // Zeroed, so .bss needs no work; may lie above the identity map or
+    // above 4 GB, so it is filled through a temporary mapping
+    frame = pmm_alloc_frame();
+    if (!frame) return 0;
+    // Segments need not be page aligned: copy in whatever file-backed
+    // bytes of every region fall into this page
+    uint8_t *dst = kmap(frame);
+    int pflags = PAGING_USER;
+    for (vma_t *v = as->vmas; v; v = v->next) {
+        if (v->end <= page || v->start >= page + PG_SIZE) continue;
+        if (v->flags & VMA_WRITE) pflags |= PAGING_WRITE;
+        if (v->flags & VMA_EXEC) pflags |= PAGING_EXEC;
+        uint32_t lo = v->start > page ? v->start : page;
+        uint32_t hi = v->start + v->file_len;
+        if (hi > page + PG_SIZE) hi = page + PG_SIZE;
+        if (lo < hi) memcpy(dst + (lo - page), v->file + (lo - v->start), hi - lo);
+    }
+    kunmap(dst);
+    if (!paging_map(as->root, page, frame, pflags)) {
+        pmm_free_frame(frame);
+        return 0;
+    }
+    as->resident++;
+    return frame;
+}
+
+int vm_fault(addr_space_t *as, uint32_t addr, uint32_t err) {
+    if (!as || (err & PG_PRESENT)) return 0; // protection violation, not a missing page
+    vma_t *v = find_vma(as, addr);
+    if (!v || ((err & PG_RW) && !(v->flags & VMA_WRITE))) return 0;
+    if (!vm_populate(as, addr)) return 0;
+    as->faults++;
+    return 1;
+}
+
+int vm_user_ok(addr_space_t *as, uint32_t addr, uint32_t len, int write) {
+    uint32_t end = addr + len;
+    if (end < addr) return 0;
+    while (addr < end) {
+        vma_t *v = find_vma(as, addr);
+        if (!v || (write && !(v->flags & VMA_WRITE))) return 0;
+        addr = v->end;
+    }
+    return 1;
+}
+
+void vm_activate(addr_space_t *as) {
+    paging_load(as ? as->root : paging_kernel_root());
+}
@@ -0,0 +1,56 @@
+#ifndef VM_H
+#define VM_H
+
+#include <stdint.h>
+
+// Per-process address spaces. Each has its own page-table root sharing the
+// kernel's identity-mapped tables (see paging.h); the user half is
+// described by VMAs and populated one page at a time from the page fault
+// handler.
+#define USER_BASE       0x40000000
+#define USER_STACK_TOP  0xC0000000
+#define USER_STACK_SIZE (64 * 1024)
+
+#define VMA_WRITE 0x1
+#define VMA_EXEC  0x2
+
+// [start, end) of virtual memory; the first file_len bytes come from
+// `file` (kept alive by the caller, e.g. an initrd module), the rest is
+// zero-filled
+typedef struct vma {
+    uint32_t start, end;
+    int flags;
+    const uint8_t *file;
+    uint32_t file_len;
+    struct vma *next;
+} vma_t;
+
+typedef struct addr_space {
+    uint32_t root;     // page-table root, as loaded into CR3
+    vma_t *vmas;
+    uint32_t resident; // user pages populated so far
+    uint32_t faults;   // demand faults served
+} addr_space_t;
+
+addr_space_t *vm_create(void);
+void vm_destroy(addr_space_t *as); // must not be the active address space
+
+// Describe a region; nothing is allocated until it is touched.
+// Returns 0 if it overlaps an existing region or leaves the user range.
+int vm_map(addr_space_t *as, uint32_t start, uint32_t len, int flags,
+           const uint8_t *file, uint32_t file_len);
+
+// Populate the page holding `addr` now; returns its physical frame (reach
+// it with kmap) or 0
+uint64_t vm_populate(addr_space_t *as, uint32_t addr);
+
+// Page fault on `addr` with CPU error code `err`: 1 if it was resolved
+int vm_fault(addr_space_t *as, uint32_t addr, uint32_t err);
+
+// Whether [addr, addr+len) is mapped (or mappable on demand) for user access
+int vm_user_ok(addr_space_t *as, uint32_t addr, uint32_t len, int write);
+
+// Load `as` into CR3 (NULL: the kernel's own directory)
+void vm_activate(addr_space_t *as);
+
+#endif // VM_H
@@ -0,0 +1,300 @@
+#include "workqueue.h"
+#include "task.h"
+#include "cpu.h"
+#include "kconfig.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Where an item is
+#define WORK_IDLE    0
+#define WORK_PENDING 1
+#define WORK_DELAYED 2
+
+workqueue_t system_wq = { .name = "system" };
+
+static workqueue_t *wq_list = &system_wq;
+static workqueue_t *wq_cursor = NULL; // round-robin position for workers
+static work_t *wheel[WQ_WHEEL];       // delayed work by due tick, unsorted within a slot
+static uint32_t pending = 0;          // queued on all workqueues
+static uint32_t now_tick = 0;         // latest tick seen by workqueue_tick()
+static wait_queue_t pool_wait;        // idle workers
+static wait_queue_t flush_wait;
+
+static struct {
+    uint32_t workers, peak;
+    uint32_t idle;       // waiting for work, or woken and not yet back at it
+    uint32_t spawned, exited, spawn_failed;
+    uint32_t last_busy;  // tick work last started
+    uint32_t retry_tick; // no new worker before this tick after a failure
+    uint8_t starting;    // a new worker has not run yet
+    uint8_t reap;        // one idle worker beyond the minimum should exit
+} pool;
+
+// All list and pool updates run with interrupts off: work is queued and
+// delayed work expires from IRQ context.
+
+static void wake_workers(void) {
+    if (pool_wait.head) wait_queue_wake_all(&pool_wait);
+}
+
+static void enqueue(workqueue_t *wq, work_t *w) {
+    w->next = NULL;
+    w->wq = wq;
+    w->state = WORK_PENDING;
+    w->queued_tsc = rdtsc();
+    if (wq->tail) wq->tail->next = w;
+    else wq->head = w;
+    wq->tail = w;
+    if (++wq->depth > wq->max_depth) wq->max_depth = wq->depth;
+    wq->queued++;
+    pending++;
+    pool.reap = 0;
+}
+
+static void worker_main(void);
+
+// Task context only: task_create allocates a stack. `pool.workers`
+// already counts the new worker.
+static void spawn_worker(void) {
+    task_t *t = task_create(worker_main);
+    uint32_t flags = irq_save();
+    if (t) {
+        task_set_name(t, "kworker");
+        pool.spawned++;
+        if (pool.workers > pool.peak) pool.peak = pool.workers;
+    } else {
+        pool.workers--;
+        pool.starting = 0;
+        pool.spawn_failed++;
+        pool.retry_tick = now_tick + 1;
+    }
+    irq_restore(flags);
+}
+
+// Add a worker when work is waiting and every worker is busy, one at a time
+static void pool_grow(void) {
+    uint32_t flags = irq_save();
+    int grow = pending && !pool.idle && !pool.starting && pool.workers < CONFIG_WQ_MAX_WORKERS &&
+               (int32_t)(now_tick - pool.retry_tick) >= 0;
+    if (grow) {
+        pool.starting = 1;
+        pool.workers++;
+    }
+    irq_restore(flags);
+    if (grow) spawn_worker();
+}
+
+void workqueue_init(workqueue_t *wq, const char *name) {
+    *wq = (workqueue_t){ .name = name };
+    uint32_t flags = irq_save();
+    workqueue_t **p = &wq_list;
+    while (*p) p = &(*p)->next_wq;
+    *p = wq;
+    irq_restore(flags);
+}
+
+void workqueue_pool_init(void) {
+    for (int i = 0; i < WQ_MIN_WORKERS; ++i) {
+        uint32_t flags = irq_save();
+        pool.starting = 1;
+        pool.workers++;
+        irq_restore(flags);
+        spawn_worker();
+    }
+}
+
+int queue_work(workqueue_t *wq, work_t *w, work_fn fn, void *arg) {
+    uint32_t flags = irq_save();
+    if (w->state != WORK_IDLE) {
+        irq_restore(flags);
+        return 0;
+    }
+    w->fn = fn;
+    w->arg = arg;
+    enqueue(wq, w);
+    wake_workers();
+    irq_restore(flags);
+    // Interrupts were on, so this is not an IRQ handler: safe to allocate
+    if (flags & EFLAGS_IF) pool_grow();
+    return 1;
+}
+
+int queue_delayed_work(workqueue_t *wq, work_t *w, work_fn fn, void *arg, uint32_t ticks) {
+    if (!ticks) return queue_work(wq, w, fn, arg);
+    uint32_t flags = irq_save();
+    if (w->state != WORK_IDLE) {
+        irq_restore(flags);
+        return 0;
+    }
+    w->fn = fn;
+    w->arg = arg;
+    w->wq = wq;
+    w->due = now_tick + ticks;
+    w->state = WORK_DELAYED;
+    work_t **slot = &wheel[w->due & (WQ_WHEEL - 1)];
+    w->next = *slot;
+    *slot = w;
+    wq->delayed++;
+    irq_restore(flags);
+    return 1;
+}
+
+int cancel_work(work_t *w) {
+    uint32_t flags = irq_save();
+    workqueue_t *wq = w->wq;
+    int removed = 0;
+    if (w->state == WORK_PENDING) {
+        work_t *prev = NULL;
+        for (work_t *cur = wq->head; cur; prev = cur, cur = cur->next) {
+            if (cur != w) continue;
+            if (prev) prev->next = w->next;
+            else wq->head = w->next;
+            if (wq->tail == w) wq->tail = prev;
+            wq->depth--;
+            pending--;
+            removed = 1;
+            break;
+        }
+    } else if (w->state == WORK_DELAYED) {
+        for (work_t **p = &wheel[w->due & (WQ_WHEEL - 1)]; *p; p = &(*p)->next) {
+            if (*p != w) continue;
+            *p = w->next;
+            wq->delayed--;
+            removed = 1;
+            break;
+        }
+    }
+    if (removed) {
+        w->state = WORK_IDLE;
+        w->next = NULL;
+        wq->cancelled++;
+        if (flush_wait.head && !wq->depth && !wq->running) wait_queue_wake_all(&flush_wait);
+    }
+    irq_restore(flags);
+    return removed;
+}
+
+// Must not run on a worker executing an item of `wq` (it would wait for
+// itself); delayed items still waiting for their tick are not waited for
+void flush_workqueue(workqueue_t *wq) {
+    uint32_t flags = irq_save();
+    while (wq->depth || wq->running) wait_queue_sleep(&flush_wait);
+    irq_restore(flags);
+}
+
+// One wheel slot per tick; entries more than a lap away stay for a later one
+void workqueue_tick(uint32_t tick) {
+    now_tick = tick;
+    for (work_t **p = &wheel[tick & (WQ_WHEEL - 1)]; *p;) {
+        work_t *w = *p;
+        if ((int32_t)(tick - w->due) >= 0) {
+            *p = w->next;
+            w->wq->delayed--;
+            enqueue(w->wq, w);
+        } else {
+            p = &w->next;
+        }
+    }
+    if (pending) {
+        wake_workers();
+    } else if (pool.idle && pool.workers > WQ_MIN_WORKERS && !pool.reap &&
+               tick - pool.last_busy >= WQ_IDLE_TICKS) {
+        // One spare worker per idle period, so a lull shrinks the pool gradually
+        pool.reap = 1;
+        pool.last_busy = tick;
+        wake_workers();
+    }
+}
+
+// Next item, taking queues in turn so a busy one cannot starve the rest
+static work_t *dequeue(void) {
+    if (!pending) return NULL;
+    workqueue_t *wq = wq_cursor ? wq_cursor : wq_list;
+    for (;;) { // some queue has work
+        workqueue_t *next = wq->next_wq ? wq->next_wq : wq_list;
+        work_t *w = wq->head;
+        if (w) {
+            wq->head = w->next;
+            if (!wq->head) wq->tail = NULL;
+            wq->depth--;
+            pending--;
+            wq_cursor = next;
+            return w;
+        }
+        wq = next;
+    }
+}
+
+static int run_one(void) {
+    uint32_t flags = irq_save();
+    work_t *w = dequeue();
+    if (!w) {
+        irq_restore(flags);
+        return 0;
+    }
+    workqueue_t *wq = w->wq;
+    uint64_t start = rdtsc(), lat = start - w->queued_tsc;
+    wq->lat_total += lat;
+    if (lat > wq->lat_max) wq->lat_max = lat;
+    wq->running++;
+    pool.last_busy = now_tick;
+    work_fn fn = w->fn;
+    void *arg = w->arg;
+    w->state = WORK_IDLE; // not touched again: fn may requeue or free it
+    irq_restore(flags);
+    pool_grow(); // more waiting behind this item?
+    fn(arg);
+    uint64_t ran = rdtsc() - start;
+    flags = irq_save();
+    if (ran > wq->run_max) wq->run_max = ran;
+    wq->running--;
+    wq->done++;
+    if (flush_wait.head && !wq->depth && !wq->running) wait_queue_wake_all(&flush_wait);
+    irq_restore(flags);
+    return 1;
+}
+
+int workqueue_run_pending(void) {
+    int ran = 0;
+    while (run_one()) ran++;
+    return ran;
+}
+
+static void worker_main(void) {
+    uint32_t flags = irq_save();
+    pool.starting = 0;
+    irq_restore(flags);
+    for (;;) {
+        workqueue_run_pending();
+        flags = irq_save();
+        if (!pending) {
+            if (pool.reap && pool.workers > WQ_MIN_WORKERS) {
+                pool.reap = 0;
+                pool.workers--;
+                pool.exited++;
+                irq_restore(flags);
+                return; // into task_exit
+            }
+            pool.idle++;
+            wait_queue_sleep(&pool_wait);
+            pool.idle--;
+        }
+        irq_restore(flags);
+    }
+}
+
+void workqueue_pool_stats(workqueue_pool_stats_t *st) {
+    uint32_t flags = irq_save();
+    st->workers = pool.workers;
+    st->idle = pool.idle;
+    st->peak = pool.peak;
+    st->spawned = pool.spawned;
+    st->exited = pool.exited;
+    st->spawn_failed = pool.spawn_failed;
+    st->pending = pending;
+    irq_restore(flags);
+}
+
+workqueue_t *workqueue_list(void) {
+    return wq_list;
+}
@@ -0,0 +1,82 @@
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include <stdint.h>
+
+// Deferred work. A work item is an intrusive node (a work_t, usually
+// embedded in the caller's struct) naming a function and its argument;
+// queueing never allocates, and an item already pending is not queued
+// twice. Items run in task context on a shared pool of kernel worker
+// tasks, so unlike IRQ handlers and async operations they may sleep and
+// block. The pool keeps WQ_MIN_WORKERS and adds workers, up to
+// CONFIG_WQ_MAX_WORKERS, while work waits with none of them idle; spare
+// workers exit after WQ_IDLE_TICKS without work. There is one CPU, so each
+// workqueue is a single FIFO rather than one per CPU.
+#define WQ_MIN_WORKERS 1
+#define WQ_IDLE_TICKS  200
+#define WQ_WHEEL       64 // delayed-work timer wheel slots, power of two
+
+typedef void (*work_fn)(void *arg);
+
+struct workqueue;
+
+typedef struct work {
+    work_fn fn;
+    void *arg;
+    struct work *next;    // queue or timer wheel slot
+    struct workqueue *wq;
+    uint64_t queued_tsc;  // when it became runnable
+    uint32_t due;         // delayed work: tick it is queued at
+    uint8_t state;
+} work_t;
+
+typedef struct workqueue {
+    const char *name;
+    work_t *head, *tail;
+    struct workqueue *next_wq; // all registered queues
+    uint32_t depth, max_depth; // queued, not yet started
+    uint32_t delayed;          // waiting for their tick
+    uint32_t running;          // started, not yet returned
+    uint32_t queued, done, cancelled;
+    uint64_t lat_total, lat_max; // queue-to-start, in TSC cycles
+    uint64_t run_max;            // longest item, in TSC cycles
+} workqueue_t;
+
+typedef struct workqueue_pool_stats {
+    uint32_t workers, idle, peak;
+    uint32_t spawned, exited, spawn_failed;
+    uint32_t pending; // queued on all workqueues
+} workqueue_pool_stats_t;
+
+// Shared queue for code that does not need its own statistics
+extern workqueue_t system_wq;
+
+// Register `wq`; queues live for as long as the kernel does
+void workqueue_init(workqueue_t *wq, const char *name);
+// Start the minimum set of workers (task context, after tasking_init)
+void workqueue_pool_init(void);
+
+// Queue `w` to call fn(arg) on a worker; 1 if queued, 0 if it was already
+// pending (fn and arg then stay as they were). The item is idle again once
+// fn starts, so fn may requeue or free it. Safe from IRQ context.
+int queue_work(workqueue_t *wq, work_t *w, work_fn fn, void *arg);
+// Same, after `ticks` timer ticks (0 queues at once)
+int queue_delayed_work(workqueue_t *wq, work_t *w, work_fn fn, void *arg, uint32_t ticks);
+// Take a pending or delayed item off its queue; 0 if it was not waiting
+// (idle, or already running)
+int cancel_work(work_t *w);
+// Wait until `wq` has nothing queued or running (task context)
+void flush_workqueue(workqueue_t *wq);
+
+// Timer interrupt hook: queue delayed work that is due, retire idle workers
+void workqueue_tick(uint32_t tick);
+
+// Run queued items in the calling task until none are left; returns how
+// many ran. Workers loop on this.
+int workqueue_run_pending(void);
+
+void workqueue_pool_stats(workqueue_pool_stats_t *st);
+// First registered queue, then follow next_wq
+workqueue_t *workqueue_list(void);
+
+#endif // WORKQUEUE_H
@@ -0,0 +1,66 @@
+// Shared helpers for the host-side tests of kernel modules: failure
+// counting, a seeded PRNG and a monotonic clock for the throughput runs.
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            if (failures++ < 20) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } \
+        } \
+    } while (0)
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static inline void rng_seed(uint64_t seed) {
+    rng_state = seed ? seed : 1;
+}
+
+static inline uint32_t rng_next(void) { // xorshift64*
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (uint32_t)((rng_state * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+static inline uint32_t rng_range(uint32_t lo, uint32_t hi) { // inclusive
+    return lo + rng_next() % (hi - lo + 1);
+}
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Test binaries take: [--bench] [--seed N]
+static inline int parse_args(int argc, char **argv, int *bench) {
+    *bench = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--bench")) *bench = 1;
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) rng_seed(strtoull(argv[++i], 0, 0));
+        else {
+            printf("usage: %s [--bench] [--seed N]\n", argv[0]);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static inline int report_result(const char *name) {
+    if (failures) {
+        printf("%s: %d failures\n", name, failures);
+        return 1;
+    }
+    printf("%s: all tests passed\n", name);
+    return 0;
+}
+
+#endif // HOST_TEST_H
@@ -0,0 +1,171 @@
+// Host-side checks for src/async.c: continuation resume points, the timer
+// wheel (exact expiry, delays longer than a lap, tick wraparound), events
+// with re-checked conditions, bounded executor passes and frames freed by
+// their own operation. --bench times start/resume and timer churn.
+#include "async.h"
+#include "task.h"
+#include "host_test.h"
+
+void wait_queue_sleep(wait_queue_t *q) { (void)q; }
+void wait_queue_wake_all(wait_queue_t *q) { (void)q; }
+
+static uint32_t tick;
+
+static void run_ticks(uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        async_tick(++tick);
+        async_run_pending();
+    }
+}
+
+// Three steps, one suspension kind each
+typedef struct step_op {
+    async_op_t op;
+    int step;
+    uint32_t woke_at;
+} step_op_t;
+
+static async_event_t event;
+static int cond;
+
+static int step_fn(async_op_t *op) {
+    step_op_t *s = (step_op_t *)op;
+    ASYNC_BEGIN(op);
+    s->step = 1;
+    ASYNC_YIELD(op);
+    s->step = 2;
+    ASYNC_SLEEP(op, 5);
+    s->woke_at = tick;
+    s->step = 3;
+    ASYNC_WAIT_UNTIL(op, &event, cond);
+    s->step = 4;
+    ASYNC_END(op);
+}
+
+static void test_steps(void) {
+    step_op_t s = {0};
+    async_stats_t st;
+    async_start(&s.op, step_fn);
+    CHECK(s.step == 0, "ran before the executor");
+    CHECK(async_run_pending() == 1 && s.step == 1, "first pass stops at the yield");
+    CHECK(async_run_pending() == 1 && s.step == 2, "resume after yield");
+    CHECK(async_run_pending() == 0, "sleeping op ran");
+    uint32_t start = tick;
+    run_ticks(4);
+    CHECK(s.step == 2, "woke early");
+    run_ticks(1);
+    CHECK(s.step == 3 && s.woke_at == start + 5, "sleep 5 woke at +%u", s.woke_at - start);
+    async_event_signal(&event);
+    async_run_pending();
+    CHECK(s.step == 3, "condition false, should park again");
+    cond = 1;
+    CHECK(async_run_pending() == 0, "nothing queued without a signal");
+    async_event_signal(&event);
+    async_run_pending();
+    CHECK(s.step == 4, "event wakeup");
+    async_stats(&st);
+    CHECK(st.pending == 0 && st.completed == st.started, "accounting: %u pending", st.pending);
+    cond = 0;
+}
+
+// Many timers with random delays, some longer than a wheel lap; each op
+// frees its own frame
+typedef struct timer_op {
+    async_op_t op;
+    uint32_t due;
+} timer_op_t;
+
+static int late, early, freed;
+
+static int timer_fn(async_op_t *op) {
+    timer_op_t *t = (timer_op_t *)op;
+    ASYNC_BEGIN(op);
+    ASYNC_SLEEP(op, t->due - tick);
+    if (tick > t->due) late++;
+    if (tick < t->due) early++;
+    free(t);
+    freed++;
+    ASYNC_END(op);
+}
+
+static void test_timers(uint32_t start_tick) {
+    const int n = 5000;
+    tick = start_tick;
+    async_tick(tick);
+    late = early = freed = 0;
+    for (int i = 0; i < n; ++i) {
+        timer_op_t *t = malloc(sizeof(*t));
+        t->due = tick + rng_range(1, 5 * ASYNC_WHEEL);
+        async_start(&t->op, timer_fn);
+    }
+    async_run_pending();
+    async_stats_t st;
+    async_stats(&st);
+    CHECK(st.timers == (uint32_t)n, "%u timers parked", st.timers);
+    run_ticks(5 * ASYNC_WHEEL);
+    CHECK(freed == n && !late && !early, "start %#x: %d done, %d late, %d early", start_tick, freed, late, early);
+    async_stats(&st);
+    CHECK(st.timers == 0 && st.pending == 0, "leftover timers %u", st.timers);
+}
+
+static int spins;
+static int spinner(async_op_t *op) {
+    ASYNC_BEGIN(op);
+    while (spins < 1000) {
+        spins++;
+        ASYNC_YIELD(op);
+    }
+    ASYNC_END(op);
+}
+
+static void test_bounded_pass(void) {
+    async_op_t a, b;
+    spins = 0;
+    async_start(&a, spinner);
+    async_start(&b, spinner);
+    CHECK(async_run_pending() == 2 && spins == 2, "a pass runs each queued op once");
+    while (async_run_pending()) {}
+    CHECK(spins == 1000, "spinners finished at %d", spins);
+    CHECK(sizeof(async_op_t) <= 2 * sizeof(void *) + 8, "frame is %zu bytes", sizeof(async_op_t));
+}
+
+static void bench(void) {
+    const int ops = 2000000;
+    async_op_t op;
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < ops; ++i) {
+        async_start(&op, spinner); // spins is 1000: completes on first run
+        async_run_pending();
+    }
+    uint64_t t1 = now_ns();
+    spins = -ops;
+    async_start(&op, spinner);
+    while (async_run_pending()) {}
+    uint64_t t2 = now_ns();
+    printf("async start+complete: %5.1f ns\n", (double)(t1 - t0) / ops);
+    printf("async yield+resume:   %5.1f ns\n", (double)(t2 - t1) / (ops + 1000));
+
+    const int timers = 100000;
+    t0 = now_ns();
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < timers; ++i) {
+            timer_op_t *t = malloc(sizeof(*t));
+            t->due = tick + 1 + (i & 255);
+            async_start(&t->op, timer_fn);
+        }
+        async_run_pending();
+        run_ticks(256);
+    }
+    printf("timer sleep+expire:   %5.1f ns (%d concurrent)\n", (double)(now_ns() - t0) / (10 * timers), timers);
+}
+
+int main(int argc, char **argv) {
+    int bench_mode;
+    if (!parse_args(argc, argv, &bench_mode)) return 2;
+    test_steps();
+    test_timers(1000);
+    test_timers(0xFFFFFF00u); // wheel laps across the 32-bit wrap
+    test_bounded_pass();
+    if (bench_mode) bench();
+    return report_result("test_async");
+}
@@ -0,0 +1,205 @@
+// Host-side checks for src/block.c against a fake ATA drive: data integrity
+// through the buffer cache, request merging, sequential read-ahead, LRU
+// eviction, write-through and error handling. The fake drive completes its
+// command when a caller would sleep, standing in for the IRQ.
+#include "block.h"
+#include "ata.h"
+#include "task.h"
+#include "pmm.h"
+#include "host_test.h"
+
+#define DISK_BLOCKS 1024
+
+// --- Fake drive and kernel stubs ---
+static uint8_t *disk;
+static ata_drive_info_t drive0 = { .present = 1, .sectors = DISK_BLOCKS * BLOCK_SECTORS, .model = "FAKE" };
+static struct {
+    int active, write;
+    uint32_t lba, count;
+    void *segs[ATA_MAX_SEGS];
+    int nseg;
+    ata_done_fn done;
+    void *ctx;
+} cmd;
+static int fail_next, max_sectors, bad_segments;
+
+uint8_t *pmm_host_base;
+static uint32_t next_page = 0x100000;
+
+void *alloc_page(void) {
+    uint32_t p = next_page;
+    next_page += PMM_PAGE_SIZE;
+    return (void *)(uintptr_t)p;
+}
+void free_page(void *addr) { (void)addr; }
+
+const ata_drive_info_t *ata_drive(int drive) { return drive == 0 ? &drive0 : NULL; }
+
+int ata_start(int drive, uint32_t lba, uint32_t count, int write,
+              void *const *segs, const uint32_t *seg_len, int nseg,
+              ata_done_fn done, void *ctx) {
+    if (drive != 0 || cmd.active || (uint32_t)nseg * BLOCK_SECTORS != count) {
+        bad_segments++;
+        return 0;
+    }
+    for (int i = 0; i < nseg; ++i)
+        if (seg_len[i] != BLOCK_SIZE) bad_segments++;
+    if (count > (uint32_t)max_sectors) max_sectors = count;
+    cmd.active = 1;
+    cmd.write = write;
+    cmd.lba = lba;
+    cmd.count = count;
+    memcpy(cmd.segs, segs, nseg * sizeof(void *));
+    cmd.nseg = nseg;
+    cmd.done = done;
+    cmd.ctx = ctx;
+    return 1;
+}
+
+static void fake_irq(void) {
+    if (!cmd.active) return;
+    cmd.active = 0;
+    int error = fail_next;
+    fail_next = 0;
+    if (!error) {
+        for (int i = 0; i < cmd.nseg; ++i) {
+            uint8_t *d = disk + (uint64_t)(cmd.lba / BLOCK_SECTORS + i) * BLOCK_SIZE;
+            if (cmd.write) memcpy(d, cmd.segs[i], BLOCK_SIZE);
+            else memcpy(cmd.segs[i], d, BLOCK_SIZE);
+        }
+    }
+    cmd.done(0, error, cmd.ctx);
+}
+
+void wait_queue_sleep(wait_queue_t *q) { (void)q; fake_irq(); }
+void wait_queue_wake_all(wait_queue_t *q) { (void)q; }
+
+static void fill_disk(void) {
+    for (uint32_t b = 0; b < DISK_BLOCKS; ++b)
+        for (uint32_t w = 0; w < BLOCK_SIZE / 4; ++w)
+            ((uint32_t *)(disk + b * BLOCK_SIZE))[w] = b * 0x10000 + w;
+}
+
+static int block_ok(const buf_t *b, uint32_t block) {
+    return b && b->block == block && !memcmp(b->data, disk + block * BLOCK_SIZE, BLOCK_SIZE);
+}
+
+static void test_sequential(void) {
+    block_invalidate(-1);
+    block_stats_reset();
+    for (uint32_t i = 0; i < 64; ++i) {
+        buf_t *b = bread(0, i);
+        CHECK(block_ok(b, i), "sequential block %u", i);
+        brelse(b);
+    }
+    block_stats_t st;
+    block_stats(&st);
+    CHECK(st.misses == 1, "sequential pass missed %u times", st.misses);
+    CHECK(st.readahead >= 60 && st.ra_hits >= 60, "read-ahead %u, hits %u", st.readahead, st.ra_hits);
+    CHECK(st.commands < 20, "%u commands for 64 blocks", st.commands);
+    CHECK(st.merged > 0 && st.blocks_read >= 64, "merged %u, read %u", st.merged, st.blocks_read);
+
+    block_stats_reset();
+    buf_t *b = bread(0, 10);
+    CHECK(block_ok(b, 10), "cached re-read");
+    brelse(b);
+    block_stats(&st);
+    CHECK(st.hits == 1 && st.commands == 0, "re-read should hit without I/O");
+}
+
+static void test_merge_limit(void) {
+    block_invalidate(-1);
+    max_sectors = 0;
+    // Held buffers queued back to back all go out merged, capped per command
+    for (uint32_t i = 200; i < 300; ++i) brelse(bread(0, i));
+    CHECK(max_sectors <= ATA_MAX_SECTORS, "command of %d sectors", max_sectors);
+    CHECK(!bad_segments, "malformed scatter list");
+}
+
+static void test_lru(void) {
+    block_invalidate(-1);
+    brelse(bread(0, 500));
+    for (uint32_t i = 0; i < BLOCK_NBUF / 2; ++i) brelse(bread(0, 600 + 2 * i)); // no read-ahead
+    block_stats_reset();
+    brelse(bread(0, 500));
+    block_stats_t st;
+    block_stats(&st);
+    CHECK(st.hits == 1, "recently used block evicted");
+    for (uint32_t i = 0; i < BLOCK_NBUF + 8; ++i) brelse(bread(0, 100 + 3 * i));
+    block_stats_reset();
+    buf_t *b = bread(0, 500);
+    block_stats(&st);
+    CHECK(st.misses == 1 && block_ok(b, 500), "stale block not evicted");
+    brelse(b);
+}
+
+static void test_random(void) {
+    block_invalidate(-1);
+    buf_t *held[8] = {0};
+    for (int i = 0; i < 5000; ++i) {
+        uint32_t blk = rng_range(0, DISK_BLOCKS - 1);
+        if (rng_next() & 1) blk = (blk & ~15u) + (i & 15); // runs of sequential reads
+        int slot = rng_range(0, 7);
+        brelse(held[slot]);
+        held[slot] = bread(0, blk);
+        CHECK(block_ok(held[slot], blk), "random read of block %u", blk);
+    }
+    for (int i = 0; i < 8; ++i) brelse(held[i]);
+    CHECK(!bad_segments, "malformed scatter list");
+}
+
+static void test_write_and_errors(void) {
+    block_invalidate(-1);
+    buf_t *b = bread(0, 42);
+    memset(b->data, 0x5A, BLOCK_SIZE);
+    CHECK(bwrite(b) == 0, "bwrite failed");
+    CHECK(disk[42 * BLOCK_SIZE] == 0x5A && disk[43 * BLOCK_SIZE - 1] == 0x5A, "write did not reach the disk");
+    brelse(b);
+    block_invalidate(0);
+    b = bread(0, 42);
+    CHECK(b && b->data[100] == 0x5A, "written data lost");
+    brelse(b);
+
+    block_invalidate(-1);
+    block_stats_reset();
+    fail_next = 1;
+    CHECK(!bread(0, 77), "failed read returned a buffer");
+    b = bread(0, 77);
+    CHECK(block_ok(b, 77), "retry after error");
+    brelse(b);
+    block_stats_t st;
+    block_stats(&st);
+    CHECK(st.errors >= 1, "error not counted");
+    CHECK(!bread(0, DISK_BLOCKS) && !bread(1, 0), "out of range reads");
+}
+
+static void bench_stream(void) {
+    const int passes = 20;
+    uint64_t t0 = now_ns();
+    for (int p = 0; p < passes; ++p) {
+        block_invalidate(-1);
+        for (uint32_t i = 0; i < DISK_BLOCKS; ++i) brelse(bread(0, i));
+    }
+    uint64_t t1 = now_ns();
+    for (int p = 0; p < passes * 8; ++p)
+        for (uint32_t i = 0; i < BLOCK_NBUF / 2; ++i) brelse(bread(0, i));
+    uint64_t t2 = now_ns();
+    printf("stream (cold, fake drive): %.1f ns/block\n", (double)(t1 - t0) / (passes * DISK_BLOCKS));
+    printf("cached re-read:            %.1f ns/block\n", (double)(t2 - t1) / (passes * 8 * (BLOCK_NBUF / 2)));
+}
+
+int main(int argc, char **argv) {
+    int bench;
+    if (!parse_args(argc, argv, &bench)) return 2;
+    disk = malloc(DISK_BLOCKS * BLOCK_SIZE);
+    pmm_host_base = calloc(1, next_page + BLOCK_NBUF * PMM_PAGE_SIZE);
+    fill_disk();
+    CHECK(block_init() == BLOCK_NBUF, "buffer allocation");
+    test_sequential();
+    test_merge_limit();
+    test_lru();
+    test_random();
+    test_write_and_errors();
+    if (bench) bench_stream();
+    return report_result("test_block");
+}
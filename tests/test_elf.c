@@ -0,0 +1,135 @@
+// Host-side checks for src/elf.c: header and segment validation on crafted
+// images, and that elf_exec() only describes segments (no copying) with
+// the address-space and task calls stubbed out.
+#include "elf.h"
+#include "vm.h"
+#include "syscall.h"
+#include "host_test.h"
+
+// --- Stubs for the kernel side ---
+static addr_space_t fake_as;
+static uint32_t stack_page[1024];
+static int maps, map_fail_at = -1, destroyed;
+static struct { uint32_t start, len, file_len; int flags; const uint8_t *file; } mapped[8];
+static task_t fake_task;
+
+addr_space_t *vm_create(void) { return &fake_as; }
+void vm_destroy(addr_space_t *as) { (void)as; destroyed++; }
+int vm_map(addr_space_t *as, uint32_t start, uint32_t len, int flags, const uint8_t *file, uint32_t file_len) {
+    (void)as;
+    if (maps == map_fail_at) return 0;
+    if (maps < 8) {
+        mapped[maps].start = start;
+        mapped[maps].len = len;
+        mapped[maps].flags = flags;
+        mapped[maps].file = file;
+        mapped[maps].file_len = file_len;
+    }
+    maps++;
+    return 1;
+}
+#define STACK_FRAME 0x123000
+uint64_t vm_populate(addr_space_t *as, uint32_t addr) {
+    (void)as;
+    return addr >= USER_STACK_TOP - 4096 ? STACK_FRAME : 0;
+}
+void *kmap(uint64_t pa) { return pa == STACK_FRAME ? stack_page : NULL; }
+void kunmap(void *va) { (void)va; }
+task_t *task_create_process(struct addr_space *as, uint32_t eip, uint32_t esp) {
+    fake_task.as = as;
+    fake_task.user_eip = eip;
+    fake_task.user_esp = esp;
+    fake_task.id = 42;
+    return &fake_task;
+}
+void task_set_name(task_t *t, const char *name) { t->name = name; }
+int syscall_fast_available(void) { return 1; }
+
+// --- Image builder: text at USER_BASE, then data with a large .bss ---
+static uint8_t img[3 * 4096];
+
+static elf32_ehdr_t *ehdr(void) { return (elf32_ehdr_t *)img; }
+static elf32_phdr_t *ph(int i) { return (elf32_phdr_t *)(img + sizeof(elf32_ehdr_t)) + i; }
+
+static void build(void) {
+    memset(img, 0, sizeof(img));
+    elf32_ehdr_t *eh = ehdr();
+    memcpy(eh->e_ident, "\x7f" "ELF\x01\x01\x01", 7);
+    eh->e_type = ET_EXEC;
+    eh->e_machine = EM_386;
+    eh->e_version = 1;
+    eh->e_entry = USER_BASE + 0x10;
+    eh->e_phoff = sizeof(elf32_ehdr_t);
+    eh->e_ehsize = sizeof(elf32_ehdr_t);
+    eh->e_phentsize = sizeof(elf32_phdr_t);
+    eh->e_phnum = 2;
+    *ph(0) = (elf32_phdr_t){ PT_LOAD, 4096, USER_BASE, USER_BASE, 4096, 4096, PF_R | PF_X, 4096 };
+    *ph(1) = (elf32_phdr_t){ PT_LOAD, 8192, USER_BASE + 0x1000, USER_BASE + 0x1000, 100,
+                             16 * 1024 * 1024, PF_R | PF_W, 4096 };
+}
+
+static void test_check(void) {
+    build();
+    CHECK(elf_check(img, sizeof(img)) == ELF_OK, "valid image rejected: %d", elf_check(img, sizeof(img)));
+    CHECK(elf_check(img, 20) == ELF_EBADMAGIC, "short image");
+    build(); img[1] = 'X';
+    CHECK(elf_check(img, sizeof(img)) == ELF_EBADMAGIC, "bad magic");
+    build(); img[4] = 2; // ELFCLASS64
+    CHECK(elf_check(img, sizeof(img)) == ELF_EBADMAGIC, "64-bit accepted");
+    build(); ehdr()->e_machine = 62;
+    CHECK(elf_check(img, sizeof(img)) == ELF_ETYPE, "x86-64 machine accepted");
+    build(); ehdr()->e_type = 3;
+    CHECK(elf_check(img, sizeof(img)) == ELF_ETYPE, "ET_DYN accepted");
+    build(); ehdr()->e_phnum = 2000;
+    CHECK(elf_check(img, sizeof(img)) == ELF_ETRUNC, "program headers past the end");
+    build(); ph(1)->p_offset = sizeof(img) - 50;
+    CHECK(elf_check(img, sizeof(img)) == ELF_ETRUNC, "segment data past the end");
+    build(); ph(1)->p_offset = 0xFFFFFFF0;
+    CHECK(elf_check(img, sizeof(img)) == ELF_ETRUNC, "offset overflow");
+    build(); ph(0)->p_vaddr = 0x100000;
+    CHECK(elf_check(img, sizeof(img)) == ELF_ESEGMENT, "kernel address accepted");
+    build(); ph(1)->p_memsz = 0xFFFFFF00;
+    CHECK(elf_check(img, sizeof(img)) == ELF_ESEGMENT, "vaddr + memsz overflow");
+    build(); ph(1)->p_filesz = 4096; ph(1)->p_memsz = 100;
+    CHECK(elf_check(img, sizeof(img)) == ELF_ESEGMENT, "filesz > memsz");
+    build(); ph(1)->p_vaddr = USER_BASE + 0x800;
+    CHECK(elf_check(img, sizeof(img)) == ELF_ESEGMENT, "overlapping segments");
+    build(); ehdr()->e_entry = USER_BASE + 0x1010;
+    CHECK(elf_check(img, sizeof(img)) == ELF_EENTRY, "entry in data segment");
+}
+
+static void test_exec(void) {
+    elf_exec_info_t info;
+    build();
+    maps = destroyed = 0;
+    map_fail_at = -1;
+    fake_as.resident = 1;
+    int err = elf_exec(img, sizeof(img), "prog", &info);
+    CHECK(err == ELF_OK, "exec failed: %s", elf_strerror(err));
+    CHECK(info.id == 42 && info.resident == 1 && !strcmp(fake_task.name, "prog"), "exec info / name");
+    CHECK(maps == 3, "expected text, data and stack regions, got %d", maps);
+    CHECK(mapped[0].file == img + 4096 && mapped[0].file_len == 4096 && mapped[0].flags == VMA_EXEC,
+          "text region");
+    CHECK(mapped[1].file == img + 8192 && mapped[1].file_len == 100 && mapped[1].len == 16 * 1024 * 1024 &&
+          mapped[1].flags == VMA_WRITE, "data+bss region not lazy / wrong");
+    CHECK(mapped[2].start == USER_STACK_TOP - USER_STACK_SIZE && !mapped[2].file, "stack region");
+    CHECK(fake_task.user_eip == USER_BASE + 0x10 && fake_task.user_esp == USER_STACK_TOP - 8, "entry state");
+    CHECK(stack_page[1023] == 1 && stack_page[1022] == 0, "entry arguments");
+    CHECK(!destroyed, "address space freed on success");
+
+    build();
+    maps = 0;
+    map_fail_at = 1;
+    CHECK(elf_exec(img, sizeof(img), "prog", &info) == ELF_ENOMEM && destroyed == 1,
+          "failed exec must release its address space");
+    build(); img[0] = 0;
+    CHECK(elf_exec(img, sizeof(img), "prog", &info) == ELF_EBADMAGIC, "exec of garbage");
+}
+
+int main(int argc, char **argv) {
+    int bench;
+    if (!parse_args(argc, argv, &bench)) return 2;
+    test_check();
+    test_exec();
+    return report_result("test_elf");
+}
@@ -0,0 +1,294 @@
+// Host-side checks for src/heap.c on a mock heap region: unit tests,
+// a randomized alloc/free stress run that verifies block contents and full
+// coalescing, the free-block histogram, the CONFIG_HEAP_TRACK site table,
+// and (--bench) throughput plus fragmentation over time for a few
+// allocation-size distributions.
+#include "heap.h"
+#include "kconfig.h"
+#include "host_test.h"
+
+#if CONFIG_HEAP_BEST_FIT
+#define TEST_NAME "test_heap (best fit)"
+#elif CONFIG_HEAP_TRACK
+#define TEST_NAME "test_heap (tracking)"
+#else
+#define TEST_NAME "test_heap"
+#endif
+
+#define REGION_SIZE (128 * 1024)
+#define MAX_LIVE 2048
+
+static uint8_t region[REGION_SIZE] __attribute__((aligned(16)));
+
+typedef struct live {
+    uint8_t *ptr;
+    int size;
+    uint8_t tag;
+} live_t;
+
+static live_t live[MAX_LIVE];
+static int nlive = 0;
+
+static void expect_pristine(const char *when) {
+    heap_stats_t st;
+    heap_get_stats(&st);
+    CHECK(st.blocks == 1 && st.free_blocks == 1, "%s: %d blocks, %d free (want 1/1)",
+          when, st.blocks, st.free_blocks);
+    CHECK(st.used_bytes == 0, "%s: %d bytes still used", when, st.used_bytes);
+}
+
+static void test_unit(void) {
+    heap_init_region(region, REGION_SIZE);
+    expect_pristine("after init");
+    heap_stats_t st;
+    heap_get_stats(&st);
+    int capacity = st.largest_free;
+    CHECK(capacity > REGION_SIZE - 64 && capacity < REGION_SIZE, "capacity %d", capacity);
+
+    uint8_t *a = kmalloc(1), *b = kmalloc(13), *c = kmalloc(100);
+    CHECK(a && b && c, "small allocations failed");
+    CHECK(!((uintptr_t)a & 7) && !((uintptr_t)b & 7) && !((uintptr_t)c & 7), "8-byte alignment");
+    CHECK(a + 8 <= b && b + 16 <= c, "blocks overlap or out of order");
+    CHECK(a >= region && c + 100 <= region + REGION_SIZE, "block outside the region");
+
+    kfree(b);
+    uint8_t *d = kmalloc(16);
+    CHECK(d == b, "freed block not reused by first fit");
+    kfree(a);
+    kfree(c);
+    kfree(d);
+    kfree(NULL);
+    expect_pristine("after freeing everything");
+
+    CHECK(kmalloc(capacity + 8) == NULL, "oversized allocation succeeded");
+    void *all = kmalloc(capacity);
+    CHECK(all != NULL, "allocation of the whole heap failed");
+    CHECK(kmalloc(8) == NULL, "allocation from a full heap succeeded");
+    kfree(all);
+    expect_pristine("after whole-heap block");
+
+    // Freeing in reverse and interleaved orders must still coalesce fully
+    void *p[16];
+    for (int i = 0; i < 16; ++i) p[i] = kmalloc(40 + i * 8);
+    for (int i = 1; i < 16; i += 2) kfree(p[i]);
+    for (int i = 14; i >= 0; i -= 2) kfree(p[i]);
+    expect_pristine("after interleaved frees");
+}
+
+static void live_free(int i) {
+    live_t *l = &live[i];
+    for (int k = 0; k < l->size; ++k) {
+        if (l->ptr[k] != l->tag) {
+            CHECK(0, "block %p corrupted at +%d", (void *)l->ptr, k);
+            break;
+        }
+    }
+    kfree(l->ptr);
+    live[i] = live[--nlive];
+}
+
+static int live_alloc(int size) {
+    if (nlive == MAX_LIVE) return 0;
+    uint8_t *p = kmalloc(size);
+    if (!p) return 0;
+    CHECK(p >= region && p + size <= region + REGION_SIZE, "block outside the region");
+    live_t *l = &live[nlive++];
+    l->ptr = p;
+    l->size = size;
+    l->tag = (uint8_t)rng_next();
+    memset(p, l->tag, size);
+    return 1;
+}
+
+static void test_stress(void) {
+    heap_init_region(region, REGION_SIZE);
+    nlive = 0;
+    for (int op = 0; op < 200000; ++op) {
+        if (nlive && (rng_next() & 1)) live_free(rng_next() % nlive);
+        else live_alloc(rng_range(1, rng_next() % 8 ? 256 : 8192));
+    }
+    while (nlive) live_free(nlive - 1);
+    expect_pristine("after stress run");
+}
+
+static void test_histogram(void) {
+    heap_init_region(region, REGION_SIZE);
+    // Free holes of 8, 40 and 3000 bytes between live blocks, then the tail
+    void *keep[3], *hole[3];
+    static const int hole_size[3] = { 8, 40, 3000 };
+    for (int i = 0; i < 3; ++i) {
+        hole[i] = kmalloc(hole_size[i]);
+        keep[i] = kmalloc(8);
+    }
+    for (int i = 0; i < 3; ++i) kfree(hole[i]);
+    heap_stats_t st;
+    heap_get_stats(&st);
+    CHECK(st.free_hist[0] == 1 && st.free_hist[2] == 1 && st.free_hist[8] == 1,
+          "buckets 0/2/8 hold %d/%d/%d, want 1/1/1", st.free_hist[0], st.free_hist[2], st.free_hist[8]);
+    CHECK(st.free_hist[HEAP_HIST_BUCKETS - 1] == 1, "tail block not in the last bucket");
+    int sum = 0;
+    for (int i = 0; i < HEAP_HIST_BUCKETS; ++i) sum += st.free_hist[i];
+    CHECK(sum == st.free_blocks, "histogram counts %d of %d free blocks", sum, st.free_blocks);
+    for (int i = 0; i < 3; ++i) kfree(keep[i]);
+    expect_pristine("after histogram test");
+}
+
+#if CONFIG_HEAP_TRACK
+// Two distinct call sites: noipa stops identical-code folding from merging
+// them, the barrier keeps the calls from becoming tail jumps
+__attribute__((noipa)) static void *alloc_site_a(int size) {
+    void *p = kmalloc(size);
+    asm volatile ("" : : "r"(p) : "memory");
+    return p;
+}
+
+__attribute__((noipa)) static void *alloc_site_b(int size) {
+    void *p = kmalloc(size);
+    asm volatile ("" : : "r"(p) : "memory");
+    return p;
+}
+
+static void test_tracking(void) {
+    heap_init_region(region, REGION_SIZE);
+    heap_track_stats_t ts;
+    heap_site_t sites[4];
+    void *a[3], *b = alloc_site_b(5000);
+    for (int i = 0; i < 3; ++i) a[i] = alloc_site_a(100);
+    int n = heap_track_sites(sites, 4);
+    CHECK(n == 2, "%d call sites, want 2", n);
+    CHECK(sites[0].count == 1 && sites[0].bytes == 5000, "largest site %u allocs %u bytes", sites[0].count, sites[0].bytes);
+    CHECK(sites[1].count == 3 && sites[1].bytes == 300, "second site %u allocs %u bytes", sites[1].count, sites[1].bytes);
+    CHECK(sites[0].caller && sites[1].caller && sites[0].caller != sites[1].caller, "call sites not told apart");
+    heap_track_stats(&ts);
+    CHECK(ts.live_allocs == 4 && ts.live_bytes == 5300 && ts.allocs == 4, "live %u allocs %u bytes", ts.live_allocs, ts.live_bytes);
+    CHECK(ts.peak_used >= 5300 + 4 * 12, "peak %u below what is in use", ts.peak_used);
+
+    // A new generation only reports what is allocated after it
+    heap_track_mark();
+    void *c = alloc_site_a(64);
+    n = heap_track_sites(sites, 4);
+    CHECK(n == 1 && sites[0].count == 1 && sites[0].bytes == 64, "after mark: %d sites", n);
+
+    kfree((uint8_t *)a[1] + 8);
+    heap_track_stats(&ts);
+    CHECK(ts.bad_frees == 1 && ts.live_allocs == 5, "bad free: %u counted, %u live", ts.bad_frees, ts.live_allocs);
+    CHECK(kmalloc(2 * REGION_SIZE) == NULL, "oversized allocation succeeded");
+    heap_track_stats(&ts);
+    CHECK(ts.failed == 1 && ts.failed_size == 2 * REGION_SIZE && ts.failed_caller, "failure not recorded");
+
+    uint32_t peak = ts.peak_used;
+    kfree(b);
+    kfree(c);
+    for (int i = 0; i < 3; ++i) kfree(a[i]);
+    heap_track_stats(&ts);
+    CHECK(ts.live_allocs == 0 && ts.live_bytes == 0 && ts.frees == 5, "%u still live", ts.live_allocs);
+    CHECK(ts.peak_used == peak, "peak dropped");
+    expect_pristine("after tracking test");
+
+    // More live allocations than the table holds, freed in random order:
+    // the overflow is counted, and deletion keeps every probe chain intact
+    static void *many[3000];
+    for (int i = 0; i < 3000; ++i) many[i] = kmalloc(8);
+    heap_track_stats(&ts);
+    CHECK(ts.untracked > 0 && ts.live_allocs == 3000, "%u untracked of %u", ts.untracked, ts.live_allocs);
+    for (int i = 2999; i > 0; --i) {
+        int j = rng_next() % (i + 1);
+        void *t = many[i];
+        many[i] = many[j];
+        many[j] = t;
+    }
+    for (int i = 0; i < 3000; ++i) kfree(many[i]);
+    heap_track_stats(&ts);
+    CHECK(ts.untracked == 0 && ts.live_allocs == 0 && ts.bad_frees == 1, "after overflow: %u untracked, %u live, %u bad",
+          ts.untracked, ts.live_allocs, ts.bad_frees);
+    CHECK(heap_track_sites(sites, 4) == 0, "sites left after freeing everything");
+    expect_pristine("after table overflow");
+}
+#endif
+
+// --- Throughput ---
+
+static int size_small(void) { return rng_range(8, 64); }
+static int size_mixed(void) { // mostly small, occasionally large
+    uint32_t r = rng_next() % 100;
+    if (r < 70) return rng_range(8, 128);
+    if (r < 95) return rng_range(129, 1024);
+    return rng_range(1025, 8192);
+}
+static int size_large(void) { return rng_range(2048, 8192); }
+
+static const struct {
+    const char *name;
+    int (*size)(void);
+} dists[] = {
+    { "small", size_small },
+    { "mixed", size_mixed },
+    { "large", size_large },
+};
+
+static void bench_dist(int d, int target_live) {
+    heap_init_region(region, REGION_SIZE);
+    nlive = 0;
+    // Warm up to the target working set, then churn at steady state
+    while (nlive < target_live && live_alloc(dists[d].size())) {}
+    const int ops = 400000;
+    int failed = 0;
+    uint64_t t0 = now_ns();
+    for (int op = 0; op < ops; ++op) {
+        if (nlive >= target_live || (nlive && (rng_next() & 1))) {
+            int i = rng_next() % nlive;
+            kfree(live[i].ptr);
+            live[i] = live[--nlive];
+        } else {
+            uint8_t *p = kmalloc(dists[d].size());
+            if (!p) { failed++; continue; }
+            live[nlive].ptr = p;
+            live[nlive].size = 0; // contents not checked when timing
+            nlive++;
+        }
+    }
+    uint64_t ns = now_ns() - t0;
+    heap_stats_t st;
+    heap_get_stats(&st);
+    int frag = st.free_bytes ? 100 - (int)(100LL * st.largest_free / st.free_bytes) : 0;
+    printf("heap %-5s live<=%-4d %7.1f ns/op  failed %5.2f%%  free blocks %4d  frag %3d%%\n",
+           dists[d].name, target_live, (double)ns / ops, 100.0 * failed / ops, st.free_blocks, frag);
+    while (nlive) kfree(live[--nlive].ptr);
+}
+
+// Fragmentation over time under the mixed distribution
+static void bench_frag_timeline(void) {
+    heap_init_region(region, REGION_SIZE);
+    nlive = 0;
+    printf("heap fragmentation over time (mixed, live<=256):\n");
+    for (int op = 1; op <= 200000; ++op) {
+        if (nlive >= 256 || (nlive && (rng_next() & 1))) live_free(rng_next() % nlive);
+        else live_alloc(size_mixed());
+        if (op % 25000 == 0) {
+            heap_stats_t st;
+            heap_get_stats(&st);
+            printf("  ops %6d  live %4d  used %6d  free %6d  largest %6d  free blocks %4d\n",
+                   op, nlive, st.used_bytes, st.free_bytes, st.largest_free, st.free_blocks);
+        }
+    }
+    while (nlive) live_free(nlive - 1);
+}
+
+int main(int argc, char **argv) {
+    int bench;
+    if (!parse_args(argc, argv, &bench)) return 2;
+    test_unit();
+    test_stress();
+    test_histogram();
+#if CONFIG_HEAP_TRACK
+    test_tracking();
+#endif
+    if (bench) {
+        for (unsigned d = 0; d < sizeof(dists) / sizeof(dists[0]); ++d) {
+            bench_dist(d, 16);
+            bench_dist(d, 256);
+        }
+        bench_frag_timeline();
+    }
+    return report_result(TEST_NAME);
+}
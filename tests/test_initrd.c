@@ -0,0 +1,136 @@
+// Host-side checks for src/initrd.c: cpio (newc) and ustar archives built
+// in memory, path lookup and normalisation, directory listing, zero-copy
+// bodies, malformed input, and (--bench) hashed lookup cost.
+#include "initrd.h"
+#include "heap.h"
+#include "host_test.h"
+
+static uint8_t heap_mem[1 << 20];
+static uint8_t image[1 << 20];
+static uint32_t image_len;
+
+static void cpio_add(const char *name, int dir, const char *body) {
+    uint32_t namesize = strlen(name) + 1, size = body ? strlen(body) : 0;
+    image_len += sprintf((char *)image + image_len,
+                         "070701%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X%08X",
+                         0, dir ? 040755 : 0100644, 0, 0, 1, 0, size, 0, 0, 0, 0, namesize, 0);
+    memcpy(image + image_len, name, namesize);
+    image_len = (image_len + namesize + 3) & ~3u;
+    if (size) memcpy(image + image_len, body, size);
+    image_len = (image_len + size + 3) & ~3u;
+}
+
+static void tar_add(const char *prefix, const char *name, int dir, const char *body) {
+    uint8_t *h = image + image_len;
+    uint32_t size = body ? strlen(body) : 0;
+    memset(h, 0, 512);
+    strcpy((char *)h, name);
+    sprintf((char *)h + 124, "%011o", size);
+    h[156] = dir ? '5' : '0';
+    memcpy(h + 257, "ustar", 6);
+    if (prefix) strcpy((char *)h + 345, prefix);
+    image_len += 512;
+    memcpy(image + image_len, body ? body : "", size);
+    image_len += (size + 511) & ~511u;
+}
+
+static int listed;
+static void count_child(const initrd_file_t *f, void *ctx) {
+    (void)f;
+    (void)ctx;
+    listed++;
+}
+
+static void reset(void) {
+    heap_init_region(heap_mem, sizeof(heap_mem));
+    memset(image, 0, sizeof(image));
+    image_len = 0;
+}
+
+static void test_cpio(void) {
+    reset();
+    cpio_add(".", 1, NULL);
+    cpio_add("./etc", 1, NULL);
+    cpio_add("./etc/motd", 0, "hello\n");
+    cpio_add("./bin", 1, NULL);
+    cpio_add("./bin/hello", 0, "\x7f" "ELF");
+    cpio_add("./README", 0, "top level");
+    cpio_add("TRAILER!!!", 0, NULL);
+    CHECK(initrd_init(image, image_len) == 5, "cpio entries %d", initrd_count());
+    CHECK(!strcmp(initrd_format(), "cpio"), "format");
+    const initrd_file_t *f = initrd_lookup("/etc/motd");
+    CHECK(f && f->size == 6 && !memcmp(f->data, "hello\n", 6), "etc/motd body");
+    CHECK(f && f->data > image && f->data < image + image_len, "body not served in place");
+    CHECK(initrd_lookup("etc/motd") == f && initrd_lookup("./etc/motd") == f, "path forms");
+    CHECK(initrd_lookup("etc")->is_dir, "etc is a directory");
+    CHECK(!initrd_lookup("etc/mot") && !initrd_lookup("motd"), "partial names must miss");
+    listed = 0;
+    CHECK(initrd_list("/", count_child, NULL) == 3 && listed == 3, "root children");
+    CHECK(initrd_list("bin", count_child, NULL) == 1, "bin children");
+    CHECK(initrd_list("nope", count_child, NULL) == -1, "missing dir");
+    CHECK(initrd_list("README", count_child, NULL) == -1, "file is not a dir");
+
+    // No trailer, or a body running past the end
+    CHECK(initrd_init(image, image_len - 120) == -1, "truncated cpio accepted");
+    // Sizes that make `offset + size` wrap past zero
+    memcpy(image + 94, "FFFFFFF8", 8);
+    CHECK(initrd_init(image, image_len) == -1, "wrapping name size accepted");
+    memcpy(image + 94, "00000002", 8);
+    memcpy(image + 54, "FFFFFFFC", 8);
+    CHECK(initrd_init(image, image_len) == -1, "wrapping file size accepted");
+}
+
+static void test_tar(void) {
+    reset();
+    tar_add(NULL, "etc/", 1, NULL);
+    tar_add(NULL, "etc/motd", 0, "from tar");
+    tar_add("very/long", "path/file.txt", 0, "split name");
+    image_len += 1024; // two zero blocks
+    CHECK(initrd_init(image, image_len) == 3, "tar entries");
+    CHECK(!strcmp(initrd_format(), "tar"), "format");
+    const initrd_file_t *f = initrd_lookup("etc/motd");
+    CHECK(f && f->size == 8 && !memcmp(f->data, "from tar", 8), "tar body");
+    f = initrd_lookup("very/long/path/file.txt");
+    CHECK(f && f->size == 10, "prefix+name path");
+    CHECK(initrd_list("etc", count_child, NULL) == 1, "etc children");
+    CHECK(initrd_list("very/long/path", count_child, NULL) == 1, "implicit directory");
+
+    reset();
+    memcpy(image, "not an archive", 15);
+    CHECK(initrd_init(image, 4096) == -1 && !initrd_format(), "garbage accepted");
+}
+
+static void bench_lookup(void) {
+    reset();
+    char name[32];
+    const int n = 2000;
+    for (int i = 0; i < n; ++i) {
+        sprintf(name, "./data/f%05d", i);
+        cpio_add(name, 0, "x");
+    }
+    cpio_add("TRAILER!!!", 0, NULL);
+    uint64_t t0 = now_ns();
+    int got = initrd_init(image, image_len);
+    uint64_t index_ns = now_ns() - t0;
+    CHECK(got == n, "bench entries %d", got);
+    const int ops = 200000;
+    int hits = 0;
+    t0 = now_ns();
+    for (int i = 0; i < ops; ++i) {
+        sprintf(name, "data/f%05d", rng_range(0, n - 1));
+        hits += initrd_lookup(name) != NULL;
+    }
+    uint64_t ns = now_ns() - t0;
+    CHECK(hits == ops, "bench misses");
+    printf("initrd index %d files  %9.1f us, lookup %6.1f ns (incl. sprintf)\n",
+           n, index_ns / 1000.0, (double)ns / ops);
+}
+
+int main(int argc, char **argv) {
+    int bench;
+    if (!parse_args(argc, argv, &bench)) return 2;
+    test_cpio();
+    test_tar();
+    if (bench) bench_lookup();
+    return report_result("test_initrd");
+}
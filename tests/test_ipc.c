@@ -0,0 +1,177 @@
+// Host-side checks for src/ipc.c with the scheduler stubbed out: ring
+// order and wraparound, full/empty edges, direct wakeups of a parked peer,
+// blocking send/receive handing off to the peer, and page ownership rules.
+// --bench times the lock-free fast path.
+#include "ipc.h"
+#include "pmm.h"
+#include "host_test.h"
+
+// --- Scheduler and PMM stubs ---
+static task_t task_a = { .id = 1, .state = TASK_READY }, task_b = { .id = 2, .state = TASK_READY };
+static task_t *current = &task_a;
+static task_t *woken, *switched_to;
+static int switches;
+static void (*peer_runs)(void); // what the peer does when handed the CPU
+static uint32_t next_page = 0x400000;
+
+task_t *get_current_task(void) { return current; }
+void task_wake(task_t *t) {
+    woken = t;
+    t->state = TASK_READY;
+}
+void task_switch_to(task_t *t) {
+    switched_to = t;
+    switches++;
+    task_t *self = current;
+    current = t ? t : (self == &task_a ? &task_b : &task_a);
+    if (peer_runs) peer_runs();
+    current = self;
+    CHECK(self->state == TASK_READY, "parked task resumed without a wakeup");
+}
+void *alloc_page(void) {
+    next_page += PMM_PAGE_SIZE;
+    return (void *)(uintptr_t)next_page;
+}
+void free_page(void *addr) { (void)addr; }
+void async_event_signal(async_event_t *ev) { ev->head = NULL; }
+
+static ipc_chan_t chan;
+
+static void test_ring(void) {
+    ipc_chan_init(&chan);
+    chan.head = chan.tail = 0xFFFFFFF0u; // indices wrap mid-test
+    ipc_msg_t m = {0}, out;
+    for (uint32_t round = 0; round < 5; ++round) {
+        for (uint32_t i = 0; i < IPC_RING_SLOTS; ++i) {
+            m.tag = round * 1000 + i;
+            CHECK(ipc_try_send(&chan, &m), "send %u/%u into non-full ring", round, i);
+        }
+        CHECK(!ipc_try_send(&chan, &m), "send into full ring");
+        for (uint32_t i = 0; i < IPC_RING_SLOTS; ++i)
+            CHECK(ipc_try_recv(&chan, &out) && out.tag == round * 1000 + i, "FIFO order %u/%u", round, i);
+        CHECK(!ipc_try_recv(&chan, &out), "receive from empty ring");
+    }
+    // Interleaved, never more than a few in flight
+    uint32_t sent = 0, recvd = 0;
+    for (int i = 0; i < 10000; ++i) {
+        if (rng_next() & 1) {
+            m.tag = sent;
+            sent += ipc_try_send(&chan, &m);
+        } else if (ipc_try_recv(&chan, &out)) {
+            CHECK(out.tag == recvd, "interleaved order: got %u want %u", out.tag, recvd);
+            recvd++;
+        }
+    }
+    while (ipc_try_recv(&chan, &out)) CHECK(out.tag == recvd++, "drain order");
+    CHECK(sent == recvd, "lost messages: %u sent %u received", sent, recvd);
+}
+
+static void test_wakeups(void) {
+    ipc_msg_t m = { .tag = 7 }, out;
+    ipc_chan_init(&chan);
+    woken = NULL;
+    chan.consumer_waiting = &task_b;
+    task_b.state = TASK_BLOCKED;
+    ipc_try_send(&chan, &m);
+    CHECK(woken == &task_b && task_b.state == TASK_READY && !chan.consumer_waiting, "consumer not woken");
+    woken = NULL;
+    ipc_try_send(&chan, &m);
+    CHECK(!woken, "wakeup without a parked consumer");
+    chan.producer_waiting = &task_a;
+    ipc_try_recv(&chan, &out);
+    CHECK(woken == &task_a && !chan.producer_waiting, "producer not woken");
+}
+
+// The peer (task B) produces one message when it gets the CPU
+static void peer_sends(void) {
+    ipc_msg_t m = { .tag = 42 };
+    ipc_send(&chan, &m);
+}
+
+// The peer (task B) drains the ring
+static void peer_drains(void) {
+    ipc_msg_t out;
+    while (ipc_try_recv(&chan, &out)) {}
+}
+
+static void test_blocking(void) {
+    ipc_chan_init(&chan);
+    ipc_msg_t out = {0};
+    chan.producer = &task_b;
+    peer_runs = peer_sends;
+    switches = 0;
+    ipc_recv(&chan, &out);
+    CHECK(out.tag == 42 && chan.recv_blocks == 1, "blocking receive: tag %u blocks %u", out.tag, chan.recv_blocks);
+    CHECK(switches == 1 && switched_to == &task_b, "receiver should hand off to the producer");
+
+    ipc_chan_init(&chan);
+    ipc_msg_t m = { .tag = 1 };
+    for (int i = 0; i < IPC_RING_SLOTS; ++i) ipc_try_send(&chan, &m);
+    chan.consumer = &task_b;
+    peer_runs = peer_drains;
+    switches = 0;
+    ipc_send(&chan, &m);
+    CHECK(switches == 1 && switched_to == &task_b && chan.send_blocks == 1, "sender should block once");
+    CHECK(ipc_try_recv(&chan, &out) && !ipc_try_recv(&chan, &out), "blocked message delivered once");
+    peer_runs = NULL;
+}
+
+static void test_pages(void) {
+    ipc_chan_init(&chan);
+    current = &task_a;
+    void *page = ipc_page_alloc();
+    CHECK(page != NULL, "page alloc");
+    current = &task_b;
+    CHECK(ipc_send_page(&chan, page, 100, 0) == -1, "send of a page owned by another task");
+    CHECK(ipc_page_free(page) == -1, "free of a page owned by another task");
+    current = &task_a;
+    CHECK(ipc_send_page(&chan, page, PMM_PAGE_SIZE + 1, 0) == -1, "oversized length");
+    CHECK(ipc_send_page(&chan, page, 100, 5) == 0, "send of own page");
+    CHECK(ipc_page_free(page) == -1 && ipc_send_page(&chan, page, 1, 0) == -1, "sender kept the page");
+    current = &task_b;
+    uint32_t len = 0, tag = 0;
+    void *got = ipc_recv_page(&chan, &len, &tag);
+    CHECK(got == page && len == 100 && tag == 5, "page message");
+    ipc_msg_t fake = { .tag = IPC_MSG_PAGE, .data = { (uint32_t)(uintptr_t)page, 1, 0 } };
+    CHECK(!ipc_take_page(&fake), "page taken twice");
+    ipc_msg_t plain = { .tag = 3 };
+    ipc_try_send(&chan, &plain);
+    CHECK(!ipc_recv_page(&chan, &len, &tag), "plain message returned as a page");
+    current = &task_a;
+    CHECK(ipc_page_free(page) == -1, "old owner freed a transferred page");
+    current = &task_b;
+    CHECK(ipc_page_free(page) == 0, "new owner free");
+    current = &task_a;
+}
+
+static void bench_ring(void) {
+    const int ops = 20000000;
+    ipc_msg_t m = {0}, out;
+    ipc_chan_init(&chan);
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < ops; ++i) {
+        m.tag = i;
+        ipc_try_send(&chan, &m);
+        ipc_try_recv(&chan, &out);
+    }
+    uint64_t t1 = now_ns();
+    for (int i = 0; i < ops / IPC_RING_SLOTS; ++i) {
+        for (int k = 0; k < IPC_RING_SLOTS; ++k) ipc_try_send(&chan, &m);
+        for (int k = 0; k < IPC_RING_SLOTS; ++k) ipc_try_recv(&chan, &out);
+    }
+    uint64_t t2 = now_ns();
+    CHECK(out.tag == (uint32_t)ops - 1, "last message %u", out.tag);
+    printf("ipc send+recv, 1 in flight:  %5.2f ns\n", (double)(t1 - t0) / ops);
+    printf("ipc send+recv, ring batches: %5.2f ns\n", (double)(t2 - t1) / (ops / IPC_RING_SLOTS * IPC_RING_SLOTS));
+}
+
+int main(int argc, char **argv) {
+    int bench;
+    if (!parse_args(argc, argv, &bench)) return 2;
+    test_ring();
+    test_wakeups();
+    test_blocking();
+    test_pages();
+    if (bench) bench_ring();
+    return report_result("test_ipc");
+}
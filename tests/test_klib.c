@@ -0,0 +1,186 @@
+// Host-side checks for src/klib.c: every memcpy/memset variant plus the
+// shared helpers against byte-at-a-time references, across alignments and
+// sizes, with guard bytes around the destination.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "klib.h"
+
+#define BUF_SIZE (70 * 1024)
+#define GUARD 64
+
+static unsigned char src_buf[BUF_SIZE + 2 * GUARD];
+static unsigned char dst_buf[BUF_SIZE + 2 * GUARD];
+static unsigned char ref_buf[BUF_SIZE + 2 * GUARD];
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            if (failures++ < 20) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } \
+        } \
+    } while (0)
+
+typedef void *(*copy_fn)(void *, const void *, size_t);
+typedef void *(*set_fn)(void *, int, size_t);
+
+static const struct { const char *name; copy_fn fn; } copies[] = {
+    { "memcpy_byte", memcpy_byte },
+    { "memcpy_rep", memcpy_rep },
+    { "memcpy_erms", memcpy_erms },
+    { "memcpy_sse2", memcpy_sse2 },
+    { "klib_memmove", klib_memmove },
+};
+
+static const struct { const char *name; set_fn fn; } sets[] = {
+    { "memset_byte", memset_byte },
+    { "memset_rep", memset_rep },
+    { "memset_erms", memset_erms },
+    { "memset_sse2", memset_sse2 },
+};
+
+static const size_t sizes[] = {
+    0, 1, 2, 3, 4, 5, 7, 8, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 127, 128,
+    129, 255, 256, 257, 300, 511, 512, 1000, 1024, 4095, 4096, 4097, 4160,
+    8191, 65536 + 3, BUF_SIZE - 16,
+};
+#define NSIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+static void fill_pattern(unsigned char *buf, size_t n, unsigned seed) {
+    for (size_t i = 0; i < n; ++i) buf[i] = (unsigned char)(i * 131 + seed * 7 + (i >> 8));
+}
+
+static void test_copies(void) {
+    fill_pattern(src_buf, sizeof(src_buf), 1);
+    for (size_t v = 0; v < sizeof(copies) / sizeof(copies[0]); ++v) {
+        for (size_t si = 0; si < NSIZES; ++si) {
+            size_t n = sizes[si];
+            for (int sa = 0; sa < 16; ++sa) {
+                for (int da = 0; da < 16; ++da) {
+                    if (n > 4096 && (sa % 5 || da % 7)) continue; // keep big sizes quick
+                    memset(dst_buf, 0xA5, sizeof(dst_buf));
+                    memcpy(ref_buf, dst_buf, sizeof(ref_buf));
+                    memcpy(ref_buf + GUARD + da, src_buf + GUARD + sa, n);
+                    void *ret = copies[v].fn(dst_buf + GUARD + da, src_buf + GUARD + sa, n);
+                    CHECK(ret == dst_buf + GUARD + da, "%s returned wrong pointer", copies[v].name);
+                    CHECK(!memcmp(dst_buf, ref_buf, sizeof(dst_buf)),
+                          "%s n=%zu src+%d dst+%d", copies[v].name, n, sa, da);
+                }
+            }
+        }
+    }
+}
+
+static void test_sets(void) {
+    for (size_t v = 0; v < sizeof(sets) / sizeof(sets[0]); ++v) {
+        for (size_t si = 0; si < NSIZES; ++si) {
+            size_t n = sizes[si];
+            for (int da = 0; da < 16; ++da) {
+                int c = (int)(0x100 + n + da) ^ 0x5A; // high bits must be ignored
+                memset(dst_buf, 0xA5, sizeof(dst_buf));
+                memcpy(ref_buf, dst_buf, sizeof(ref_buf));
+                memset(ref_buf + GUARD + da, c, n);
+                void *ret = sets[v].fn(dst_buf + GUARD + da, c, n);
+                CHECK(ret == dst_buf + GUARD + da, "%s returned wrong pointer", sets[v].name);
+                CHECK(!memcmp(dst_buf, ref_buf, sizeof(dst_buf)),
+                      "%s n=%zu dst+%d c=%#x", sets[v].name, n, da, c);
+            }
+        }
+    }
+}
+
+static void test_memmove_overlap(void) {
+    for (size_t si = 0; si < NSIZES; ++si) {
+        size_t n = sizes[si];
+        if (n > 8192) continue;
+        for (int shift = -9; shift <= 9; ++shift) {
+            fill_pattern(dst_buf, sizeof(dst_buf), (unsigned)n);
+            memcpy(ref_buf, dst_buf, sizeof(ref_buf));
+            unsigned char *base = dst_buf + GUARD + 16, *rbase = ref_buf + GUARD + 16;
+            memmove(rbase + shift, rbase, n);
+            klib_memmove(base + shift, base, n);
+            CHECK(!memcmp(dst_buf, ref_buf, sizeof(dst_buf)), "memmove n=%zu shift=%d", n, shift);
+        }
+    }
+}
+
+static int sign(int x) { return (x > 0) - (x < 0); }
+
+static void test_memcmp(void) {
+    fill_pattern(src_buf, sizeof(src_buf), 3);
+    for (size_t si = 0; si < NSIZES; ++si) {
+        size_t n = sizes[si];
+        if (n > 8192) continue;
+        memcpy(dst_buf, src_buf, n);
+        CHECK(klib_memcmp(dst_buf, src_buf, n) == 0, "memcmp equal n=%zu", n);
+        for (size_t pos = 0; pos < n; pos += (n / 7) + 1) {
+            memcpy(dst_buf, src_buf, n);
+            dst_buf[pos] = (unsigned char)(src_buf[pos] + 1);
+            CHECK(sign(klib_memcmp(dst_buf, src_buf, n)) == sign(memcmp(dst_buf, src_buf, n)),
+                  "memcmp sign n=%zu pos=%zu", n, pos);
+            CHECK(sign(klib_memcmp(src_buf, dst_buf, n)) == sign(memcmp(src_buf, dst_buf, n)),
+                  "memcmp reverse sign n=%zu pos=%zu", n, pos);
+        }
+    }
+}
+
+static void test_strings(void) {
+    char buf[600];
+    for (int align = 0; align < 8; ++align) {
+        for (int len = 0; len < 300; ++len) {
+            char *s = buf + align;
+            memset(buf, 'x', sizeof(buf));
+            s[len] = 0;
+            CHECK(klib_strlen(s) == (size_t)len, "strlen align=%d len=%d", align, len);
+        }
+    }
+    char dst[64], ref[64];
+    const char *src = "hello, kernel";
+    for (size_t n = 0; n < 40; ++n) {
+        memset(dst, '#', sizeof(dst));
+        memset(ref, '#', sizeof(ref));
+        strncpy(ref, src, n);
+        klib_strncpy(dst, src, n);
+        CHECK(!memcmp(dst, ref, sizeof(dst)), "strncpy n=%zu", n);
+    }
+    CHECK(klib_strcmp("abc", "abc") == 0, "strcmp equal");
+    CHECK(klib_strcmp("abc", "abd") < 0, "strcmp less");
+    CHECK(klib_strcmp("abd", "abc") > 0, "strcmp greater");
+    CHECK(klib_strcmp("ab", "abc") < 0, "strcmp prefix");
+    CHECK(klib_strcmp("\xff", "a") > 0, "strcmp unsigned");
+}
+
+static void test_memzero_nt(void) {
+    for (size_t n = 64; n <= 3 * 4096; n += 64 * 7) {
+        memset(dst_buf, 0xA5, sizeof(dst_buf));
+        memcpy(ref_buf, dst_buf, sizeof(ref_buf));
+        unsigned char *d = dst_buf + GUARD; // GUARD keeps 16-byte alignment
+        memset(ref_buf + GUARD, 0, n);
+        memzero_nt_sse2(d, n);
+        CHECK(!memcmp(dst_buf, ref_buf, sizeof(dst_buf)), "memzero_nt_sse2 n=%zu", n);
+    }
+}
+
+static void test_strtoul(void) {
+    char *end;
+    CHECK(klib_strtoul("1234", &end, 10) == 1234 && *end == 0, "strtoul decimal");
+    CHECK(klib_strtoul("  42 rest", &end, 0) == 42 && *end == ' ', "strtoul stops at space");
+    CHECK(klib_strtoul("0x1fZ", &end, 0) == 0x1f && *end == 'Z', "strtoul hex prefix");
+    CHECK(klib_strtoul("ff", NULL, 16) == 0xff, "strtoul base 16");
+    CHECK(klib_strtoul("19", &end, 8) == 1 && *end == '9', "strtoul base 8");
+}
+
+int main(void) {
+    test_copies();
+    test_sets();
+    test_memmove_overlap();
+    test_memcmp();
+    test_strings();
+    test_memzero_nt();
+    test_strtoul();
+    if (failures) {
+        printf("test_klib: %d failures\n", failures);
+        return 1;
+    }
+    printf("test_klib: all tests passed\n");
+    return 0;
+}
@@ -0,0 +1,285 @@
+// Host-side checks for src/pmm.c with physical memory backed by a malloc'd
+// arena: bitmap allocation, exhaustion, the pre-zeroed pool (which only
+// hands out identity-mapped pages), frames from
+// regions beyond the bitmap, a randomized stress run, and (--bench)
+// alloc/free cost at several fill levels.
+#include <stdlib.h>
+#include "pmm.h"
+#include "heap.h"
+#include "paging.h"
+#include "host_test.h"
+
+uint8_t *pmm_host_base;
+
+#define FIRST_FREE ((KERNEL_HEAP_START + KERNEL_HEAP_SIZE) / PMM_PAGE_SIZE)
+#define USABLE_PAGES (PMM_NUM_PAGES - FIRST_FREE)
+#define HIGH_FRAMES 256 // arena pages past the bitmap, for pmm_add_region
+
+static uint8_t owned[PMM_NUM_PAGES];
+static uintptr_t held[PMM_NUM_PAGES];
+
+static int page_index(void *page) {
+    return (int)((uintptr_t)page / PMM_PAGE_SIZE);
+}
+
+static int page_is_zero(void *page) {
+    const uint8_t *p = PHYS_TO_VIRT(page);
+    for (int i = 0; i < PMM_PAGE_SIZE; ++i)
+        if (p[i]) return 0;
+    return 1;
+}
+
+static void test_unit(void) {
+    pmm_init();
+    void *a = alloc_page();
+    CHECK(page_index(a) == FIRST_FREE, "first page %d, want %d", page_index(a), FIRST_FREE);
+    void *b = alloc_page();
+    CHECK(page_index(b) == FIRST_FREE + 1, "second page not adjacent");
+    free_page(a);
+    CHECK(alloc_page() == a, "freed page not handed out again");
+    free_page(a);
+    free_page(b);
+
+    // Exhaust memory: every usable page exactly once, then failure
+    int n = 0;
+    void *p;
+    memset(owned, 0, sizeof(owned));
+    while ((p = alloc_page())) {
+        int i = page_index(p);
+        CHECK(i >= FIRST_FREE && i < PMM_NUM_PAGES, "page %d out of range", i);
+        CHECK(!owned[i], "page %d handed out twice", i);
+        owned[i] = 1;
+        held[n++] = (uintptr_t)p;
+    }
+    CHECK(n == USABLE_PAGES, "%d pages allocated, want %d", n, USABLE_PAGES);
+    CHECK(alloc_zeroed_page() == NULL, "zeroed allocation from an empty PMM");
+    while (n) free_page((void *)held[--n]);
+    CHECK(page_index(alloc_page()) == FIRST_FREE, "memory not fully returned");
+    pmm_init();
+}
+
+static void test_zpool(void) {
+    pmm_init();
+    memset(pmm_host_base, 0xAA, PMM_TOTAL_MEM); // every page starts dirty
+    CHECK(!pmm_zpool_set_watermarks(8, 4), "high < low accepted");
+    CHECK(!pmm_zpool_set_watermarks(0, 100000), "high above pool size accepted");
+    CHECK(pmm_zpool_set_watermarks(4, 8), "valid watermarks rejected");
+
+    // Empty pool: synchronous zeroing, counted as a miss, triggers a refill
+    void *p = alloc_zeroed_page();
+    CHECK(p && page_is_zero(p), "miss path returned a dirty page");
+    CHECK(pmm_zpool_needs_refill(), "miss did not request a refill");
+    int refills = 0;
+    while (pmm_zpool_refill()) refills++;
+    CHECK(refills == 8, "refilled %d pages, want 8", refills);
+    CHECK(!pmm_zpool_needs_refill(), "refill still requested at high watermark");
+
+    pmm_zpool_stats_t st;
+    for (int i = 0; i < 5; ++i) {
+        void *z = alloc_zeroed_page();
+        CHECK(z && page_is_zero(z), "pooled page not zero");
+        memset(PHYS_TO_VIRT(z), 0x55, PMM_PAGE_SIZE);
+        free_page(z);
+    }
+    pmm_zpool_stats(&st);
+    CHECK(st.hits == 5 && st.misses == 1, "hits %u misses %u, want 5/1", st.hits, st.misses);
+    CHECK(st.count == 3, "pool holds %d, want 3", st.count);
+    CHECK(pmm_zpool_needs_refill(), "below low watermark without refill request");
+
+    // Lowering the high watermark returns the surplus to the PMM
+    while (pmm_zpool_refill()) {}
+    CHECK(pmm_zpool_set_watermarks(0, 2), "valid watermarks rejected");
+    pmm_zpool_stats(&st);
+    CHECK(st.count == 2, "pool holds %d after shrinking, want 2", st.count);
+    while (st.count) {
+        free_page(alloc_zeroed_page());
+        pmm_zpool_stats(&st);
+    }
+    pmm_zpool_set_watermarks(16, 64);
+
+    // Low memory used up: zeroed allocations fail rather than write to
+    // pages above the identity map, which the kernel cannot reach
+    pmm_init();
+    int n = 0;
+    while ((p = alloc_page()) && (uintptr_t)p < IDENTITY_MAP_END) held[n++] = (uintptr_t)p;
+    CHECK(p, "no pages above the identity map");
+    uint8_t *above = PHYS_TO_VIRT(p);
+    free_page(p);
+    memset(above, 0xAA, PMM_PAGE_SIZE);
+    CHECK(alloc_zeroed_page() == NULL, "zeroed page handed out past the identity map");
+    CHECK(!pmm_zpool_refill() && !pmm_zpool_needs_refill(), "pool refilled past the identity map");
+    CHECK(above[0] == 0xAA && above[PMM_PAGE_SIZE - 1] == 0xAA, "page above the identity map was written");
+    CHECK(alloc_page() == p, "rejected page not returned to the bitmap");
+    free_page(p);
+    while (n) free_page((void *)held[--n]);
+    pmm_init();
+}
+
+static int frame_is_zero(uint64_t pa) {
+    return page_is_zero((void *)(uintptr_t)pa);
+}
+
+static void test_high(void) {
+    pmm_init();
+    uint32_t total, avail;
+    // Clamped to the end of the bitmap and trimmed to whole pages
+    CHECK(pmm_add_region(PMM_TOTAL_MEM - 2 * PMM_PAGE_SIZE, 6 * PMM_PAGE_SIZE + 100), "region rejected");
+    CHECK(pmm_add_region(0, PMM_TOTAL_MEM), "region inside the bitmap rejected");
+    pmm_high_stats(&total, &avail);
+    CHECK(total == 4 && avail == 4, "%u/%u high frames, want 4/4", avail, total);
+
+    uint64_t f[5];
+    for (int i = 0; i < 4; ++i) {
+        f[i] = pmm_alloc_frame();
+        CHECK(f[i] >= PMM_TOTAL_MEM && f[i] < PMM_TOTAL_MEM + 4 * PMM_PAGE_SIZE && !(f[i] % PMM_PAGE_SIZE),
+              "high frame %d at %#llx", i, (unsigned long long)f[i]);
+        CHECK(frame_is_zero(f[i]), "high frame %d not zeroed", i);
+        for (int j = 0; j < i; ++j) CHECK(f[j] != f[i], "frame %d handed out twice", i);
+        memset(PHYS_TO_VIRT(f[i]), 0xEE, PMM_PAGE_SIZE);
+    }
+    f[4] = pmm_alloc_frame();
+    CHECK(f[4] && f[4] < PMM_TOTAL_MEM && frame_is_zero(f[4]), "no fallback to the bitmap");
+    pmm_high_stats(&total, &avail);
+    CHECK(avail == 0, "%u high frames free after using them all", avail);
+
+    // Freed frames come back last in, first out, zeroed again
+    pmm_free_frame(f[1]);
+    pmm_free_frame(f[3]);
+    pmm_high_stats(&total, &avail);
+    CHECK(avail == 2, "%u high frames free, want 2", avail);
+    uint64_t a = pmm_alloc_frame(), b = pmm_alloc_frame();
+    CHECK(a == f[3] && b == f[1], "free list order");
+    CHECK(frame_is_zero(a) && frame_is_zero(b), "reused frame not zeroed");
+    pmm_free_frame(f[4]);
+    CHECK(alloc_page() == (void *)(uintptr_t)f[4], "low frame not returned to the bitmap");
+
+    // With low memory used up the fallback still finds bitmap frames above
+    // the identity map, zeroed through kmap
+    pmm_init();
+    int n = 0;
+    void *p;
+    while ((p = alloc_page()) && (uintptr_t)p < IDENTITY_MAP_END) held[n++] = (uintptr_t)p;
+    free_page(p);
+    memset(PHYS_TO_VIRT(p), 0xAA, PMM_PAGE_SIZE);
+    uint64_t hi = pmm_alloc_frame();
+    CHECK(hi == (uintptr_t)p && frame_is_zero(hi), "fallback frame %#llx", (unsigned long long)hi);
+    pmm_free_frame(hi);
+    while (n) free_page((void *)held[--n]);
+
+    pmm_init();
+    int added = 0;
+    while (pmm_add_region(PMM_TOTAL_MEM, PMM_PAGE_SIZE)) added++;
+    CHECK(added == PMM_MAX_REGIONS, "%d regions accepted, want %d", added, PMM_MAX_REGIONS);
+
+    // Random alloc/free over one larger region: no frame twice, counts match
+    pmm_init();
+    pmm_add_region(PMM_TOTAL_MEM, HIGH_FRAMES * PMM_PAGE_SIZE);
+    static uint8_t high_owned[HIGH_FRAMES];
+    static uint64_t high_held[HIGH_FRAMES];
+    memset(high_owned, 0, sizeof(high_owned));
+    n = 0;
+    for (int op = 0; op < 100000; ++op) {
+        if (n && (rng_next() % 100 < 48 || n == HIGH_FRAMES)) {
+            int k = rng_next() % n;
+            high_owned[(high_held[k] - PMM_TOTAL_MEM) / PMM_PAGE_SIZE] = 0;
+            pmm_free_frame(high_held[k]);
+            high_held[k] = high_held[--n];
+        } else {
+            uint64_t pa = pmm_alloc_frame();
+            CHECK(pa >= PMM_TOTAL_MEM, "fell back to the bitmap with %d of %d held", n, HIGH_FRAMES);
+            if (pa < PMM_TOTAL_MEM) {
+                free_page((void *)(uintptr_t)pa);
+                continue;
+            }
+            uint32_t i = (uint32_t)((pa - PMM_TOTAL_MEM) / PMM_PAGE_SIZE);
+            CHECK(!high_owned[i], "high frame %u handed out twice", i);
+            high_owned[i] = 1;
+            *(uint64_t *)PHYS_TO_VIRT(pa) = ~0ull; // clobber where the free list link goes
+            high_held[n++] = pa;
+        }
+    }
+    pmm_high_stats(&total, &avail);
+    CHECK(avail == HIGH_FRAMES - (uint32_t)n, "%u free with %d of %d held", avail, n, HIGH_FRAMES);
+    pmm_init();
+}
+
+static void test_stress(void) {
+    pmm_init();
+    memset(owned, 0, sizeof(owned));
+    int n = 0;
+    for (int op = 0; op < 500000; ++op) {
+        if (n && (rng_next() % 100 < 48 || n == PMM_NUM_PAGES)) {
+            int k = rng_next() % n;
+            int i = page_index((void *)held[k]);
+            CHECK(owned[i], "freeing page %d we do not own", i);
+            owned[i] = 0;
+            free_page((void *)held[k]);
+            held[k] = held[--n];
+        } else {
+            void *p = alloc_page();
+            if (!p) {
+                CHECK(n == USABLE_PAGES, "allocation failed with %d pages held", n);
+                continue;
+            }
+            int i = page_index(p);
+            CHECK(!owned[i], "page %d handed out twice", i);
+            owned[i] = 1;
+            held[n++] = (uintptr_t)p;
+        }
+    }
+    while (n) free_page((void *)held[--n]);
+    CHECK(page_index(alloc_page()) == FIRST_FREE, "memory not fully returned");
+    pmm_init();
+}
+
+// alloc/free pairs with `fill` percent of usable memory already allocated
+// from the bottom, which is what the first-fit bitmap scan has to skip
+static void bench_fill(int fill) {
+    pmm_init();
+    int n = 0, target = USABLE_PAGES * fill / 100;
+    while (n < target) held[n++] = (uintptr_t)alloc_page();
+    const int ops = 20000;
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < ops; ++i) free_page(alloc_page());
+    uint64_t ns = now_ns() - t0;
+    printf("pmm fill %3d%%  %9.1f ns per alloc+free\n", fill, (double)ns / ops);
+    while (n) free_page((void *)held[--n]);
+}
+
+static void bench_zeroed(void) {
+    pmm_init();
+    const int ops = 2000;
+    pmm_zpool_set_watermarks(0, 0); // pool off: every call zeroes
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < ops; ++i) free_page(alloc_zeroed_page());
+    uint64_t cold = now_ns() - t0;
+    pmm_zpool_set_watermarks(16, 256);
+    double hit = 0;
+    for (int round = 0; round < ops / 256; ++round) {
+        while (pmm_zpool_refill()) {}
+        t0 = now_ns();
+        for (int i = 0; i < 256; ++i) free_page(alloc_zeroed_page());
+        hit += now_ns() - t0;
+    }
+    printf("pmm zeroed page  %9.1f ns on miss, %9.1f ns from pool\n",
+           (double)cold / ops, hit / (ops / 256 * 256));
+    pmm_zpool_set_watermarks(16, 64);
+}
+
+int main(int argc, char **argv) {
+    int bench;
+    if (!parse_args(argc, argv, &bench)) return 2;
+    pmm_host_base = aligned_alloc(4096, PMM_TOTAL_MEM + HIGH_FRAMES * PMM_PAGE_SIZE);
+    if (!pmm_host_base) return 2;
+    test_unit();
+    test_zpool();
+    test_high();
+    test_stress();
+    if (bench) {
+        static const int fills[] = { 0, 25, 50, 75, 95 };
+        for (unsigned i = 0; i < sizeof(fills) / sizeof(fills[0]); ++i) bench_fill(fills[i]);
+        bench_zeroed();
+    }
+    free(pmm_host_base);
+    return report_result("test_pmm");
+}
@@ -0,0 +1,280 @@
+// Host-side checks for src/ramfs.c and src/vfs.c on the real PMM and heap
+// (physical memory backed by a malloc'd arena): file I/O across page and
+// radix boundaries, sparse files, directories and path errors, unlink of
+// open files, page accounting, running out of identity-mapped memory, a
+// randomized run against shadow buffers,
+// and (--bench) 4 KB read/write throughput and path lookup cost.
+#include "vfs.h"
+#include "ramfs.h"
+#include "pmm.h"
+#include "heap.h"
+#include "paging.h"
+#include "host_test.h"
+
+uint8_t *pmm_host_base;
+static uint8_t heap_mem[1 << 20];
+static uint8_t buf[64 * 1024], ref[64 * 1024];
+
+static uint32_t fs_pages(void) {
+    ramfs_stats_t st;
+    ramfs_stats(&st);
+    return st.pages;
+}
+
+static void fill(uint8_t *p, uint32_t n, uint32_t seed) {
+    for (uint32_t i = 0; i < n; ++i) p[i] = (uint8_t)(i * 7 + seed + (i >> 9));
+}
+
+static void test_file_io(void) {
+    int fd = vfs_open("/hello", VFS_WRITE | VFS_CREATE);
+    CHECK(fd >= 0, "create: %s", vfs_strerror(fd));
+    CHECK(vfs_write(fd, "hello world", 11) == 11, "short write");
+    vfs_close(fd);
+    fd = vfs_open("hello", VFS_READ);
+    char text[32] = {0};
+    CHECK(vfs_read(fd, text, sizeof(text)) == 11 && !strcmp(text, "hello world"), "read back '%s'", text);
+    CHECK(vfs_read(fd, text, sizeof(text)) == 0, "read at EOF");
+    CHECK(vfs_seek(fd, 6, VFS_SEEK_SET) == 6 && vfs_read(fd, text, 5) == 5 && !memcmp(text, "world", 5),
+          "seek+read");
+    CHECK(vfs_seek(fd, -5, VFS_SEEK_END) == 6, "seek from end");
+    CHECK(vfs_seek(fd, -100, VFS_SEEK_CUR) == VFS_EINVAL, "negative position");
+    CHECK(vfs_write(fd, "x", 1) == VFS_EBADF, "write on a read-only descriptor");
+    vfs_close(fd);
+    CHECK(vfs_close(fd) == VFS_EBADF, "double close");
+
+    // Spanning page boundaries, then append and truncate
+    fill(ref, sizeof(ref), 1);
+    fd = vfs_open("/hello", VFS_READ | VFS_WRITE | VFS_TRUNC);
+    CHECK(vfs_write(fd, ref, 10000) == 10000 && vfs_write(fd, ref + 10000, 30000) == 30000, "large writes");
+    vfs_seek(fd, 4090, VFS_SEEK_SET);
+    CHECK(vfs_read(fd, buf, 9000) == 9000 && !memcmp(buf, ref + 4090, 9000), "read across pages");
+    vfs_close(fd);
+    vfs_stat_t st;
+    CHECK(!vfs_stat("/hello", &st) && st.size == 40000 && st.pages == 11, "size %u pages %u", st.size, st.pages);
+    fd = vfs_open("/hello", VFS_WRITE | VFS_APPEND);
+    vfs_write(fd, "!", 1);
+    vfs_close(fd);
+    CHECK(!vfs_stat("/hello", &st) && st.size == 40001, "append");
+    uint32_t before = fs_pages();
+    vfs_close(vfs_open("/hello", VFS_WRITE | VFS_TRUNC));
+    CHECK(!vfs_stat("/hello", &st) && st.size == 0 && fs_pages() == before - 11, "truncate frees pages");
+    CHECK(!vfs_unlink("/hello") && fs_pages() == 0, "unlink");
+}
+
+static void test_sparse(void) {
+    uint32_t far = 5 * 1024 * 1024 + 123; // past one radix node's 4 MB
+    int fd = vfs_open("/sparse", VFS_READ | VFS_WRITE | VFS_CREATE);
+    vfs_write(fd, "head", 4);
+    vfs_seek(fd, far, VFS_SEEK_SET);
+    vfs_write(fd, "tail", 4);
+    vfs_stat_t st;
+    vfs_stat("/sparse", &st);
+    CHECK(st.size == far + 4, "sparse size %u", st.size);
+    CHECK(st.pages == 5, "2 data pages + root + 2 leaf nodes, got %u", st.pages);
+    vfs_seek(fd, 4096 * 3, VFS_SEEK_SET);
+    memset(buf, 0xFF, 8192);
+    CHECK(vfs_read(fd, buf, 8192) == 8192, "hole read");
+    int zero = 1;
+    for (int i = 0; i < 8192; ++i) zero &= buf[i] == 0;
+    CHECK(zero, "hole not zero");
+    vfs_seek(fd, far, VFS_SEEK_SET);
+    CHECK(vfs_read(fd, buf, 10) == 4 && !memcmp(buf, "tail", 4), "tail read");
+    vfs_close(fd);
+    vfs_unlink("/sparse");
+    CHECK(fs_pages() == 0, "sparse file leaked %u pages", fs_pages());
+}
+
+static void test_dirs(void) {
+    CHECK(!vfs_mkdir("/a") && !vfs_mkdir("/a/b") && !vfs_mkdir("a/b/c"), "mkdir");
+    CHECK(vfs_mkdir("/a/b") == VFS_EEXIST, "mkdir existing");
+    CHECK(vfs_mkdir("/x/y") == VFS_ENOENT, "mkdir under missing parent");
+    int fd = vfs_open("/a/b/c/../f", VFS_WRITE | VFS_CREATE);
+    CHECK(fd >= 0, "create via '..'");
+    vfs_close(fd);
+    vfs_stat_t st;
+    CHECK(!vfs_stat("/a/./b//f", &st) && !st.is_dir, "lookup with '.' and '//'");
+    CHECK(vfs_open("/a/b/f/g", VFS_READ) == VFS_ENOTDIR, "path through a file");
+    CHECK(vfs_open("/a/b", VFS_WRITE) == VFS_EISDIR, "write open of a directory");
+    CHECK(vfs_mkdir("/a/0123456789012345678901234567") == VFS_ENAMETOOLONG, "long name");
+    CHECK(vfs_unlink("/a") == VFS_ENOTEMPTY, "rm non-empty dir");
+    CHECK(vfs_unlink("/") == VFS_EINVAL, "rm root");
+
+    fd = vfs_open("/a/b", VFS_READ);
+    vfs_dirent_t e;
+    int seen_c = 0, seen_f = 0, n = 0;
+    while (vfs_readdir(fd, &e) > 0) {
+        n++;
+        seen_c += !strcmp(e.name, "c") && e.is_dir;
+        seen_f += !strcmp(e.name, "f") && !e.is_dir;
+    }
+    vfs_close(fd);
+    CHECK(n == 2 && seen_c && seen_f, "readdir returned %d entries", n);
+    fd = vfs_open("/a/b/f", VFS_READ);
+    CHECK(vfs_readdir(fd, &e) == VFS_ENOTDIR, "readdir on a file");
+    vfs_close(fd);
+
+    CHECK(!vfs_unlink("/a/b/f") && !vfs_unlink("/a/b/c") && !vfs_unlink("/a/b") && !vfs_unlink("/a"), "cleanup");
+    ramfs_stats_t rs;
+    ramfs_stats(&rs);
+    CHECK(rs.inodes == 1 && rs.dentries == 1, "only the root left: %u inodes", rs.inodes);
+}
+
+static void test_open_unlinked(void) {
+    fill(ref, 20000, 9);
+    int fd = vfs_open("/gone", VFS_READ | VFS_WRITE | VFS_CREATE);
+    vfs_write(fd, ref, 20000);
+    CHECK(!vfs_unlink("/gone"), "unlink open file");
+    vfs_stat_t st;
+    CHECK(vfs_stat("/gone", &st) == VFS_ENOENT, "name still visible");
+    CHECK(fs_pages() == 6, "pages released while open"); // 5 data + 1 node
+    vfs_seek(fd, 0, VFS_SEEK_SET);
+    CHECK(vfs_read(fd, buf, 20000) == 20000 && !memcmp(buf, ref, 20000), "data of unlinked file");
+    vfs_close(fd);
+    CHECK(fs_pages() == 0, "pages kept after last close");
+
+    int fds[VFS_MAX_FILES];
+    vfs_close(vfs_open("/f", VFS_WRITE | VFS_CREATE));
+    for (int i = 0; i < VFS_MAX_FILES; ++i) fds[i] = vfs_open("/f", VFS_READ);
+    CHECK(fds[VFS_MAX_FILES - 1] >= 0 && vfs_open("/f", VFS_READ) == VFS_EMFILE, "descriptor limit");
+    for (int i = 0; i < VFS_MAX_FILES; ++i) vfs_close(fds[i]);
+    vfs_unlink("/f");
+}
+
+static void test_dcache(void) {
+    char name[32];
+    vfs_mkdir("/many");
+    for (int i = 0; i < 300; ++i) {
+        sprintf(name, "/many/file%d", i);
+        vfs_close(vfs_open(name, VFS_WRITE | VFS_CREATE));
+    }
+    ramfs_stats_t a, b;
+    ramfs_stats(&a);
+    vfs_stat_t st;
+    for (int i = 0; i < 300; ++i) {
+        sprintf(name, "/many/file%d", i);
+        CHECK(!vfs_stat(name, &st), "lookup %s", name);
+    }
+    ramfs_stats(&b);
+    double probes = (double)(b.probes - a.probes) / (b.lookups - a.lookups);
+    CHECK(probes < 4.0, "%.1f probes per lookup", probes);
+    for (int i = 0; i < 300; ++i) {
+        sprintf(name, "/many/file%d", i);
+        vfs_unlink(name);
+    }
+    CHECK(!vfs_unlink("/many"), "dir should be empty");
+}
+
+#define NFILES 6
+#define MAXSZ (48 * 1024)
+
+static void test_random(void) {
+    static uint8_t shadow[NFILES][MAXSZ];
+    uint32_t size[NFILES] = {0};
+    int fd[NFILES];
+    char name[16];
+    for (int f = 0; f < NFILES; ++f) {
+        sprintf(name, "/r%d", f);
+        fd[f] = vfs_open(name, VFS_READ | VFS_WRITE | VFS_CREATE | VFS_TRUNC);
+        memset(shadow[f], 0, MAXSZ);
+    }
+    for (int op = 0; op < 20000; ++op) {
+        int f = rng_range(0, NFILES - 1);
+        uint32_t off = rng_range(0, MAXSZ - 1), n = rng_range(0, MAXSZ - off);
+        if (n > 9000) n = rng_range(0, 9000);
+        vfs_seek(fd[f], off, VFS_SEEK_SET);
+        switch (rng_range(0, 9)) {
+        case 0: // truncate and reopen
+            vfs_close(fd[f]);
+            sprintf(name, "/r%d", f);
+            fd[f] = vfs_open(name, VFS_READ | VFS_WRITE | VFS_TRUNC);
+            memset(shadow[f], 0, MAXSZ);
+            size[f] = 0;
+            break;
+        case 1: case 2: case 3: case 4: {
+            fill(buf, n, op);
+            CHECK(vfs_write(fd[f], buf, n) == (int)n, "write op %d", op);
+            memcpy(shadow[f] + off, buf, n);
+            if (n && off + n > size[f]) size[f] = off + n;
+            break;
+        }
+        default: {
+            int want = off >= size[f] ? 0 : (int)(off + n > size[f] ? size[f] - off : n);
+            int got = vfs_read(fd[f], buf, n);
+            CHECK(got == want && !memcmp(buf, shadow[f] + off, want), "read op %d off %u n %u", op, off, n);
+        }
+        }
+    }
+    for (int f = 0; f < NFILES; ++f) {
+        vfs_close(fd[f]);
+        sprintf(name, "/r%d", f);
+        vfs_unlink(name);
+    }
+    CHECK(fs_pages() == 0, "random run leaked %u pages", fs_pages());
+}
+
+static void bench_io(void) {
+    const uint32_t total = 8 * 1024 * 1024;
+    fill(buf, 4096, 3);
+    int fd = vfs_open("/bench", VFS_READ | VFS_WRITE | VFS_CREATE);
+    uint64_t t0 = now_ns();
+    for (uint32_t off = 0; off < total; off += 4096) vfs_write(fd, buf, 4096);
+    uint64_t t1 = now_ns();
+    const int passes = 10;
+    for (int p = 0; p < passes; ++p) {
+        vfs_seek(fd, 0, VFS_SEEK_SET);
+        while (vfs_read(fd, buf, 4096) == 4096) {}
+    }
+    uint64_t t2 = now_ns();
+    vfs_close(fd);
+    vfs_unlink("/bench");
+    printf("ramfs append 4k: %7.1f MB/s (allocating pages)\n", total / 1048576.0 / ((t1 - t0) / 1e9));
+    printf("ramfs read 4k:   %7.1f MB/s\n", passes * (total / 1048576.0) / ((t2 - t1) / 1e9));
+
+    vfs_mkdir("/d1");
+    vfs_mkdir("/d1/d2");
+    vfs_mkdir("/d1/d2/d3");
+    vfs_close(vfs_open("/d1/d2/d3/leaf", VFS_WRITE | VFS_CREATE));
+    const int ops = 500000;
+    vfs_stat_t st;
+    t0 = now_ns();
+    for (int i = 0; i < ops; ++i) vfs_stat("/d1/d2/d3/leaf", &st);
+    printf("path lookup, 4 components: %5.1f ns\n", (double)(now_ns() - t0) / ops);
+}
+
+// Filling the fs ends in ENOSPC once memory below the identity map is used
+// up; the pages above it are never written
+static void test_full(void) {
+    uint8_t *high = pmm_host_base + IDENTITY_MAP_END;
+    uint32_t high_len = PMM_TOTAL_MEM - IDENTITY_MAP_END;
+    memset(high, 0xAA, high_len);
+    fill(ref, sizeof(ref), 5);
+    int fd = vfs_open("/big", VFS_WRITE | VFS_CREATE);
+    uint32_t total = 0;
+    int r;
+    while ((r = vfs_write(fd, ref, sizeof(ref))) == (int)sizeof(ref)) total += r;
+    CHECK(r == VFS_ENOSPC || (r >= 0 && r < (int)sizeof(ref)), "write past the end returned %d", r);
+    CHECK(total < IDENTITY_MAP_END, "%u bytes stored below the identity map end", total);
+    vfs_close(fd);
+    int clean = 1;
+    for (uint32_t i = 0; i < high_len && clean; ++i) clean = high[i] == 0xAA;
+    CHECK(clean, "fs wrote to memory above the identity map");
+    CHECK(!vfs_unlink("/big") && fs_pages() == 0, "pages not returned after filling up");
+}
+
+int main(int argc, char **argv) {
+    int bench;
+    if (!parse_args(argc, argv, &bench)) return 2;
+    pmm_host_base = calloc(1, PMM_TOTAL_MEM);
+    pmm_init();
+    heap_init_region(heap_mem, sizeof(heap_mem));
+    CHECK(!vfs_init(), "init");
+    test_file_io();
+    test_sparse();
+    test_dirs();
+    test_open_unlinked();
+    test_dcache();
+    test_full();
+    test_random();
+    if (bench) bench_io();
+    return report_result("test_ramfs");
+}
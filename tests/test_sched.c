@@ -0,0 +1,174 @@
+// Host-side checks for the scheduling policy in src/sched.c on a mock task
+// list: round-robin order, state filtering, idle fallback, EDF ordering of
+// deadline tasks, randomized invariant checks, and (--bench) pick cost
+// with N tasks.
+#include <stdlib.h>
+#include "sched.h"
+#include "host_test.h"
+
+#define MAX_MOCK 4096
+
+static task_t pool[MAX_MOCK];
+
+// Link `n` tasks into a list; task i gets id i
+static task_t *make_list(int n) {
+    memset(pool, 0, sizeof(task_t) * n);
+    for (int i = 0; i < n; ++i) {
+        pool[i].id = i;
+        pool[i].state = TASK_READY;
+        pool[i].next = i + 1 < n ? &pool[i + 1] : NULL;
+    }
+    return &pool[0];
+}
+
+static void test_unit(void) {
+    task_t *head = make_list(4);
+    task_t *idle = &pool[3];
+
+    CHECK(sched_pick(head, NULL, idle) == head, "no current task: start at head");
+    CHECK(sched_pick(head, &pool[0], idle) == &pool[1], "round-robin 0 -> 1");
+    CHECK(sched_pick(head, &pool[1], idle) == &pool[2], "round-robin 1 -> 2");
+    CHECK(sched_pick(head, &pool[2], idle) == &pool[0], "round-robin wraps and skips idle");
+
+    pool[1].state = TASK_SLEEPING;
+    CHECK(sched_pick(head, &pool[0], idle) == &pool[2], "sleeping task skipped");
+    pool[2].state = TASK_BLOCKED;
+    CHECK(sched_pick(head, &pool[0], idle) == &pool[0], "only runnable task keeps the CPU");
+    pool[0].state = TASK_TERMINATED;
+    CHECK(sched_pick(head, &pool[0], idle) == idle, "idle when nothing else is ready");
+    CHECK(sched_pick(head, idle, idle) == idle, "idle keeps running while alone");
+    pool[2].state = TASK_READY;
+    CHECK(sched_pick(head, idle, idle) == &pool[2], "woken task preempts idle");
+
+    idle->state = TASK_BLOCKED;
+    pool[2].state = TASK_BLOCKED;
+    CHECK(sched_pick(head, &pool[0], idle) == &pool[0], "nothing runnable: stay on current");
+    CHECK(sched_pick(head, &pool[0], NULL) == &pool[0], "no idle task registered");
+}
+
+// The kernel's order: deadline class first, then round-robin
+static task_t *pick(task_t *head, task_t *current, task_t *idle) {
+    task_t *t = sched_pick_deadline(head, current);
+    return t ? t : sched_pick(head, current, idle);
+}
+
+static void make_dl(task_t *t, uint32_t abs_deadline) {
+    t->dl_runtime = 1;
+    t->dl_deadline = t->dl_period = 10;
+    t->dl_abs_deadline = abs_deadline;
+}
+
+static void test_edf(void) {
+    task_t *head = make_list(6);
+    task_t *idle = &pool[5];
+    make_dl(&pool[1], 500);
+    make_dl(&pool[3], 300);
+    CHECK(pick(head, &pool[0], idle) == &pool[3], "earliest deadline first");
+    CHECK(pick(head, &pool[3], idle) == &pool[3], "deadline task keeps the CPU");
+    pool[3].dl_throttled = 1;
+    CHECK(pick(head, &pool[3], idle) == &pool[1], "throttled task skipped");
+    pool[1].state = TASK_SLEEPING;
+    CHECK(pick(head, &pool[3], idle) == &pool[4], "best effort once no deadline task can run");
+    CHECK(pick(head, &pool[4], idle) == &pool[0], "round-robin skips the throttled task");
+    pool[1].state = TASK_READY;
+    pool[3].dl_throttled = 0;
+    pool[3].dl_abs_deadline = 500;
+    CHECK(pick(head, &pool[3], idle) == &pool[3], "tie: current keeps the CPU");
+    CHECK(pick(head, &pool[0], idle) == &pool[1], "tie: first in the list");
+    pool[1].dl_abs_deadline = 0xFFFFFFF0u; // before 500 once the tick counter wraps
+    pool[3].dl_abs_deadline = 0x10;
+    CHECK(pick(head, &pool[0], idle) == &pool[1], "deadline compare is wrap-safe");
+    pool[1].state = pool[3].state = TASK_BLOCKED;
+    pool[0].state = pool[2].state = pool[4].state = TASK_TERMINATED;
+    CHECK(pick(head, &pool[0], idle) == idle, "idle when no class has work");
+}
+
+// With random states, the pick must be READY and non-idle whenever such a
+// task exists; with everyone ready, picks must be exactly fair.
+static void test_stress(void) {
+    for (int round = 0; round < 20000; ++round) {
+        int n = rng_range(1, 32);
+        task_t *head = make_list(n);
+        task_t *idle = rng_next() & 1 ? &pool[rng_next() % n] : NULL;
+        int any_ready = 0;
+        for (int i = 0; i < n; ++i) {
+            pool[i].state = (task_state_t)rng_range(TASK_READY, TASK_TERMINATED);
+            if (pool[i].state == TASK_READY && &pool[i] != idle) any_ready = 1;
+        }
+        task_t *cur = &pool[rng_next() % n];
+        task_t *next = sched_pick(head, cur, idle);
+        CHECK(next != NULL, "no task picked");
+        if (any_ready)
+            CHECK(next->state == TASK_READY && next != idle, "round %d: picked %d (state %d) over a ready task",
+                  round, next->id, next->state);
+        else if (idle && idle->state == TASK_READY)
+            CHECK(next == idle, "round %d: idle not picked", round);
+        else
+            CHECK(next == cur, "round %d: switched away with nothing runnable", round);
+    }
+
+    // Random mixes of deadline and best-effort tasks: a runnable deadline
+    // task with the earliest deadline always wins
+    for (int round = 0; round < 20000; ++round) {
+        int n = rng_range(1, 32);
+        task_t *head = make_list(n);
+        task_t *best = NULL;
+        for (int i = 0; i < n; ++i) {
+            pool[i].state = (task_state_t)rng_range(TASK_READY, TASK_BLOCKED);
+            if (rng_next() & 1) {
+                make_dl(&pool[i], 1000 + rng_next() % 64);
+                pool[i].dl_throttled = (rng_next() & 3) == 0;
+                if (sched_runnable(&pool[i]) &&
+                    (!best || pool[i].dl_abs_deadline < best->dl_abs_deadline)) best = &pool[i];
+            }
+        }
+        task_t *next = pick(head, &pool[rng_next() % n], NULL);
+        if (best)
+            CHECK(next->dl_abs_deadline == best->dl_abs_deadline && sched_runnable(next),
+                  "round %d: picked deadline %u, earliest %u", round, next->dl_abs_deadline, best->dl_abs_deadline);
+        else
+            CHECK(!sched_runnable(next) || !next->dl_period, "round %d: picked a throttled task", round);
+    }
+
+    static int picks[64];
+    task_t *head = make_list(64);
+    memset(picks, 0, sizeof(picks));
+    task_t *cur = head;
+    for (int i = 0; i < 64 * 1000; ++i) {
+        cur = sched_pick(head, cur, NULL);
+        picks[cur->id]++;
+    }
+    for (int i = 0; i < 64; ++i) CHECK(picks[i] == 1000, "task %d picked %d times", i, picks[i]);
+}
+
+// Cost of one pick with n tasks of which `ready_pct` percent are runnable,
+// following the picks around the list as the kernel does
+static void bench_pick(int n, int ready_pct) {
+    task_t *head = make_list(n);
+    for (int i = 0; i < n; ++i)
+        pool[i].state = (int)(rng_next() % 100) < ready_pct ? TASK_READY : TASK_SLEEPING;
+    pool[0].state = TASK_READY;
+    task_t *idle = &pool[n - 1];
+    const int ops = n >= 1024 ? 20000 : 2000000;
+    task_t *cur = head;
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < ops; ++i) cur = sched_pick(head, cur, idle);
+    uint64_t ns = now_ns() - t0;
+    printf("sched %4d tasks, %3d%% ready  %8.1f ns/pick\n", n, ready_pct, (double)ns / ops);
+}
+
+int main(int argc, char **argv) {
+    int bench;
+    if (!parse_args(argc, argv, &bench)) return 2;
+    test_unit();
+    test_edf();
+    test_stress();
+    if (bench) {
+        static const int sizes[] = { 4, 8, 64, 1024, 4096 };
+        for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+            bench_pick(sizes[i], 100);
+            bench_pick(sizes[i], 10);
+        }
+    }
+    return report_result("test_sched");
+}
@@ -0,0 +1,239 @@
+// Host-side checks for src/workqueue.c: FIFO order and no double queueing,
+// items that requeue or free themselves, delayed work expiring on exactly
+// its tick (also across the 32-bit wrap), cancellation, round-robin between
+// queues, flush, and pool growth with back-off after a failed spawn.
+// --bench times queue+run and delayed-work churn.
+#include "workqueue.h"
+#include "task.h"
+#include "kconfig.h"
+#include "host_test.h"
+
+// Workers never run here: items run from the test through
+// workqueue_run_pending, and a flush drains the queues itself. Queues stay
+// registered for good, so they are static.
+static task_t fake_tasks[16];
+static int creates, create_fail;
+
+task_t *task_create(void (*entry)(void)) {
+    (void)entry;
+    if (create_fail || creates >= 16) return NULL;
+    return &fake_tasks[creates++];
+}
+void task_set_name(task_t *t, const char *name) { t->name = name; }
+void wait_queue_sleep(wait_queue_t *q) { (void)q; workqueue_run_pending(); }
+void wait_queue_wake_all(wait_queue_t *q) { q->head = NULL; }
+
+static uint32_t tick;
+
+static void run_ticks(uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        workqueue_tick(++tick);
+        workqueue_run_pending();
+    }
+}
+
+static int order[64], norder;
+
+static void record(void *arg) {
+    if (norder < 64) order[norder++] = (int)(intptr_t)arg;
+}
+
+static void test_fifo(void) {
+    static workqueue_t wq;
+    work_t w[3];
+    workqueue_init(&wq, "fifo");
+    norder = 0;
+    for (int i = 0; i < 3; ++i) {
+        w[i] = (work_t){0};
+        CHECK(queue_work(&wq, &w[i], record, (void *)(intptr_t)i) == 1, "queue %d", i);
+    }
+    CHECK(queue_work(&wq, &w[1], record, (void *)99) == 0, "pending item queued twice");
+    CHECK(wq.depth == 3 && wq.max_depth == 3 && wq.queued == 3, "depth %u max %u", wq.depth, wq.max_depth);
+    CHECK(workqueue_run_pending() == 3, "ran a different number of items");
+    CHECK(norder == 3 && order[0] == 0 && order[1] == 1 && order[2] == 2, "order %d %d %d", order[0], order[1], order[2]);
+    CHECK(wq.depth == 0 && wq.done == 3 && wq.running == 0, "after run: depth %u done %u", wq.depth, wq.done);
+    CHECK(queue_work(&wq, &w[1], record, (void *)7) == 1, "finished item cannot be queued again");
+    workqueue_run_pending();
+    CHECK(norder == 4 && order[3] == 7, "requeued item ran with old argument");
+}
+
+// Requeues itself a few times, then frees its container
+typedef struct self_work {
+    work_t work;
+    workqueue_t *wq;
+    int runs;
+} self_work_t;
+
+static int self_freed;
+
+static void self_fn(void *arg) {
+    self_work_t *s = arg;
+    if (++s->runs < 5) {
+        CHECK(queue_work(s->wq, &s->work, self_fn, s) == 1, "requeue from its own function");
+        return;
+    }
+    free(s);
+    self_freed++;
+}
+
+static void test_self(void) {
+    static workqueue_t wq;
+    workqueue_init(&wq, "self");
+    self_freed = 0;
+    for (int i = 0; i < 10; ++i) {
+        self_work_t *s = calloc(1, sizeof(*s));
+        s->wq = &wq;
+        queue_work(&wq, &s->work, self_fn, s);
+    }
+    CHECK(workqueue_run_pending() == 50, "self-requeueing items ran wrong number of times");
+    CHECK(self_freed == 10 && wq.depth == 0 && wq.done == 50, "%d freed, done %u", self_freed, wq.done);
+}
+
+typedef struct timed_work {
+    work_t work;
+    uint32_t due;
+} timed_work_t;
+
+static int late, early, fired;
+
+static void timed_fn(void *arg) {
+    timed_work_t *t = arg;
+    if (tick > t->due) late++;
+    if (tick < t->due) early++;
+    fired++;
+}
+
+static void test_delayed(uint32_t start_tick) {
+    enum { N = 2000 };
+    static timed_work_t t[N];
+    static workqueue_t wq;
+    if (!wq.name) workqueue_init(&wq, "delayed");
+    uint32_t done = wq.done;
+    tick = start_tick;
+    workqueue_tick(tick);
+    late = early = fired = 0;
+    for (int i = 0; i < N; ++i) {
+        uint32_t d = rng_range(0, 300);
+        t[i] = (timed_work_t){ .due = tick + d };
+        CHECK(queue_delayed_work(&wq, &t[i].work, timed_fn, &t[i], d) == 1, "queue delayed %d", i);
+    }
+    CHECK(queue_delayed_work(&wq, &t[0].work, timed_fn, &t[0], 5) == 0, "waiting item queued twice");
+    workqueue_run_pending(); // the zero delays
+    run_ticks(300);
+    CHECK(fired == N && !late && !early, "start %#x: %d fired, %d late, %d early", start_tick, fired, late, early);
+    CHECK(wq.delayed == 0 && wq.depth == 0 && wq.done - done == N, "leftover: %u delayed %u queued", wq.delayed, wq.depth);
+}
+
+static void test_cancel(void) {
+    static workqueue_t wq;
+    work_t w[4] = {{0}};
+    workqueue_init(&wq, "cancel");
+    norder = 0;
+    CHECK(cancel_work(&w[0]) == 0, "cancelled an idle item");
+    for (int i = 0; i < 3; ++i) queue_work(&wq, &w[i], record, (void *)(intptr_t)i);
+    CHECK(cancel_work(&w[1]) == 1 && cancel_work(&w[1]) == 0, "cancel pending middle");
+    CHECK(cancel_work(&w[2]) == 1, "cancel pending tail");
+    queue_work(&wq, &w[3], record, (void *)3); // appended after the new tail
+    queue_delayed_work(&wq, &w[1], record, (void *)1, 3);
+    CHECK(wq.depth == 2 && wq.delayed == 1, "depth %u delayed %u", wq.depth, wq.delayed);
+    CHECK(cancel_work(&w[1]) == 1 && wq.delayed == 0, "cancel delayed");
+    workqueue_run_pending();
+    run_ticks(5);
+    CHECK(norder == 2 && order[0] == 0 && order[1] == 3, "ran %d items, order %d %d", norder, order[0], order[1]);
+    CHECK(wq.cancelled == 3 && wq.done == 2, "cancelled %u done %u", wq.cancelled, wq.done);
+    CHECK(queue_work(&wq, &w[2], record, (void *)2) == 1, "cancelled item cannot be queued again");
+    workqueue_run_pending();
+}
+
+static void test_round_robin(void) {
+    static workqueue_t a, b;
+    work_t wa[3] = {{0}}, wb[3] = {{0}};
+    workqueue_init(&a, "a");
+    workqueue_init(&b, "b");
+    norder = 0;
+    for (int i = 0; i < 3; ++i) queue_work(&a, &wa[i], record, (void *)(intptr_t)i);
+    for (int i = 0; i < 3; ++i) queue_work(&b, &wb[i], record, (void *)(intptr_t)(10 + i));
+    workqueue_run_pending();
+    int alternating = norder == 6;
+    for (int i = 1; i < norder; ++i) alternating &= (order[i] >= 10) != (order[i - 1] >= 10);
+    CHECK(alternating, "queues not taken in turn: %d %d %d %d", order[0], order[1], order[2], order[3]);
+}
+
+static void test_flush(void) {
+    static workqueue_t wq;
+    work_t w[5] = {{0}};
+    workqueue_init(&wq, "flush");
+    for (int i = 0; i < 5; ++i) queue_work(&wq, &w[i], record, NULL);
+    flush_workqueue(&wq);
+    CHECK(wq.depth == 0 && wq.running == 0 && wq.done == 5, "flush returned with %u queued", wq.depth);
+}
+
+// Runs first: nothing has started the pool yet
+static void test_pool(void) {
+    workqueue_pool_stats_t ps;
+    static workqueue_t wq;
+    work_t w[3] = {{0}};
+    workqueue_init(&wq, "pool");
+    create_fail = 1;
+    workqueue_pool_init();
+    workqueue_pool_stats(&ps);
+    CHECK(ps.workers == 0 && ps.spawn_failed == WQ_MIN_WORKERS, "failed start: %u workers", ps.workers);
+    create_fail = 0;
+    // Two items with no worker around: running the first wants a worker
+    // for the second, but not before the next tick after the failure
+    queue_work(&wq, &w[0], record, NULL);
+    queue_work(&wq, &w[1], record, NULL);
+    workqueue_run_pending();
+    CHECK(creates == 0, "retried within the same tick");
+    run_ticks(1);
+    queue_work(&wq, &w[0], record, NULL);
+    queue_work(&wq, &w[1], record, NULL);
+    queue_work(&wq, &w[2], record, NULL);
+    workqueue_run_pending();
+    workqueue_pool_stats(&ps);
+    CHECK(creates == 1 && ps.workers == 1 && ps.spawned == 1 && ps.peak == 1,
+          "%d created, %u workers", creates, ps.workers);
+    CHECK(!strcmp(fake_tasks[0].name, "kworker"), "worker not named");
+    CHECK(ps.pending == 0 && ps.workers <= CONFIG_WQ_MAX_WORKERS, "pending %u", ps.pending);
+}
+
+static void noop(void *arg) {
+    (void)arg;
+}
+
+static void bench(void) {
+    const int ops = 2000000;
+    static workqueue_t wq;
+    work_t w = {0};
+    workqueue_init(&wq, "bench");
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < ops; ++i) {
+        queue_work(&wq, &w, noop, NULL);
+        workqueue_run_pending();
+    }
+    printf("wq queue+run:         %5.1f ns\n", (double)(now_ns() - t0) / ops);
+
+    enum { N = 1000 };
+    static work_t dw[N];
+    t0 = now_ns();
+    for (int round = 0; round < 100; ++round) {
+        for (int i = 0; i < N; ++i) queue_delayed_work(&wq, &dw[i], noop, NULL, 1 + (i & 63));
+        run_ticks(64);
+    }
+    printf("delayed queue+expire: %5.1f ns (%d waiting)\n", (double)(now_ns() - t0) / (100 * N), N);
+}
+
+int main(int argc, char **argv) {
+    int bench_mode;
+    if (!parse_args(argc, argv, &bench_mode)) return 2;
+    test_pool();
+    test_fifo();
+    test_self();
+    test_delayed(1000);
+    test_delayed(0xFFFFFF80u); // due ticks wrap past zero
+    test_cancel();
+    test_round_robin();
+    test_flush();
+    if (bench_mode) bench();
+    return report_result("test_workqueue");
+}
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""Compare an AMXOS perf-mode serial log against the committed baseline.
+
+Usage:
+    perf_compare.py build/perf.log tools/perf_baseline.txt [--threshold 10]
+    perf_compare.py build/perf.log tools/perf_baseline.txt --update
+
+The kernel (booted with amxos.mode=perf) prints:
+
+    PERF BEGIN tsc_mhz=N
+    PERF <metric> <value>
+    PERF END
+
+The baseline file has one "metric better value" line per metric, where
+better is "lower" or "higher" and value is "-" until a baseline has been
+recorded. A metric that is worse than its baseline by more than the
+threshold (percent) is a regression and makes the exit status 1, as does a
+missing or truncated report. --update rewrites the baseline values from the
+log and keeps the directions.
+"""
+import argparse
+import sys
+
+
+def parse_log(path):
+    metrics, header, complete = {}, None, False
+    with open(path, errors="replace") as f:
+        for line in f:
+            parts = line.split()
+            if len(parts) < 2 or parts[0] != "PERF":
+                continue
+            if parts[1] == "BEGIN":
+                metrics, header, complete = {}, line.strip(), False
+            elif parts[1] == "END":
+                complete = True
+            elif len(parts) == 3:
+                metrics[parts[1]] = int(parts[2])
+    return header, metrics, complete
+
+
+def parse_baseline(path):
+    rows = []
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line or line.startswith("#"):
+                continue
+            name, better, value = line.split()
+            if better not in ("lower", "higher"):
+                sys.exit("%s: bad direction %r for %s" % (path, better, name))
+            rows.append((name, better, None if value == "-" else int(value)))
+    return rows
+
+
+def write_baseline(path, rows, metrics):
+    with open(path) as f:
+        comments = [l for l in f if l.startswith("#")]
+    with open(path, "w") as f:
+        f.writelines(comments)
+        for name, better, old in rows:
+            value = metrics.get(name, old)
+            f.write("%-24s %-6s %s\n" % (name, better, "-" if value is None else value))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("log", help="serial capture from a perf-mode boot")
+    ap.add_argument("baseline", help="baseline file (metric better value)")
+    ap.add_argument("--threshold", type=float, default=10.0,
+                    help="allowed regression in percent (default 10)")
+    ap.add_argument("--update", action="store_true", help="record the log as the new baseline")
+    args = ap.parse_args()
+
+    header, metrics, complete = parse_log(args.log)
+    if header is None:
+        sys.exit("%s: no PERF report found (did the kernel boot in perf mode?)" % args.log)
+    if not complete:
+        sys.exit("%s: PERF report truncated (no PERF END)" % args.log)
+    rows = parse_baseline(args.baseline)
+
+    if args.update:
+        write_baseline(args.baseline, rows, metrics)
+        print("baseline %s updated from %s" % (args.baseline, args.log))
+        return
+
+    print(header)
+    print("%-24s %12s %12s %8s" % ("metric", "baseline", "current", "change"))
+    failed = []
+    for name, better, base in rows:
+        cur = metrics.get(name)
+        if cur is None:
+            print("%-24s %12s %12s %8s" % (name, base if base is not None else "-", "missing", ""))
+            failed.append(name)
+            continue
+        if base is None:
+            print("%-24s %12s %12d %8s" % (name, "-", cur, "new"))
+            continue
+        change = 100.0 * (cur - base) / base if base else 0.0
+        worse = change if better == "lower" else -change
+        mark = ""
+        if worse > args.threshold:
+            mark = "  REGRESSION"
+            failed.append(name)
+        print("%-24s %12d %12d %+7.1f%%%s" % (name, base, cur, change, mark))
+    if failed:
+        print("perf: %d metric(s) regressed beyond %.1f%%: %s"
+              % (len(failed), args.threshold, ", ".join(failed)))
+        sys.exit(1)
+    print("perf: no regressions beyond %.1f%%" % args.threshold)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""Symbolize an AMXOS profiler dump (captured from serial).
+
+Usage:
+    profsym.py serial.log [--elf build/kernel.elf] [--folded out.folded]
+
+The kernel's `prof dump` command prints:
+
+    PROF BEGIN samples=N dropped=M
+    P <count> <pc0> <pc1> ...      (pc0 = interrupted EIP, then return addresses)
+    PROF END
+
+By default a flat profile (self and inclusive samples per function) is
+printed. --folded writes "outer;...;inner count" lines suitable for
+flamegraph.pl or speedscope.
+"""
+import argparse
+import bisect
+import subprocess
+import sys
+from collections import Counter
+
+
+def load_symbols(elf, nm):
+    out = subprocess.run([nm, "-n", "--defined-only", elf], check=True,
+                         capture_output=True, text=True).stdout
+    addrs, names = [], []
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) != 3 or parts[1] not in "tTwW":
+            continue
+        addrs.append(int(parts[0], 16))
+        names.append(parts[2])
+    return addrs, names
+
+
+def make_resolver(addrs, names):
+    cache = {}
+
+    def resolve(pc):
+        if pc not in cache:
+            i = bisect.bisect_right(addrs, pc) - 1
+            cache[pc] = names[i] if i >= 0 else "0x%x" % pc
+        return cache[pc]
+    return resolve
+
+
+def parse(lines):
+    stacks = []
+    header = ""
+    inside = False
+    for line in lines:
+        line = line.strip()
+        if line.startswith("PROF BEGIN"):
+            inside, stacks, header = True, [], line
+            continue
+        if line.startswith("PROF END"):
+            inside = False
+            continue
+        if inside and line.startswith("P "):
+            parts = line.split()
+            if len(parts) < 3:
+                continue
+            count = int(parts[1])
+            pcs = [int(p, 16) for p in parts[2:]]
+            stacks.append((count, pcs))
+    return header, stacks
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("log", help="serial capture containing a profile dump ('-' for stdin)")
+    ap.add_argument("--elf", default="build/kernel.elf", help="kernel image with symbols")
+    ap.add_argument("--nm", default="nm", help="nm binary (e.g. i686-elf-nm)")
+    ap.add_argument("--folded", help="write folded stacks to this file")
+    ap.add_argument("--top", type=int, default=30, help="rows in the flat profile")
+    args = ap.parse_args()
+
+    src = sys.stdin if args.log == "-" else open(args.log, errors="replace")
+    header, stacks = parse(src)
+    if not stacks:
+        sys.exit("no profile records found")
+    resolve = make_resolver(*load_symbols(args.elf, args.nm))
+
+    total = sum(c for c, _ in stacks)
+    self_count, incl_count = Counter(), Counter()
+    folded = Counter()
+    for count, pcs in stacks:
+        # Return addresses point after the call; step back into the caller
+        funcs = [resolve(pcs[0])] + [resolve(pc - 1) for pc in pcs[1:]]
+        self_count[funcs[0]] += count
+        for f in set(funcs):
+            incl_count[f] += count
+        folded[";".join(reversed(funcs))] += count
+
+    if args.folded:
+        with open(args.folded, "w") as f:
+            for stack, count in folded.most_common():
+                f.write("%s %d\n" % (stack, count))
+
+    print(header)
+    print("%8s %7s %8s %7s  %s" % ("self", "self%", "total", "total%", "function"))
+    for func, count in self_count.most_common(args.top):
+        print("%8d %6.2f%% %8d %6.2f%%  %s" % (count, 100.0 * count / total,
+                                              incl_count[func], 100.0 * incl_count[func] / total, func))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""Convert an AMXOS trace dump (captured from serial) to Chrome trace JSON.
+
+Usage: trace2json.py serial.log [-o trace.json] [--tsc-mhz 2000]
+
+The kernel's `trace dump` command prints a block like:
+
+    TRACE BEGIN cpus=1 records=N
+    T <cpu> <tsc hex> <event> <a hex> <b hex>
+    ...
+    TRACE END
+
+The output loads in chrome://tracing or https://ui.perfetto.dev. Each CPU gets
+a track showing which task was running (from context-switch events), a track
+for interrupt handlers, and instant events for wakeups, sleeps, faults and deadline misses.
+"""
+import argparse
+import json
+import sys
+
+SWITCH, WAKEUP, SLEEP, IRQ_ENTRY, IRQ_EXIT, PAGE_FAULT, DL_MISS = range(1, 8)
+
+IRQ_NAMES = {0x20: "timer", 0x21: "keyboard", 0x24: "com1"}
+
+
+def parse(lines):
+    records = []
+    inside = False
+    for line in lines:
+        line = line.strip()
+        if line.startswith("TRACE BEGIN"):
+            inside = True
+            records = []  # keep the last dump in the log
+            continue
+        if line.startswith("TRACE END"):
+            inside = False
+            continue
+        if not inside or not line.startswith("T "):
+            continue
+        parts = line.split()
+        if len(parts) != 6:
+            continue
+        cpu, tsc, event, a, b = parts[1:]
+        records.append((int(tsc, 16), int(cpu), int(event), int(a, 16), int(b, 16)))
+    records.sort()
+    return records
+
+
+def convert(records, tsc_mhz):
+    events = []
+    if not records:
+        return events
+    base = records[0][0]
+
+    def us(tsc):
+        return (tsc - base) / tsc_mhz
+
+    running = {}  # cpu -> (task id, start tsc)
+    for tsc, cpu, event, a, b in records:
+        tid_task = cpu * 2
+        tid_irq = cpu * 2 + 1
+        if event == SWITCH:
+            prev = running.get(cpu)
+            start = prev[1] if prev and prev[0] == a else base
+            events.append({"name": "task %d" % a, "ph": "X", "pid": 0, "tid": tid_task,
+                           "ts": us(start), "dur": us(tsc) - us(start)})
+            running[cpu] = (b, tsc)
+        elif event == IRQ_ENTRY:
+            events.append({"name": "irq %s" % IRQ_NAMES.get(a, hex(a)), "ph": "B",
+                           "pid": 0, "tid": tid_irq, "ts": us(tsc)})
+        elif event == IRQ_EXIT:
+            events.append({"name": "irq %s" % IRQ_NAMES.get(a, hex(a)), "ph": "E",
+                           "pid": 0, "tid": tid_irq, "ts": us(tsc)})
+        elif event == WAKEUP:
+            events.append({"name": "wakeup task %d" % a, "ph": "i", "s": "t",
+                           "pid": 0, "tid": tid_task, "ts": us(tsc)})
+        elif event == SLEEP:
+            events.append({"name": "sleep task %d" % a, "ph": "i", "s": "t",
+                           "pid": 0, "tid": tid_task, "ts": us(tsc),
+                           "args": {"ticks": b}})
+        elif event == PAGE_FAULT:
+            events.append({"name": "page fault", "ph": "i", "s": "g",
+                           "pid": 0, "tid": tid_task, "ts": us(tsc),
+                           "args": {"addr": hex(a), "err": hex(b)}})
+        elif event == DL_MISS:
+            events.append({"name": "deadline miss task %d" % a, "ph": "i", "s": "t",
+                           "pid": 0, "tid": tid_task, "ts": us(tsc),
+                           "args": {"deadline_tick": b}})
+    end = records[-1][0]
+    for cpu, (task, start) in running.items():
+        events.append({"name": "task %d" % task, "ph": "X", "pid": 0, "tid": cpu * 2,
+                       "ts": us(start), "dur": us(end) - us(start)})
+    cpus = sorted({r[1] for r in records})
+    for cpu in cpus:
+        events.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": cpu * 2,
+                       "args": {"name": "cpu%d tasks" % cpu}})
+        events.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": cpu * 2 + 1,
+                       "args": {"name": "cpu%d irq" % cpu}})
+    return events
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("log", help="serial capture containing a trace dump ('-' for stdin)")
+    ap.add_argument("-o", "--output", help="output file (default stdout)")
+    ap.add_argument("--tsc-mhz", type=float, default=1000.0,
+                    help="TSC frequency used to convert cycles to microseconds")
+    args = ap.parse_args()
+
+    src = sys.stdin if args.log == "-" else open(args.log, errors="replace")
+    records = parse(src)
+    if not records:
+        sys.exit("no trace records found")
+    out = {"traceEvents": convert(records, args.tsc_mhz), "displayTimeUnit": "ns"}
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(out, f)
+    else:
+        json.dump(out, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,26 @@
+// First program loaded from the initrd. The large .bss costs nothing until
+// touched: only the pages written below are ever populated.
+#include "usyscall.h"
+
+int usys_fast;
+
+char scratch[1024 * 1024]; // global, so the stores below are kept
+
+static uint32_t str_len(const char *s) {
+    uint32_t n = 0;
+    while (s[n]) n++;
+    return n;
+}
+
+static void print(const char *s) {
+    usys_write(s, str_len(s));
+}
+
+void _start(int fast_syscalls) {
+    usys_fast = fast_syscalls;
+    print("hello from /bin/hello");
+    scratch[0] = 1;
+    scratch[sizeof(scratch) - 1] = 1;
+    print(usys_fast ? "syscalls via sysenter" : "syscalls via int 0x80");
+    usys_exit();
+}